@@ -0,0 +1,20 @@
+#pragma once
+
+#include <evol/common/ev_types.h>
+
+// ===============
+// Tag Definitions
+// ===============
+
+/* ==================Inactive Tag=================== */
+// Set on every object of a deactivated subtree. None of the module's systems
+// or spatial queries see tagged objects.
+static CONST_STR InactiveTagName = "Inactive";
+static U64 InactiveTagID;
+
+/* ================InactiveSelf Tag================= */
+// Set only on objects deactivated directly through `Object.setActive`. An
+// object is active when neither it nor any ancestor carries it; reactivating
+// an ancestor leaves such objects (and their subtrees) inactive.
+static CONST_STR InactiveSelfTagName = "InactiveSelf";
+static U64 InactiveSelfTagID;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <evol/common/ev_types.h>
+
+#define EV_ANIMATION_MAX_KEYS 8
+
+#define EV_ANIMATION_CHANNEL_POSITION (1 << 0)
+#define EV_ANIMATION_CHANNEL_ROTATION (1 << 1)
+#define EV_ANIMATION_CHANNEL_SCALE    (1 << 2)
+
+typedef enum {
+  EV_ANIMATION_EASING_LINEAR,
+  EV_ANIMATION_EASING_EASEIN,
+  EV_ANIMATION_EASING_EASEOUT,
+  EV_ANIMATION_EASING_EASEINOUT,
+  EV_ANIMATION_EASING_STEP,
+} AnimationEasing;
+
+typedef enum {
+  EV_ANIMATION_WRAP_ONCE,
+  EV_ANIMATION_WRAP_LOOP,
+  EV_ANIMATION_WRAP_PINGPONG,
+} AnimationWrap;
+
+// =====================
+// Component Definitions
+// =====================
+
+/* ===============Animation Component=============== */
+typedef struct {
+  F32 time; // Seconds from the start of the track
+  Vec3 position;
+  Vec4 rotation;
+  Vec3 scale;
+} AnimationKey;
+
+// A track of up to `EV_ANIMATION_MAX_KEYS` keys, in ascending time. A tween
+// is a track of two keys.
+typedef struct {
+  AnimationKey keys[EV_ANIMATION_MAX_KEYS];
+  U32 keyCount;
+  U32 channels; // `EV_ANIMATION_CHANNEL_*` written to the transform
+  AnimationEasing easing; // Applied within each segment
+  AnimationWrap wrap;
+  F32 speed;
+  F32 time; // Playhead, in seconds
+  bool playing;
+} AnimationComponent;
+static CONST_STR AnimationComponentName = "AnimationComponent";
+static U64 AnimationComponentID;
+
+
+// ===============
+// Tag Definitions
+// ===============
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <evol/common/ev_types.h>
+
+// =====================
+// Component Definitions
+// =====================
+
+/* =================Bounds Component================ */
+// Object-space axis-aligned box enclosing whatever the object renders
+typedef struct {
+  Vec3 center;
+  Vec3 extents; // Half size along each axis
+} BoundsComponent;
+static CONST_STR BoundsComponentName = "BoundsComponent";
+static U64 BoundsComponentID;
+
+
+// ===============
+// Tag Definitions
+// ===============
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <evol/common/ev_types.h>
+
+// Uses `RenderComponent`, so this has to come after the renderer import
+
+#define EV_LOD_MAX_LEVELS 4
+
+// =====================
+// Component Definitions
+// =====================
+
+/* ==================LOD Component================== */
+typedef struct {
+  // Finest first
+  RenderComponent levels[EV_LOD_MAX_LEVELS];
+  // Distance from the camera past which each level hands over to the next
+  F32 switchDistances[EV_LOD_MAX_LEVELS];
+  // Fraction of a switch distance to go past before switching, to avoid
+  // popping back and forth at the boundary
+  F32 hysteresis;
+  U32 levelCount;
+  U32 currentLevel;
+} LODComponent;
+static CONST_STR LODComponentName = "LODComponent";
+static U64 LODComponentID;
+
+
+// ===============
+// Tag Definitions
+// ===============
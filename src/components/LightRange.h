@@ -0,0 +1,21 @@
+#pragma once
+
+#include <evol/common/ev_types.h>
+
+// =====================
+// Component Definitions
+// =====================
+
+/* ==============Light Range Component============== */
+// Distance past which a light has no visible effect. Lights without one
+// (directional lights) are never culled.
+typedef struct {
+  F32 radius;
+} LightRangeComponent;
+static CONST_STR LightRangeComponentName = "LightRangeComponent";
+static U64 LightRangeComponentID;
+
+
+// ===============
+// Tag Definitions
+// ===============
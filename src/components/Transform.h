@@ -32,3 +32,8 @@ static U64 WorldTransformComponentID;
 /* ===============Dirty Transform Tag=============== */
 static CONST_STR DirtyTransformTagName = "DirtyTransform";
 static U64 DirtyTransformTagID;
+
+/* ==============Static Transform Tag=============== */
+// World transform is baked and never recomputed
+static CONST_STR StaticTransformTagName = "StaticTransform";
+static U64 StaticTransformTagID;
@@ -15,11 +15,8 @@ EntityMemberGetters['position'] = function(entt)
 end
 
 EntityMemberSetters['position'] = function(entt, pos)
+  -- Also teleports the rigidbody, if any
   C('ev_object_setposition', entt, pos)
-  local rb = ComponentGetters[Rigidbody](entt)
-  if rb ~= nil then
-    rb:setPosition(pos)
-  end
 end
 
 EntityMemberGetters['worldPosition'] = function(entt)
@@ -33,11 +30,53 @@ EntityMemberGetters['eulerAngles'] = function(entt)
 end
 
 EntityMemberSetters['eulerAngles'] = function(entt, rot)
+  -- Also teleports the rigidbody, if any
   C('ev_object_setrotationeuler', entt, rot)
-  local rb = ComponentGetters[Rigidbody](entt)
-  if rb ~= nil and rb.handle ~= nil then
-    rb:setRotation(rot)
-  end
+end
+
+-- Deactivating an entity deactivates its whole subtree. `active` is false
+-- while any ancestor is inactive; descendants deactivated on their own stay
+-- inactive when an ancestor is reactivated.
+EntityMemberGetters['active'] = function(entt)
+  return C('ev_object_isactive', entt)
+end
+
+EntityMemberSetters['active'] = function(entt, active)
+  C('ev_object_setactive', entt, active)
+end
+
+-- The script module ticks every entity with a script; callbacks of inactive
+-- entities are wrapped so that they return straight away. The script itself
+-- stays attached, so its state carries over to when it is active again.
+local function setActiveCallback(entt, key, fn)
+  rawset(Entities[entt], key, fn and function(...)
+    if not C('ev_object_isactive', entt) then
+      return
+    end
+    return fn(...)
+  end)
+end
+
+EntityMemberSetters['on_update'] = function(entt, fn)
+  setActiveCallback(entt, 'on_update', fn)
+end
+
+EntityMemberSetters['on_fixedupdate'] = function(entt, fn)
+  setActiveCallback(entt, 'on_fixedupdate', fn)
+end
+
+-- Tracks of an AnimationComponent are evaluated natively; these only start,
+-- stop and seek them
+EntityMemberGetters['animationPlaying'] = function(entt)
+  return C('ev_object_isanimationplaying', entt)
+end
+
+EntityMemberSetters['animationPlaying'] = function(entt, playing)
+  C('ev_object_setanimationplaying', entt, playing)
+end
+
+EntityMemberSetters['animationTime'] = function(entt, time)
+  C('ev_object_setanimationtime', entt, time)
 end
 
 EntityMemberGetters['forward'] = function(entt)
@@ -63,10 +102,169 @@ function getObject(path)
   return Entities[C('ev_scene_getobject', path)]
 end
 
+function getObjectByPath(path)
+  return Entities[C('ev_scene_getobjectbypath', path)]
+end
+
+function collectQueryResults(count)
+  local res = {}
+  for i = 0, count - 1 do
+    res[i + 1] = Entities[C('ev_scene_getqueryresult', i)]
+  end
+  return res
+end
+
+function queryBox(min, max)
+  return collectQueryResults(C('ev_scene_querybox', min, max))
+end
+
+function querySphere(center, radius)
+  return collectQueryResults(C('ev_scene_querysphere', center, radius))
+end
+
+function raycastBounds(origin, direction, maxDistance)
+  local hit = C('ev_scene_raycastbounds', origin, direction, maxDistance)
+  if hit.object == 0 then
+    return nil
+  end
+  return Entities[hit.object], hit.distance
+end
+
+-- Tests against BoundsComponent boxes, not physics colliders: entities
+-- without bounds are never hit.
+-- rays: list of { origin = Vec3, direction = Vec3, maxDistance = number }.
+-- Returns a list with, per ray, { entity, distance } or false on a miss.
+function raycastBatch(rays)
+  local count = #rays
+  local queries = C('ev_scene_raycastbatch_begin', count)
+  if queries == nil then
+    return {}
+  end
+  for i = 1, count do
+    local q = queries[i - 1]
+    local ray = rays[i]
+    q.origin.x, q.origin.y, q.origin.z = ray.origin.x, ray.origin.y, ray.origin.z
+    q.direction.x, q.direction.y, q.direction.z = ray.direction.x, ray.direction.y, ray.direction.z
+    q.maxDistance = ray.maxDistance
+  end
+  local hits = C('ev_scene_raycastbatch_run')
+  local res = {}
+  for i = 1, count do
+    local hit = hits[i - 1]
+    if hit.object == 0 then
+      res[i] = false
+    else
+      res[i] = { Entities[hit.object], hit.distance }
+    end
+  end
+  return res
+end
+
+-- Tests against BoundsComponent boxes, not physics colliders: entities
+-- without bounds are never found.
+-- spheres: list of { center = Vec3, radius = number }. Returns a list of
+-- entity lists, each holding at most maxResults entities.
+function overlapBatch(spheres, maxResults)
+  local count = #spheres
+  local queries = C('ev_scene_overlapbatch_begin', count)
+  if queries == nil then
+    return {}
+  end
+  for i = 1, count do
+    local q = queries[i - 1]
+    local sphere = spheres[i]
+    q.center.x, q.center.y, q.center.z = sphere.center.x, sphere.center.y, sphere.center.z
+    q.radius = sphere.radius
+  end
+  local counts = C('ev_scene_overlapbatch_run', maxResults)
+  local objects = C('ev_scene_overlapbatch_results')
+  local res = {}
+  for i = 1, count do
+    local list = {}
+    for j = 0, math.min(counts[i - 1], maxResults) - 1 do
+      list[j + 1] = Entities[objects[(i - 1) * maxResults + j]]
+    end
+    res[i] = list
+  end
+  return res
+end
+
+-- Bulk transform access: the returned view holds FFI arrays (0-indexed) of
+-- `count` elements: objects, valid, positions, eulerAngles, forwards and
+-- worldPositions. `valid[i]` is false for entities that no longer exist; their
+-- columns read as zero and are not written back. Changes to
+-- positions/eulerAngles are applied by writeTransforms. A view stays valid
+-- until the next get*Transforms call.
+function getTransforms(entities)
+  local view = C('ev_scene_begintransformview', #entities)
+  for i = 1, #entities do
+    view.objects[i - 1] = entities[i].entityID
+  end
+  C('ev_scene_readtransformview')
+  return view
+end
+
+function queryBoxTransforms(min, max)
+  C('ev_scene_querybox', min, max)
+  return C('ev_scene_querytransformview')
+end
+
+function querySphereTransforms(center, radius)
+  C('ev_scene_querysphere', center, radius)
+  return C('ev_scene_querytransformview')
+end
+
+function readTransforms()
+  C('ev_scene_readtransformview')
+end
+
+function writeTransforms()
+  C('ev_scene_writetransformview')
+end
+
+-- Micro-benchmark of per-entity property access against a transform view:
+-- `iterations` passes that each read and write the position of every entity.
+-- Returns the seconds taken by both. The entities end up where they started.
+function benchmarkTransforms(entities, iterations)
+  local start = os.clock()
+  for _ = 1, iterations do
+    for i = 1, #entities do
+      local pos = entities[i].position
+      pos.x = pos.x + 1
+      entities[i].position = pos
+    end
+  end
+  local perEntity = os.clock() - start
+
+  start = os.clock()
+  for _ = 1, iterations do
+    local view = getTransforms(entities)
+    for i = 0, view.count - 1 do
+      view.positions[i].x = view.positions[i].x - 1
+    end
+    writeTransforms()
+  end
+  return perEntity, os.clock() - start
+end
+
 function destroyObject(entt)
   C('ev_scene_destroyobject', entt.entityID)
 end
 
+-- Pooled instances are returned inactive; set them up, then activate them
+-- with `entity.active = true`
+function acquirePrefab(path)
+  old_this = this
+  prefab = Entities[C('ev_scene_acquire', path)]
+  this = old_this
+  return prefab
+end
+
+-- Returns false for entities that didn't come from acquirePrefab
+function releasePrefab(entt)
+  return C('ev_scene_release', entt.entityID)
+end
+
 function loadPrefab(path)
   -- Storing this as this operation will change what this points to
   old_this = this
@@ -3,6 +3,10 @@
 
 #include "components/Transform.h"
 #include "components/Camera.h"
+#include "components/Bounds.h"
+#include "components/LightRange.h"
+#include "components/Active.h"
+#include "components/Animation.h"
 
 #define IMPORT_MODULE evmod_ecs
 #include <evol/meta/module_import.h>
@@ -15,1107 +19,8061 @@
 #define IMPORT_MODULE evmod_renderer
 #include IMPORT_MODULE_H
 
+#include "components/LOD.h"
+
 #include <evjson.h>
 
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define EV_GAME_STREAMING_DEFAULT_CELLSIZE 64.f
+#define EV_GAME_STREAMING_DEFAULT_BUDGET_MS 2.f
+
+#define EV_GAME_PATH_BUFFER_SIZE 256
+
+#define EV_GAME_LOD_DEFAULT_HYSTERESIS 0.1f
+
+#define EV_GAME_LIGHTCLUSTERS_X 16
+#define EV_GAME_LIGHTCLUSTERS_Y 9
+#define EV_GAME_LIGHTCLUSTERS_Z 24
+#define EV_GAME_LIGHTCLUSTERS_COUNT (EV_GAME_LIGHTCLUSTERS_X * EV_GAME_LIGHTCLUSTERS_Y * EV_GAME_LIGHTCLUSTERS_Z)
+
+// Batched spatial queries: worker threads besides the calling one, queries
+// claimed per chunk, and the batch size below which everything runs inline
+#define EV_GAME_QUERY_WORKERS 3
+#define EV_GAME_QUERYBATCH_CHUNK 32
+#define EV_GAME_QUERYBATCH_PARALLEL_MIN 128
+
+// Objects created through a command buffer are referred to by a placeholder
+// until the buffer is applied: this bit, the buffer id, then a local index
+#define EV_GAME_COMMAND_PLACEHOLDER_BIT (1ULL << 63)
+
+// Replication: captured frames kept around as baselines, fixed-point steps
+// per unit for positions and scales, and bits per smallest-three quaternion
+// component
+#define EV_GAME_REPLICATION_HISTORY 32
+#define EV_GAME_REPLICATION_MAX_COMPONENTS 16
+#define EV_GAME_REPLICATION_POSITION_SCALE 1024.f
+#define EV_GAME_REPLICATION_ROTATION_BITS 10
+
+// Components tracked per object for `Scene.getStats`. Each combination of
+// them is counted as its own archetype.
+#define SCENEOBJECT_FLAG_CAMERA    (1 << 0)
+#define SCENEOBJECT_FLAG_RENDER    (1 << 1)
+#define SCENEOBJECT_FLAG_LIGHT     (1 << 2)
+#define SCENEOBJECT_FLAG_RIGIDBODY (1 << 3)
+#define SCENEOBJECT_FLAG_SCRIPT    (1 << 4)
+#define SCENEOBJECT_ARCHETYPES     (1 << 5)
+
 HashmapDefine(evstring, GameScene, evstring_free, NULL)
 
+// Open-addressing (linear probing) map from a non-zero 64-bit key (object
+// ids, path hashes) to a slot index. Key 0 marks empty buckets.
+typedef struct {
+  U64 *keys;
+  U32 *values;
+  U32 capacity;
+  U32 count;
+} IndexMap;
+
+typedef struct {
+  I32 x;
+  I32 z;
+  vec(U32) nodes;          // Indices into the scene file's `nodes` array
+  vec(GameObject) objects; // Root objects of the cell while it is resident
+  U32 nodeCount;           // Nodes in the cell, children included
+  bool resident;
+} SceneStreamingCell;
+
+typedef struct {
+  AssetHandle scenefile;
+  evjson_t *scene_desc;
+
+  F32 cellSize;
+  F32 radius;
+  F32 budgetMs;
+
+  vec(SceneStreamingCell) cells;
+  IndexMap cellSlots; // `scenestreaming_cellkey` -> slot in `cells`
+  SceneStreamingStats stats;
+  F64 totalLoadMs;
+  U32 totalLoads;
+} SceneStreamingData;
+
+typedef struct SceneArenaChunk {
+  struct SceneArenaChunk *next;
+  size_t size;
+  size_t used;
+} SceneArenaChunk;
+
+#define SCENEARENA_SIZE_CLASSES 5 // 16, 32, 64, 128, 256 bytes
+
+// Chunked bump allocator owning a scene's own allocations. Small blocks can
+// be handed back to per-size-class free lists for reuse; everything is
+// released at once when the scene goes away.
+typedef struct {
+  SceneArenaChunk *head;
+  void *free_lists[SCENEARENA_SIZE_CLASSES];
+  SceneArenaStats stats;
+} SceneArena;
+
+#define SCENEBVH_NULL 0xFFFFFFFFu
+// Leaf boxes are grown by this much so that small moves don't touch the tree
+#define SCENEBVH_MARGIN 0.1f
+
+typedef struct {
+  F32 min[3];
+  F32 max[3];
+  // Next free node while the node is on the free list
+  U32 parent;
+  U32 child1;
+  U32 child2;
+  // 0 for leaves, -1 for free nodes
+  I32 height;
+
+  // Leaves only
+  GameObject object;
+  F32 objectMin[3];
+  F32 objectMax[3];
+} SceneBVHNode;
+
+// Dynamic AABB tree over the world-space bounds of a scene's objects
+typedef struct {
+  vec(SceneBVHNode) nodes;
+  U32 root;
+  U32 freeList;
+  U32 leafCount;
+
+  vec(U32) stack;
+  // Hits of the last query
+  vec(GameObject) results;
+} SceneBVH;
+
+typedef struct {
+  vec4 planes[6];
+  // Frustum state is refreshed lazily by the first culling system run of
+  // each frame so that it sees the camera's final transform.
+  bool frustumChecked;
+  bool frustumValid;
+  bool enabled;
+  // Counters of the frame in progress and of the last finished one
+  SceneCullingStats frame;
+  SceneCullingStats stats;
+} SceneCullingData;
+
+// First and last cluster of a light along x, y and z
+typedef U32 SceneLightClusterRange[6];
+
+typedef struct {
+  bool clustering;
+
+  // Index (in push order) and world-space sphere of every bounded light
+  // pushed this frame
+  vec(U32) frameIndices;
+  vec(Vec4) frameSpheres;
+  U32 pushedLights;
+
+  // Froxel grid over the camera frustum, with depth slices spaced
+  // exponentially between the near and far planes
+  F32 clusterNear;
+  F32 clusterFar;
+  vec(U32) clusterOffsets;
+  vec(U32) clusterCounts;
+  vec(U32) clusterIndices;
+  // Scratch: cluster range of every light, kept for the fill pass
+  vec(SceneLightClusterRange) clusterRanges;
+
+  SceneLightStats frame;
+  SceneLightStats stats;
+} SceneLightData;
+
+// Render objects of static subtrees, baked once and pushed straight from here
+// every frame without going through the ECS systems.
+typedef struct {
+  vec(GameObject) objects;
+  vec(RenderComponent) renderComponents;
+  vec(WorldTransformComponent) worldTransforms;
+  // World-space bounding spheres; negative radius for objects without bounds
+  vec(Vec4) spheres;
+  IndexMap slots;
+} SceneStaticData;
+
+// Scratch columns handed out to scripts (and other modules) as a
+// SceneTransformView. The read* columns keep what was last read so that a
+// write only touches the transforms that were actually changed.
+typedef struct {
+  vec(GameObject) objects;
+  vec(bool) valid;
+  vec(Vec3) positions;
+  vec(Vec3) eulerAngles;
+  vec(Vec3) forwards;
+  vec(Vec3) worldPositions;
+  vec(Vec3) readPositions;
+  vec(Vec3) readEulerAngles;
+} SceneTransformViewData;
+
+// Instances of one prefab. Pooled instances are kept deactivated; the
+// template is the state the first instance was loaded with, per object of
+// the instance in depth-first order: its transform, a mask of the
+// SCENEPREFAB_TEMPLATE_COMPONENTS it has and their data, packed.
+typedef struct {
+  U64 pathHash;
+  CONST_STR path; // In the scene's arena
+  bool hasTemplate;
+  vec(TransformComponent) templateTransforms;
+  vec(U32) templateMasks;
+  vec(U8) templateData;
+  vec(GameObject) available;
+  ScenePoolStats stats;
+} ScenePrefabPool;
+
+typedef struct {
+  vec(ScenePrefabPool) pools;
+  // Prefab path hash -> slot in `pools`. Pools whose path collides with an
+  // indexed one are only found by a scan of `pools`.
+  IndexMap poolSlots;
+  IndexMap objectPools; // Root object of every instance -> slot in `pools`
+  vec(GameObject) walk; // Scratch of the template capture and reset
+} ScenePrefabPools;
+
+typedef struct {
+  GameObject object;
+  U32 key;   // Deepest objects first, then grouped by component flags
+  U32 order; // Discovery order, keeps the sort deterministic
+} SceneDestroyEntry;
+
+// Objects destroyed during the frame. They stay alive until the end of the
+// frame, then whole subtrees are torn down in one pass.
+typedef struct {
+  vec(GameObject) queued;
+  IndexMap queuedSet;
+  // Scratch of the destruction pass
+  vec(SceneDestroyEntry) entries;
+  vec(SceneDestroyEntry) stack; // `key` holds the depth while walking
+  IndexMap visited;
+} SceneDestroyQueue;
+
+typedef struct {
+  GameComponentID id;
+  U32 size;
+} SceneReplicationComponent;
+
+// Quantized transform. The rotation holds the index of the dropped component
+// in its low 2 bits, then the other three.
+typedef struct {
+  I32 position[3];
+  I32 scale[3];
+  U32 rotation;
+} SceneReplicationTransform;
+
+// State of a scene at one captured frame, as both ends see it. Objects are in
+// ascending order; each one has `componentStride` bytes of component data
+// made of a presence byte and the component itself, per replicated component.
+typedef struct {
+  U32 frame; // 0 while unused
+  vec(SceneReplicationComponent) componentTypes;
+  U32 componentStride;
+  vec(GameObject) objects;
+  vec(SceneReplicationTransform) transforms;
+  vec(U8) components;
+} SceneReplicationFrame;
+
 typedef struct {
+  vec(U8) bytes;
+  U64 scratch;
+  U32 scratchBits;
+} ReplicationBitWriter;
+
+typedef struct {
+  const U8 *data;
+  U64 size;
+  U64 bitPos;
+  bool overflow;
+} ReplicationBitReader;
+
+typedef struct {
+  vec(SceneReplicationComponent) components;
+  U32 frameCounter;
+  // Indexed by frame number modulo the history size
+  SceneReplicationFrame history[EV_GAME_REPLICATION_HISTORY];
+  // Scratch of the encoder
+  ReplicationBitWriter writer;
+  vec(GameObject) removed;
+  vec(U32) changed;     // Slots in the encoded frame
+  vec(U32) baseSlots;   // Matching slots in the baseline, ~0u for new objects
+} SceneReplicationData;
+
+// Query and result arrays of the batched queries issued by scripts
+typedef struct {
+  vec(SceneRaycastQuery) rays;
+  vec(SceneBoundsHit) rayHits;
+  vec(SceneOverlapQuery) overlaps;
+  vec(U32) overlapCounts;
+  vec(GameObject) overlapResults;
+} SceneQueryBatchData;
+
+typedef struct {
+  bool enabled;
+  SceneRenderBatchStats frame;
+  SceneRenderBatchStats stats;
+} SceneBatchingData;
+
+typedef struct {
+  // Bumped every time the slot is freed so that stale handles can be told
+  // apart from the scene currently occupying the slot.
+  U32 generation;
+  bool alive;
+
   ECSGameWorldHandle ecs_world;
   PhysicsWorldHandle physics_world;
   ScriptContextHandle script_context;
 
   GameObject activeCamera;
+  SceneCullingData culling;
+  SceneBatchingData batching;
+  SceneLightData lights;
+  SceneBVH bvh;
+  SceneStaticData statics;
+  SceneTransformViewData transform_view;
+  SceneQueryBatchData query_batch;
+  ScenePrefabPools prefab_pools;
+  SceneDestroyQueue destroy_queue;
+  SceneReplicationData replication;
+
+  SceneArena arena;
+
+  // Every object created through this module, densely packed
+  vec(GameObject) objects;
+  IndexMap object_slots;
+  // SCENEOBJECT_FLAG_* of each object, parallel to `objects`
+  vec(U8) object_flags;
+  // BVH leaf of each object with bounds, parallel to `objects`
+  vec(U32) object_proxies;
+  // Objects per flag combination, kept up to date so stats are O(1)
+  U32 archetype_counts[SCENEOBJECT_ARCHETYPES];
+
+  // Full hierarchical path ("Level/Enemies/Boss") of each object, parallel to
+  // `objects` and allocated from the scene arena. NULL for objects with an
+  // unnamed ancestor or no name.
+  vec(char *) object_paths;
+  // Path hash -> slot in `objects`
+  IndexMap path_slots;
+  ScenePathIndexStats path_stats;
+
+  // Only set for scenes loaded through `Scene.loadFromFileStreamed`
+  SceneStreamingData *streaming;
+
+  // Source of scenes loaded through `Scene.loadFromFile`, kept for hot-reload.
+  // The path lives in the scene arena; the parsed file is replaced on every
+  // reload.
+  char *sourcePath;
+  AssetHandle sourceFile;
+  evjson_t *sourceDesc;
 } GameSceneStruct;
 
+static const TransformComponent DefaultTransform = {
+  .position = { 0, 0, 0 },
+  .rotation = { 0, 0, 0, 1 },
+  .scale    = { 1, 1, 1 },
+};
+
 struct {
   GameComponentID RenderingComponentID;
   GameComponentID LightComponentID;
+
+  // Scratch space of the culling pass, reused across frames
+  vec(F32) cullSpheres; // Bounding spheres, laid out as x[], y[], z[], radius[]
+  vec(F32) lodDistances;
+  vec(U8) cullVisible;
+  vec(RenderComponent) visibleRenderComponents;
+  vec(LightComponent) visibleLightComponents;
+
+  // Frame's render objects, collected for batching
+  vec(RenderComponent) frameRenderComponents;
+  vec(WorldTransformComponent) frameWorldTransforms;
+  // Counting sort state: the bucket of each object, one representative
+  // component per bucket, and per-bucket counts turned into offsets
+  vec(U32) objectBuckets;
+  vec(RenderComponent) bucketKeys;
+  vec(U32) bucketOffsets;
+  IndexMap bucketSlots;
+  vec(RenderComponent) sortedRenderComponents;
+  vec(WorldTransformComponent) sortedWorldTransforms;
+  vec(WorldTransformComponent) visibleWorldTransforms;
 } RenderingData;
 
-void
-gamescenestruct_destr(
-    void *data)
-{
-  GameSceneStruct *scn = (GameSceneStruct *)data;
-  GameECS->destroyWorld(scn->ecs_world);
-  PhysicsWorld->destroyWorld(scn->physics_world);
-  ScriptContext->destroyContext(scn->script_context);
-}
+// Scratch space of `AnimationEvaluate`, reused across frames
+struct {
+  vec(U32) segments; // First key of the segment each playhead is in
+  vec(F32) weights; // Eased blend factor towards the segment's second key
+  vec(U8) evaluated;
+} AnimationData;
+
+typedef enum {
+  GAMECOMMAND_CREATE,
+  GAMECOMMAND_DESTROY,
+  GAMECOMMAND_SETTRANSFORM,
+  GAMECOMMAND_SETCOMPONENT,
+  GAMECOMMAND_SETPARENT,
+} GameCommandType;
 
-struct evGameData {
-  evolmodule_t ecs_module;
-  evolmodule_t physics_module;
-  evolmodule_t script_module;
-  evolmodule_t asset_module;
-  evolmodule_t renderer_module;
-  vec(GameSceneStruct) scenes;
-  Map(evstring, GameScene) scene_map;
-  GameScene activeScene;
-} GameData;
+typedef struct {
+  GameCommandType type;
+  GameScene scene;
+  GameObject object;
+  GameObject parent;
+  GameComponentID component;
+  U32 dataOffset; // Component data, in the buffer's `data`
+  U32 dataSize;
+  TransformComponent transform;
+} GameCommand;
 
-GameObject
-ev_scene_getobject(
-    GameScene scene_handle,
-    CONST_STR name);
-GameObject
-ev_scene_getactivecamera(
-    GameScene scene_handle);
-GameObject
-ev_scene_createchildobject(
-    GameScene scene_handle,
-    GameObject parent);
+typedef struct {
+  vec(GameCommand) commands;
+  vec(U8) data;
+} GameCommandPage;
 
-PhysicsWorldHandle
-ev_scene_getphysicsworld(
-    GameScene scene_handle);
-ECSGameWorldHandle
-ev_scene_getecsworld(
-    GameScene scene_handle);
-void
-worldtransform_update(
-    GameScene scene_handle,
-    GameObject entt);
+// One per recording thread. Only the owner appends to it, to the page
+// `page` points at; the sync point flips `page` and takes the other one over
+// (see commands_drain), so recording never takes a lock.
+typedef struct {
+  GameCommandPage pages[2];
+  atomic_uint page;
+  atomic_bool recording;
+  // Set by Commands.setThreadOrder, read at the sync point
+  atomic_uint order;
+  // Set when the owning thread exits; the buffer is freed once drained
+  atomic_bool exited;
+  U32 id;
+  U32 nextPlaceholder;
+} GameCommandBuffer;
+
+// Order of threads that never called Commands.setThreadOrder
+#define EV_GAME_COMMAND_UNORDERED (~0u)
 
-void
-ev_object_settransform(
-    GameScene scene_handle,
-    GameObject entt,
-    Vec3 new_pos,
-    Vec4 new_rot,
-    Vec3 new_scale);
+typedef struct {
+  U32 order;
+  U32 id;
+  bool exited;
+  GameCommandBuffer *buffer;
+} GameCommandBufferKey;
 
-void
-ev_object_setcomponent(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id,
-    PTR data);
+struct {
+  // Guards `buffers` and `nextBufferId`. Only taken when a thread records its
+  // first command and at the sync point.
+  pthread_mutex_t lock;
+  vec(GameCommandBuffer *) buffers;
+  U32 nextBufferId;
+  // Runs commands_threadexit for the buffer of every exiting thread
+  pthread_key_t threadKey;
+  // The thread that loaded the module; its commands come first by default
+  pthread_t mainThread;
+
+  // Sync point state, main thread only
+  vec(GameCommandBufferKey) sortedBuffers;
+  vec(GameCommand) applyCommands; // Every buffer's commands, in apply order
+  vec(U8) applyData;
+  vec(GameObject) createdObjects;
+  IndexMap placeholders; // Placeholder -> slot in `createdObjects`
+} CommandsData = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static _Thread_local GameCommandBuffer *ThreadCommandBuffer;
+
+typedef void (*QueryBatchFn)(PTR ctx, U32 begin, U32 end, vec(U32) *stack);
+
+// Persistent pool running batched spatial queries. The calling thread takes
+// part in every batch and waits for the workers before returning, so the
+// scene can't change under them.
+struct {
+  pthread_t threads[EV_GAME_QUERY_WORKERS];
+  U32 threadCount;
+  bool started;
+  bool shutdown;
 
-void
-ev_scene_setactivecamera(
-    GameScene scene_handle,
-    GameObject camera);
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  U64 generation;
+  U32 busyWorkers;
+
+  QueryBatchFn fn;
+  PTR ctx;
+  U32 itemCount;
+  U32 nextItem;
+
+  // BVH traversal stack of each worker, the last one being the caller's
+  vec(U32) stacks[EV_GAME_QUERY_WORKERS + 1];
+} QueryWorkers;
+
+#define INDEXMAP_INITIAL_CAPACITY 64
 
 void
-ev_game_setactivescene(
-    GameScene scene_handle)
+indexmap_init(
+    IndexMap *map)
 {
-  GameData.activeScene = scene_handle;
+  map->capacity = INDEXMAP_INITIAL_CAPACITY;
+  map->count = 0;
+  map->keys = calloc(map->capacity, sizeof(U64));
+  map->values = malloc(map->capacity * sizeof(U32));
 }
 
 void
-ev_game_clearscenes()
+indexmap_fini(
+    IndexMap *map)
 {
-  vec_clear(GameData.scenes);
-  Hashmap(evstring, GameScene).clear(GameData.scene_map);
-  GameData.activeScene = 0;
+  free(map->keys);
+  free(map->values);
+  map->keys = NULL;
+  map->values = NULL;
+  map->capacity = 0;
+  map->count = 0;
 }
 
 void
-ev_game_reload()
+indexmap_clear(
+    IndexMap *map)
 {
-  // TODO add more stuff as needed
-  ev_game_clearscenes();
+  memset(map->keys, 0, map->capacity * sizeof(U64));
+  map->count = 0;
+}
 
-  if(GameData.renderer_module) {
-    evol_unloadmodule(GameData.renderer_module);
-  }
-  GameData.renderer_module = evol_loadmodule("renderer");
-  if(GameData.renderer_module) {
-    imports(GameData.renderer_module, (Renderer, Material, GraphicsPipeline, Light));
-  }
+U32
+indexmap_bucket(
+    const IndexMap *map,
+    U64 key)
+{
+  // Fibonacci hashing; entity ids are mostly sequential
+  return (U32)((key * 11400714819323198485ULL) >> 32) & (map->capacity - 1);
 }
 
-GameScene
-ev_scene_create()
+bool
+indexmap_get(
+    const IndexMap *map,
+    U64 key,
+    U32 *out)
 {
-  GameSceneStruct newscene = {
-    .ecs_world = GameECS->newWorld(),
-    .physics_world = PhysicsWorld->newWorld(),
-    .script_context = ScriptContext->newContext(),
+  if(map->capacity == 0) {
+    return false;
+  }
 
-    .activeCamera = 0
-  };
+  for(U32 i = indexmap_bucket(map, key);; i = (i + 1) & (map->capacity - 1)) {
+    if(map->keys[i] == key) {
+      if(out) {
+        *out = map->values[i];
+      }
+      return true;
+    }
+    if(map->keys[i] == 0) {
+      return false;
+    }
+  }
+}
 
-  ev_log_trace("New game scene created: { .ecs_world = %llu, .physics_world = %llu, .activeCamera = %llu, .script_context = %llu }",
-      newscene.ecs_world,
-      newscene.physics_world,
-      newscene.activeCamera,
-      newscene.script_context);
+void
+indexmap_set(
+    IndexMap *map,
+    U64 key,
+    U32 value);
 
-  GameScene newscene_handle = vec_push((vec_t*)&GameData.scenes, &newscene);
-  ev_log_trace("New scene given handle { %llu }", newscene_handle);
-  if(GameData.activeScene == 0) {
-    GameData.activeScene = newscene_handle;
-    ev_log_trace("Active scene set to { %llu }", GameData.activeScene);
+void
+indexmap_grow(
+    IndexMap *map)
+{
+  IndexMap old = *map;
+  map->capacity = old.capacity * 2;
+  map->count = 0;
+  map->keys = calloc(map->capacity, sizeof(U64));
+  map->values = malloc(map->capacity * sizeof(U32));
+
+  for(U32 i = 0; i < old.capacity; i++) {
+    if(old.keys[i] != 0) {
+      indexmap_set(map, old.keys[i], old.values[i]);
+    }
   }
 
-  return newscene_handle;
+  free(old.keys);
+  free(old.values);
 }
 
 void
-ev_sceneloader_loadtransformcomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+indexmap_set(
+    IndexMap *map,
+    U64 key,
+    U32 value)
 {
-  Vec3 position = {0};
-  Vec3 rotation = {0};
-  Vec3 scale = {0};
+  // Keep the load factor under 3/4
+  if((map->count + 1) * 4 > map->capacity * 3) {
+    indexmap_grow(map);
+  }
 
-  evstring pos_id = evstring_newfmt("%s.position[x]", *comp_id);
-  size_t pos_id_len = evstring_len(pos_id);
-  for(size_t i = 0; i < 3; i++) {
-    pos_id[pos_id_len-2] = '0' + i;
-    ((float*)&position)[i] = (float)evjs_get(json, pos_id)->as_num;
+  U32 i = indexmap_bucket(map, key);
+  while(map->keys[i] != 0 && map->keys[i] != key) {
+    i = (i + 1) & (map->capacity - 1);
   }
+  if(map->keys[i] == 0) {
+    map->keys[i] = key;
+    map->count++;
+  }
+  map->values[i] = value;
+}
 
-  evstring rot_id = evstring_newfmt("%s.rotation[x]", *comp_id);
-  size_t rot_id_len = evstring_len(rot_id);
-  for(size_t i = 0; i < 3; i++) {
-    rot_id[rot_id_len-2] = '0'+i;
-    ((float*)&rotation)[i] = glm_rad((float)evjs_get(json,rot_id)->as_num);
+void
+indexmap_remove(
+    IndexMap *map,
+    U64 key)
+{
+  if(map->capacity == 0) {
+    return;
   }
 
-  evstring scale_id = evstring_newfmt("%s.scale[x]", *comp_id);
-  size_t scale_id_len = evstring_len(scale_id);
-  for(size_t i = 0; i < 3; i++) {
-    scale_id[scale_id_len-2] = '0'+i;
-    ((float*)&scale)[i] = (float)evjs_get(json,scale_id)->as_num;
+  U32 mask = map->capacity - 1;
+  U32 i = indexmap_bucket(map, key);
+  while(map->keys[i] != key) {
+    if(map->keys[i] == 0) {
+      return;
+    }
+    i = (i + 1) & mask;
   }
 
-  evstring_free(scale_id);
-  evstring_free(rot_id);
-  evstring_free(pos_id);
+  // Backward-shift deletion keeps probe sequences intact without tombstones
+  for(U32 j = (i + 1) & mask; map->keys[j] != 0; j = (j + 1) & mask) {
+    U32 home = indexmap_bucket(map, map->keys[j]);
+    if(((j - home) & mask) >= ((j - i) & mask)) {
+      map->keys[i] = map->keys[j];
+      map->values[i] = map->values[j];
+      i = j;
+    }
+  }
+  map->keys[i] = 0;
+  map->count--;
+}
 
-  // Build rotation quaternion from loaded euler angles
-  Vec4 rot_quat;
-  Matrix4x4 rotationMatrix;
-  glm_euler((float*)&rotation, rotationMatrix);
-  glm_mat4_quat(rotationMatrix, (float*)&rot_quat);
+#define SCENEARENA_CHUNK_SIZE (64 * 1024)
+#define SCENEARENA_ALIGN 16
 
-  ev_object_settransform(scene, obj, position, rot_quat, scale);
+void
+scenearena_init(
+    SceneArena *arena)
+{
+  *arena = (SceneArena){0};
 }
 
 void
-ev_sceneloader_loadscriptcomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+scenearena_fini(
+    SceneArena *arena)
 {
-  evstring scriptname_id = evstring_newfmt("%s.script_name", *comp_id);
-  evstring scriptpath_id = evstring_newfmt("%s.script_path", *comp_id);
-  evstring scriptname = evstring_refclone(evjs_get(json,scriptname_id)->as_str);
-  evstring scriptpath = evstring_refclone(evjs_get(json,scriptpath_id)->as_str);
+  SceneArenaChunk *chunk = arena->head;
+  while(chunk) {
+    SceneArenaChunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  *arena = (SceneArena){0};
+}
 
-  AssetHandle script_asset = Asset->load(scriptpath);
-  TextAsset script_text = TextLoader->loadAsset(script_asset);
-  ScriptHandle script_handle = Script->new(scriptname, script_text.text);
-  Asset->free(script_asset);
+// Returns the size class for `size`, or -1 if it is too large for one
+I32
+scenearena_sizeclass(
+    size_t size)
+{
+  size_t class_size = 16;
+  for(I32 i = 0; i < SCENEARENA_SIZE_CLASSES; i++, class_size <<= 1) {
+    if(size <= class_size) {
+      return i;
+    }
+  }
+  return -1;
+}
 
-  Script->addToEntity(scene, obj, script_handle);
+void *
+scenearena_alloc(
+    SceneArena *arena,
+    size_t size)
+{
+  I32 size_class = scenearena_sizeclass(size);
+  if(size_class >= 0) {
+    size = (size_t)16 << size_class;
+    if(arena->free_lists[size_class]) {
+      void *block = arena->free_lists[size_class];
+      arena->free_lists[size_class] = *(void **)block;
+      arena->stats.usedBytes += size;
+      arena->stats.recycledAllocations++;
+      return block;
+    }
+  }
+  size = (size + SCENEARENA_ALIGN - 1) & ~(size_t)(SCENEARENA_ALIGN - 1);
+
+  // The chunk header is padded to keep blocks aligned
+  size_t header_size = (sizeof(SceneArenaChunk) + SCENEARENA_ALIGN - 1) & ~(size_t)(SCENEARENA_ALIGN - 1);
+  SceneArenaChunk *chunk = arena->head;
+  if(chunk == NULL || chunk->size - chunk->used < size) {
+    size_t chunk_size = size > SCENEARENA_CHUNK_SIZE ? size : SCENEARENA_CHUNK_SIZE;
+    chunk = malloc(header_size + chunk_size);
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    chunk->next = arena->head;
+    arena->head = chunk;
+    arena->stats.reservedBytes += chunk_size;
+    arena->stats.chunkCount++;
+  }
 
-  evstring_free(scriptpath);
-  evstring_free(scriptname);
-  evstring_free(scriptname_id);
-  evstring_free(scriptpath_id);
+  void *block = (U8 *)chunk + header_size + chunk->used;
+  chunk->used += size;
+  arena->stats.usedBytes += size;
+  return block;
 }
 
+// Only size-classed blocks are recycled; larger ones stay reserved until the
+// arena is released.
 void
-ev_sceneloader_loadcameracomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+scenearena_free(
+    SceneArena *arena,
+    void *block,
+    size_t size)
 {
-  evstring cameraview_id = evstring_newfmt("%s.view", *comp_id);
-  evstr_ref cameraview = evjs_get(json,cameraview_id)->as_str;
+  I32 size_class = scenearena_sizeclass(size);
+  if(block == NULL || size_class < 0) {
+    return;
+  }
+  *(void **)block = arena->free_lists[size_class];
+  arena->free_lists[size_class] = block;
+  arena->stats.usedBytes -= (size_t)16 << size_class;
+}
 
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene);
-  CameraComponent comp;
+char *
+scenearena_strdup(
+    SceneArena *arena,
+    CONST_STR str)
+{
+  size_t len = strlen(str);
+  char *res = scenearena_alloc(arena, len + 1);
+  memcpy(res, str, len + 1);
+  return res;
+}
 
-  switch(*(cameraview.data + cameraview.offset)) {
-    case 'P':
-      comp.viewType = EV_CAMERA_VIEWTYPE_PERSPECTIVE;
+void
+scenearena_freestr(
+    SceneArena *arena,
+    char *str)
+{
+  if(str) {
+    scenearena_free(arena, str, strlen(str) + 1);
+  }
+}
 
-      evstring fov_id = evstring_newfmt("%s.fov", *comp_id);
-      evstring near_id = evstring_newfmt("%s.near", *comp_id);
-      evstring far_id = evstring_newfmt("%s.far", *comp_id);
-      evstring aspectratio_id = evstring_newfmt("%s.aspectRatio", *comp_id);
+void
+scenebvh_init(
+    SceneBVH *bvh)
+{
+  bvh->nodes = vec_init(SceneBVHNode, NULL, NULL);
+  bvh->stack = vec_init(U32, NULL, NULL);
+  bvh->results = vec_init(GameObject, NULL, NULL);
+  bvh->root = SCENEBVH_NULL;
+  bvh->freeList = SCENEBVH_NULL;
+  bvh->leafCount = 0;
+}
 
-      comp.hfov = (U32)evjs_get(json, fov_id)->as_num;
-      comp.nearPlane = (F32)evjs_get(json, near_id)->as_num;
-      comp.farPlane = (F32)evjs_get(json, far_id)->as_num;
-      comp.aspectRatio = (F32)evjs_get(json, aspectratio_id)->as_num;
+void
+scenebvh_fini(
+    SceneBVH *bvh)
+{
+  vec_fini(bvh->nodes);
+  vec_fini(bvh->stack);
+  vec_fini(bvh->results);
+}
 
-      evstring_free(fov_id);
-      evstring_free(near_id);
-      evstring_free(far_id);
-      evstring_free(aspectratio_id);
-      break;
-    case 'O':
-      comp.viewType = EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC;
-      // TODO Implement
-      UNIMPLEMENTED();
-      break;
-    default:
-      ev_log_error("Camera View type unknown `%.*s`", cameraview.len, cameraview.data + cameraview.offset);
-      break;
+U32
+scenebvh_allocnode(
+    SceneBVH *bvh)
+{
+  U32 idx;
+  if(bvh->freeList != SCENEBVH_NULL) {
+    idx = bvh->freeList;
+    bvh->freeList = bvh->nodes[idx].parent;
+  } else {
+    SceneBVHNode node = {0};
+    idx = (U32)vec_push((vec_t*)&bvh->nodes, &node);
   }
 
-  GameECS->setComponent(ecs_world, obj, CameraComponentID, &comp);
-
-  evstring_free(cameraview_id);
+  SceneBVHNode *node = &bvh->nodes[idx];
+  node->parent = SCENEBVH_NULL;
+  node->child1 = SCENEBVH_NULL;
+  node->child2 = SCENEBVH_NULL;
+  node->height = 0;
+  node->object = 0;
+  return idx;
 }
 
 void
-ev_sceneloader_loadrigidbodycomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+scenebvh_freenode(
+    SceneBVH *bvh,
+    U32 idx)
 {
-  evstring SphereCollisionShapeSTR = evstring_literal("Sphere");
-  evstring BoxCollisionShapeSTR = evstring_literal("Box");
-  evstring CapsuleCollisionShapeSTR = evstring_literal("Capsule");
-  evstring MeshCollisionShapeSTR = evstring_literal("Mesh");
+  bvh->nodes[idx].parent = bvh->freeList;
+  bvh->nodes[idx].height = -1;
+  bvh->freeList = idx;
+}
 
-  RigidbodyInfo info;
+// Half the surface area, which is all the insertion cost needs
+F32
+scenebvh_area(
+    const F32 min[3],
+    const F32 max[3])
+{
+  F32 dx = max[0] - min[0];
+  F32 dy = max[1] - min[1];
+  F32 dz = max[2] - min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
 
-  evstring rigidbodytype_id = evstring_newfmt("%s.rigidbodyType", *comp_id);
-  evstr_ref rigidbodyType = evjs_get(json,rigidbodytype_id)->as_str;
-  switch(*(rigidbodyType.data + rigidbodyType.offset)) {
-    case 'D':
-      info.type = EV_RIGIDBODY_DYNAMIC;
-      break;
-    case 'S':
-      info.type = EV_RIGIDBODY_STATIC;
-      break;
-    case 'K':
-      info.type = EV_RIGIDBODY_KINEMATIC;
-      break;
-    case 'G':
-      info.type = EV_RIGIDBODY_GHOST;
-      break;
-    default:
-      ev_log_warn("Unidentified RigidbodyType `%.*s`. Falling back to `Kinematic`", rigidbodyType.len, (rigidbodyType.data + rigidbodyType.offset));
-      info.type = EV_RIGIDBODY_KINEMATIC;
-      break;
+void
+scenebvh_merge(
+    const SceneBVHNode *a,
+    const SceneBVHNode *b,
+    F32 out_min[3],
+    F32 out_max[3])
+{
+  for(U32 i = 0; i < 3; i++) {
+    out_min[i] = a->min[i] < b->min[i] ? a->min[i] : b->min[i];
+    out_max[i] = a->max[i] > b->max[i] ? a->max[i] : b->max[i];
   }
-  evstring_free(rigidbodytype_id);
-
-  evstring mass_id = evstring_newfmt("%s.mass", *comp_id);
-  info.mass = (F32)evjs_get(json, mass_id)->as_num;
-  evstring_free(mass_id);
+}
 
-  evstring restitution_id = evstring_newfmt("%s.restitution", *comp_id);
-  info.restitution = (F32)evjs_get(json, restitution_id)->as_num;
-  evstring_free(restitution_id);
+bool
+scenebvh_contains(
+    const SceneBVHNode *node,
+    const F32 min[3],
+    const F32 max[3])
+{
+  return node->min[0] <= min[0] && node->min[1] <= min[1] && node->min[2] <= min[2]
+      && node->max[0] >= max[0] && node->max[1] >= max[1] && node->max[2] >= max[2];
+}
 
+void
+scenebvh_fixnode(
+    SceneBVH *bvh,
+    U32 idx)
+{
+  SceneBVHNode *node = &bvh->nodes[idx];
+  SceneBVHNode *child1 = &bvh->nodes[node->child1];
+  SceneBVHNode *child2 = &bvh->nodes[node->child2];
+  node->height = 1 + (child1->height > child2->height ? child1->height : child2->height);
+  scenebvh_merge(child1, child2, node->min, node->max);
+}
 
-  evstring collisionshapetype_id = evstring_newfmt("%s.collisionShape.type", *comp_id);
-  evstring collisionshapetype = evstring_refclone(evjs_get(json, collisionshapetype_id)->as_str);
+// Rotates the subtree at `iA` if it is imbalanced and returns its new root
+U32
+scenebvh_balance(
+    SceneBVH *bvh,
+    U32 iA)
+{
+  SceneBVHNode *A = &bvh->nodes[iA];
+  if(A->height < 2) {
+    return iA;
+  }
 
-  PhysicsWorldHandle physWorld = ev_scene_getphysicsworld(scene);
-  CollisionShapeHandle collShapeHandle = NULL;
-  if(!evstring_cmp(collisionshapetype, SphereCollisionShapeSTR)) {
-    evstring radius_id = evstring_newfmt("%s.collisionShape.radius", *comp_id);
-    F32 radius = (F32)evjs_get(json, radius_id)->as_num;
-    collShapeHandle = CollisionShape->newSphere(physWorld, radius);
-    evstring_free(radius_id);
-  } else if(!evstring_cmp(collisionshapetype, BoxCollisionShapeSTR)) {
-    Vec3 halfExtents;
-    evstring halfextents_id = evstring_newfmt("%s.collisionShape.halfExtents[x]", *comp_id);
-    size_t halfextents_id_len = evstring_len(halfextents_id);
-    for(size_t i = 0; i < 3; i++) {
-      halfextents_id[halfextents_id_len-2] = '0' + i;
-      ((float*)&halfExtents)[i] = (float)evjs_get(json, halfextents_id)->as_num;
+  U32 iB = A->child1;
+  U32 iC = A->child2;
+  SceneBVHNode *B = &bvh->nodes[iB];
+  SceneBVHNode *C = &bvh->nodes[iC];
+  I32 balance = C->height - B->height;
+
+  // Rotate C up
+  if(balance > 1) {
+    U32 iF = C->child1;
+    U32 iG = C->child2;
+    SceneBVHNode *F = &bvh->nodes[iF];
+    SceneBVHNode *G = &bvh->nodes[iG];
+
+    C->child1 = iA;
+    C->parent = A->parent;
+    A->parent = iC;
+    if(C->parent != SCENEBVH_NULL) {
+      if(bvh->nodes[C->parent].child1 == iA) {
+        bvh->nodes[C->parent].child1 = iC;
+      } else {
+        bvh->nodes[C->parent].child2 = iC;
+      }
+    } else {
+      bvh->root = iC;
     }
-    evstring_free(halfextents_id);
 
-    collShapeHandle = CollisionShape->newBox(physWorld, halfExtents);
+    if(F->height > G->height) {
+      C->child2 = iF;
+      A->child2 = iG;
+      G->parent = iA;
+    } else {
+      C->child2 = iG;
+      A->child2 = iF;
+      F->parent = iA;
+    }
+    scenebvh_fixnode(bvh, iA);
+    scenebvh_fixnode(bvh, iC);
+    return iC;
+  }
 
-  } else if(!evstring_cmp(collisionshapetype, CapsuleCollisionShapeSTR)) {
-    evstring radius_id = evstring_newfmt("%s.collisionShape.radius", *comp_id);
-    evstring height_id = evstring_newfmt("%s.collisionShape.height", *comp_id);
-    F32 radius = (F32)evjs_get(json, radius_id)->as_num;
-    F32 height = (F32)evjs_get(json, height_id)->as_num;
+  // Rotate B up
+  if(balance < -1) {
+    U32 iD = B->child1;
+    U32 iE = B->child2;
+    SceneBVHNode *D = &bvh->nodes[iD];
+    SceneBVHNode *E = &bvh->nodes[iE];
+
+    B->child1 = iA;
+    B->parent = A->parent;
+    A->parent = iB;
+    if(B->parent != SCENEBVH_NULL) {
+      if(bvh->nodes[B->parent].child1 == iA) {
+        bvh->nodes[B->parent].child1 = iB;
+      } else {
+        bvh->nodes[B->parent].child2 = iB;
+      }
+    } else {
+      bvh->root = iB;
+    }
 
-    collShapeHandle = CollisionShape->newCapsule(physWorld, radius, height);
+    if(D->height > E->height) {
+      B->child2 = iD;
+      A->child1 = iE;
+      E->parent = iA;
+    } else {
+      B->child2 = iE;
+      A->child1 = iD;
+      D->parent = iA;
+    }
+    scenebvh_fixnode(bvh, iA);
+    scenebvh_fixnode(bvh, iB);
+    return iB;
+  }
 
-    evstring_free(radius_id);
-    evstring_free(height_id);
-  } else if(!evstring_cmp(collisionshapetype, MeshCollisionShapeSTR)) {
-    evstring meshpath_id = evstring_newfmt("%s.collisionShape.meshPath", *comp_id);
-    evstring meshpath = evstring_refclone(evjs_get(json, meshpath_id)->as_str);
+  return iA;
+}
 
-    collShapeHandle = CollisionShape->newMesh(physWorld, meshpath);
+// Refits (and rebalances) every ancestor of a node that changed
+void
+scenebvh_refit(
+    SceneBVH *bvh,
+    U32 idx)
+{
+  while(idx != SCENEBVH_NULL) {
+    idx = scenebvh_balance(bvh, idx);
+    scenebvh_fixnode(bvh, idx);
+    idx = bvh->nodes[idx].parent;
+  }
+}
 
-    evstring_free(meshpath);
-    evstring_free(meshpath_id);
+void
+scenebvh_insertleaf(
+    SceneBVH *bvh,
+    U32 leaf)
+{
+  if(bvh->root == SCENEBVH_NULL) {
+    bvh->root = leaf;
+    bvh->nodes[leaf].parent = SCENEBVH_NULL;
+    return;
   }
 
-  info.collisionShape = collShapeHandle;
+  // Walk down picking the child with the cheapest surface area increase
+  SceneBVHNode leafNode = bvh->nodes[leaf];
+  U32 idx = bvh->root;
+  while(bvh->nodes[idx].height > 0) {
+    SceneBVHNode *node = &bvh->nodes[idx];
+    F32 combined_min[3], combined_max[3];
+    scenebvh_merge(node, &leafNode, combined_min, combined_max);
+    F32 combined_area = scenebvh_area(combined_min, combined_max);
+
+    // Cost of pairing the leaf with this node, and the minimum cost that
+    // pushing it further down adds to every ancestor
+    F32 cost = 2.f * combined_area;
+    F32 inheritance_cost = 2.f * (combined_area - scenebvh_area(node->min, node->max));
+
+    F32 child_costs[2];
+    U32 children[2] = { node->child1, node->child2 };
+    for(U32 i = 0; i < 2; i++) {
+      SceneBVHNode *child = &bvh->nodes[children[i]];
+      scenebvh_merge(child, &leafNode, combined_min, combined_max);
+      child_costs[i] = scenebvh_area(combined_min, combined_max) + inheritance_cost;
+      if(child->height > 0) {
+        child_costs[i] -= scenebvh_area(child->min, child->max);
+      }
+    }
 
-  Rigidbody->addToEntity(scene, obj, info);
+    if(cost < child_costs[0] && cost < child_costs[1]) {
+      break;
+    }
+    idx = child_costs[0] < child_costs[1] ? children[0] : children[1];
+  }
 
-  evstring_free(collisionshapetype);
-  evstring_free(collisionshapetype_id);
+  U32 sibling = idx;
+  U32 old_parent = bvh->nodes[sibling].parent;
+  U32 new_parent = scenebvh_allocnode(bvh);
+  SceneBVHNode *parentNode = &bvh->nodes[new_parent];
+  parentNode->parent = old_parent;
+  parentNode->child1 = sibling;
+  parentNode->child2 = leaf;
+  bvh->nodes[sibling].parent = new_parent;
+  bvh->nodes[leaf].parent = new_parent;
+
+  if(old_parent != SCENEBVH_NULL) {
+    if(bvh->nodes[old_parent].child1 == sibling) {
+      bvh->nodes[old_parent].child1 = new_parent;
+    } else {
+      bvh->nodes[old_parent].child2 = new_parent;
+    }
+  } else {
+    bvh->root = new_parent;
+  }
+
+  scenebvh_refit(bvh, new_parent);
 }
 
 void
-ev_sceneloader_loadrendercomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+scenebvh_removeleaf(
+    SceneBVH *bvh,
+    U32 leaf)
 {
-  evstring meshPath_jsonid = evstring_newfmt("%s.mesh", *comp_id);
-  evstring materialName_jsonid = evstring_newfmt("%s.material", *comp_id);
-
-  evstring meshPath = evstring_refclone(evjs_get(json, meshPath_jsonid)->as_str);
-  evstring materialName = evstring_refclone(evjs_get(json, materialName_jsonid)->as_str);
+  if(leaf == bvh->root) {
+    bvh->root = SCENEBVH_NULL;
+    return;
+  }
 
-  RenderComponent newRenderComponent = Renderer->registerComponent(meshPath, materialName);
-  ev_object_setcomponent(scene, obj, RenderingData.RenderingComponentID, &newRenderComponent);
+  U32 parent = bvh->nodes[leaf].parent;
+  U32 grand_parent = bvh->nodes[parent].parent;
+  U32 sibling = bvh->nodes[parent].child1 == leaf ? bvh->nodes[parent].child2 : bvh->nodes[parent].child1;
 
-  evstring_free(meshPath);
-  evstring_free(materialName);
+  bvh->nodes[sibling].parent = grand_parent;
+  scenebvh_freenode(bvh, parent);
+  if(grand_parent == SCENEBVH_NULL) {
+    bvh->root = sibling;
+    return;
+  }
 
-  evstring_free(meshPath_jsonid);
-  evstring_free(materialName_jsonid);
+  if(bvh->nodes[grand_parent].child1 == parent) {
+    bvh->nodes[grand_parent].child1 = sibling;
+  } else {
+    bvh->nodes[grand_parent].child2 = sibling;
+  }
+  scenebvh_refit(bvh, grand_parent);
 }
 
 void
-ev_sceneloader_loadlightcomponent(
-    GameScene scene,
-    GameObject obj,
-    evjson_t *json,
-    evstring *comp_id)
+scenebvh_setleafbounds(
+    SceneBVHNode *leaf,
+    const F32 min[3],
+    const F32 max[3])
 {
-  ev_log_debug("a light was found!");
-  LightComponent newLightComponent = Light->registerComponent(json, *comp_id);
-  ev_object_setcomponent(scene, obj, RenderingData.LightComponentID, &newLightComponent);
+  for(U32 i = 0; i < 3; i++) {
+    leaf->objectMin[i] = min[i];
+    leaf->objectMax[i] = max[i];
+    leaf->min[i] = min[i] - SCENEBVH_MARGIN;
+    leaf->max[i] = max[i] + SCENEBVH_MARGIN;
+  }
 }
 
-GameObject
-ev_scene_createobject(
-    GameScene scene_handle);
+U32
+scenebvh_createproxy(
+    SceneBVH *bvh,
+    GameObject object,
+    const F32 min[3],
+    const F32 max[3])
+{
+  U32 leaf = scenebvh_allocnode(bvh);
+  bvh->nodes[leaf].object = object;
+  scenebvh_setleafbounds(&bvh->nodes[leaf], min, max);
+  scenebvh_insertleaf(bvh, leaf);
+  bvh->leafCount++;
+  return leaf;
+}
 
-GameObject
-ev_sceneloader_loadnode(
-    GameScene scene,
-    evjson_t *json,
-    evstring *id,
-    GameObject parent);
+void
+scenebvh_destroyproxy(
+    SceneBVH *bvh,
+    U32 leaf)
+{
+  scenebvh_removeleaf(bvh, leaf);
+  scenebvh_freenode(bvh, leaf);
+  bvh->leafCount--;
+}
 
-GameObject
-ev_sceneloader_loadprefab(
-    GameScene scene,
-    CONST_STR prefabPath)
+// The tree is only touched when the new bounds leave the fattened box
+void
+scenebvh_moveproxy(
+    SceneBVH *bvh,
+    U32 leaf,
+    const F32 min[3],
+    const F32 max[3])
 {
-  AssetHandle prefabAsset = Asset->load(prefabPath);
-  JSONAsset prefabData = JSONLoader->loadAsset(prefabAsset);
+  SceneBVHNode *node = &bvh->nodes[leaf];
+  if(scenebvh_contains(node, min, max)) {
+    memcpy(node->objectMin, min, sizeof(node->objectMin));
+    memcpy(node->objectMax, max, sizeof(node->objectMax));
+    return;
+  }
 
-  GameObject node = ev_sceneloader_loadnode(scene, prefabData.json_data, NULL, 0);
+  scenebvh_removeleaf(bvh, leaf);
+  scenebvh_setleafbounds(&bvh->nodes[leaf], min, max);
+  scenebvh_insertleaf(bvh, leaf);
+}
 
-  Asset->free(prefabAsset);
+void
+scenelights_init(
+    SceneLightData *lights)
+{
+  lights->frameIndices = vec_init(U32, NULL, NULL);
+  lights->frameSpheres = vec_init(Vec4, NULL, NULL);
+  lights->clusterOffsets = vec_init(U32, NULL, NULL);
+  lights->clusterCounts = vec_init(U32, NULL, NULL);
+  lights->clusterIndices = vec_init(U32, NULL, NULL);
+  lights->clusterRanges = vec_init(SceneLightClusterRange, NULL, NULL);
+}
 
-  return node;
+void
+scenelights_fini(
+    SceneLightData *lights)
+{
+  vec_fini(lights->frameIndices);
+  vec_fini(lights->frameSpheres);
+  vec_fini(lights->clusterOffsets);
+  vec_fini(lights->clusterCounts);
+  vec_fini(lights->clusterIndices);
+  vec_fini(lights->clusterRanges);
 }
 
-GameObject
-ev_sceneloader_loadnode(
-    GameScene scene,
-    evjson_t *json,
-    evstring *id,
-    GameObject parent)
+void
+scenestatic_init(
+    SceneStaticData *statics)
 {
-  evstring TransformComponentSTR = evstring_literal("TransformComponent");
-  evstring RigidbodyComponentSTR = evstring_literal("RigidbodyComponent");
-  evstring ScriptComponentSTR = evstring_literal("ScriptComponent");
-  evstring CameraComponentSTR = evstring_literal("CameraComponent");
-  evstring RenderComponentSTR = evstring_literal("RenderComponent");
-  evstring LightComponentSTR = evstring_literal("LightComponent");
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene);
+  statics->objects = vec_init(GameObject, NULL, NULL);
+  statics->renderComponents = vec_init(RenderComponent, NULL, NULL);
+  statics->worldTransforms = vec_init(WorldTransformComponent, NULL, NULL);
+  statics->spheres = vec_init(Vec4, NULL, NULL);
+  indexmap_init(&statics->slots);
+}
 
-  GameObject obj;
-  if(parent == 0) {
-    obj = ev_scene_createobject(scene);
-  } else {
-    obj = ev_scene_createchildobject(scene, parent);
-  }
+void
+scenestatic_fini(
+    SceneStaticData *statics)
+{
+  vec_fini(statics->objects);
+  vec_fini(statics->renderComponents);
+  vec_fini(statics->worldTransforms);
+  vec_fini(statics->spheres);
+  indexmap_fini(&statics->slots);
+}
 
-  evstring prefix;
-  if(id) {
-    prefix = evstring_clone(*id);
-    evstring_pushchar(&prefix, '.');
-  } else {
-    prefix = evstring_new("");
-  }
+void
+scenetransformview_init(
+    SceneTransformViewData *view)
+{
+  view->objects = vec_init(GameObject, NULL, NULL);
+  view->valid = vec_init(bool, NULL, NULL);
+  view->positions = vec_init(Vec3, NULL, NULL);
+  view->eulerAngles = vec_init(Vec3, NULL, NULL);
+  view->forwards = vec_init(Vec3, NULL, NULL);
+  view->worldPositions = vec_init(Vec3, NULL, NULL);
+  view->readPositions = vec_init(Vec3, NULL, NULL);
+  view->readEulerAngles = vec_init(Vec3, NULL, NULL);
+}
 
-  evstring nodename_id = evstring_newfmt("%sid", prefix);
-  evjson_entry *nodename_entry = evjs_get(json, nodename_id);
-  if(nodename_entry) {
-    evstring nodename = evstring_refclone(nodename_entry->as_str);
-    GameECS->setEntityName(ecs_world, obj, nodename);
-    evstring_free(nodename);
-  }
-  evstring_free(nodename_id);
+void
+scenetransformview_fini(
+    SceneTransformViewData *view)
+{
+  vec_fini(view->objects);
+  vec_fini(view->valid);
+  vec_fini(view->positions);
+  vec_fini(view->eulerAngles);
+  vec_fini(view->forwards);
+  vec_fini(view->worldPositions);
+  vec_fini(view->readPositions);
+  vec_fini(view->readEulerAngles);
+}
 
-  evstring components_id = evstring_newfmt("%scomponents", prefix);
-  evstring components_count_id = evstring_newfmt("%s.len", components_id);
+void
+scenequerybatch_init(
+    SceneQueryBatchData *batch)
+{
+  batch->rays = vec_init(SceneRaycastQuery, NULL, NULL);
+  batch->rayHits = vec_init(SceneBoundsHit, NULL, NULL);
+  batch->overlaps = vec_init(SceneOverlapQuery, NULL, NULL);
+  batch->overlapCounts = vec_init(U32, NULL, NULL);
+  batch->overlapResults = vec_init(GameObject, NULL, NULL);
+}
 
-  int components_count = (int)evjs_get(json, components_count_id)->as_num;
-  for(int i = 0; i < components_count; i++) {
-    evstring component_id = evstring_newfmt("%s[%d]", components_id, i);
-    evstring component_type_id = evstring_newfmt("%s.type", component_id);
-    evstring component_type = evstring_refclone(evjs_get(json, component_type_id)->as_str);
+void
+scenequerybatch_fini(
+    SceneQueryBatchData *batch)
+{
+  vec_fini(batch->rays);
+  vec_fini(batch->rayHits);
+  vec_fini(batch->overlaps);
+  vec_fini(batch->overlapCounts);
+  vec_fini(batch->overlapResults);
+}
+
+void
+sceneprefabpool_destr(
+    void *data)
+{
+  ScenePrefabPool *pool = (ScenePrefabPool *)data;
+  vec_fini(pool->templateTransforms);
+  vec_fini(pool->templateMasks);
+  vec_fini(pool->templateData);
+  vec_fini(pool->available);
+}
+
+void
+sceneprefabpools_init(
+    ScenePrefabPools *prefab_pools)
+{
+  prefab_pools->pools = vec_init(ScenePrefabPool, NULL, sceneprefabpool_destr);
+  indexmap_init(&prefab_pools->poolSlots);
+  indexmap_init(&prefab_pools->objectPools);
+  prefab_pools->walk = vec_init(GameObject, NULL, NULL);
+}
+
+void
+sceneprefabpools_fini(
+    ScenePrefabPools *prefab_pools)
+{
+  vec_fini(prefab_pools->pools);
+  indexmap_fini(&prefab_pools->poolSlots);
+  indexmap_fini(&prefab_pools->objectPools);
+  vec_fini(prefab_pools->walk);
+}
+
+void
+scenedestroyqueue_init(
+    SceneDestroyQueue *queue)
+{
+  queue->queued = vec_init(GameObject, NULL, NULL);
+  indexmap_init(&queue->queuedSet);
+  queue->entries = vec_init(SceneDestroyEntry, NULL, NULL);
+  queue->stack = vec_init(SceneDestroyEntry, NULL, NULL);
+  indexmap_init(&queue->visited);
+}
+
+void
+scenedestroyqueue_fini(
+    SceneDestroyQueue *queue)
+{
+  vec_fini(queue->queued);
+  indexmap_fini(&queue->queuedSet);
+  vec_fini(queue->entries);
+  vec_fini(queue->stack);
+  indexmap_fini(&queue->visited);
+}
+
+void
+scenereplicationframe_init(
+    SceneReplicationFrame *frame)
+{
+  frame->frame = 0;
+  frame->componentTypes = vec_init(SceneReplicationComponent, NULL, NULL);
+  frame->componentStride = 0;
+  frame->objects = vec_init(GameObject, NULL, NULL);
+  frame->transforms = vec_init(SceneReplicationTransform, NULL, NULL);
+  frame->components = vec_init(U8, NULL, NULL);
+}
+
+void
+scenereplicationframe_fini(
+    SceneReplicationFrame *frame)
+{
+  vec_fini(frame->componentTypes);
+  vec_fini(frame->objects);
+  vec_fini(frame->transforms);
+  vec_fini(frame->components);
+}
+
+void
+scenereplication_init(
+    SceneReplicationData *replication)
+{
+  replication->components = vec_init(SceneReplicationComponent, NULL, NULL);
+  replication->frameCounter = 0;
+  for(U32 i = 0; i < EV_GAME_REPLICATION_HISTORY; i++) {
+    scenereplicationframe_init(&replication->history[i]);
+  }
+  replication->writer = (ReplicationBitWriter){
+    .bytes = vec_init(U8, NULL, NULL),
+  };
+  replication->removed = vec_init(GameObject, NULL, NULL);
+  replication->changed = vec_init(U32, NULL, NULL);
+  replication->baseSlots = vec_init(U32, NULL, NULL);
+}
+
+void
+scenereplication_fini(
+    SceneReplicationData *replication)
+{
+  vec_fini(replication->components);
+  for(U32 i = 0; i < EV_GAME_REPLICATION_HISTORY; i++) {
+    scenereplicationframe_fini(&replication->history[i]);
+  }
+  vec_fini(replication->writer.bytes);
+  vec_fini(replication->removed);
+  vec_fini(replication->changed);
+  vec_fini(replication->baseSlots);
+}
+
+void
+scenestreamingcell_destr(
+    void *data)
+{
+  SceneStreamingCell *cell = (SceneStreamingCell *)data;
+  vec_fini(cell->nodes);
+  vec_fini(cell->objects);
+}
+
+void
+gamescenestruct_destr(
+    void *data)
+{
+  GameSceneStruct *scn = (GameSceneStruct *)data;
+  if(!scn->alive) {
+    return;
+  }
+  if(scn->streaming) {
+    vec_fini(scn->streaming->cells);
+    indexmap_fini(&scn->streaming->cellSlots);
+    Asset->free(scn->streaming->scenefile);
+  }
+  if(scn->sourceDesc) {
+    Asset->free(scn->sourceFile);
+  }
+  if(scn->objects) {
+    vec_fini(scn->object_paths);
+    vec_fini(scn->object_flags);
+    vec_fini(scn->object_proxies);
+    scenebvh_fini(&scn->bvh);
+    scenelights_fini(&scn->lights);
+    scenestatic_fini(&scn->statics);
+    scenetransformview_fini(&scn->transform_view);
+    scenequerybatch_fini(&scn->query_batch);
+    sceneprefabpools_fini(&scn->prefab_pools);
+    scenedestroyqueue_fini(&scn->destroy_queue);
+    scenereplication_fini(&scn->replication);
+    indexmap_fini(&scn->path_slots);
+    vec_fini(scn->objects);
+    indexmap_fini(&scn->object_slots);
+  }
+  // Object paths, the source path and streaming bookkeeping all go with it
+  scenearena_fini(&scn->arena);
+  GameECS->destroyWorld(scn->ecs_world);
+  PhysicsWorld->destroyWorld(scn->physics_world);
+  ScriptContext->destroyContext(scn->script_context);
+}
+
+struct evGameData {
+  evolmodule_t ecs_module;
+  evolmodule_t physics_module;
+  evolmodule_t script_module;
+  evolmodule_t asset_module;
+  evolmodule_t renderer_module;
+  vec(GameSceneStruct) scenes;
+  vec(U32) free_scene_slots;
+  Map(evstring, GameScene) scene_map;
+  GameScene activeScene;
+  // Time step of the frame in progress, for systems that need it
+  F32 deltaTime;
+} GameData;
+
+// A scene handle packs the scene's slot in `GameData.scenes` in the low 32
+// bits and the slot's generation in the high 32 bits. Slot 0 is reserved so
+// that handle 0 can mean "the active scene".
+#define EV_GAME_SCENE_HANDLE(idx, gen) ((GameScene)(gen) << 32 | (GameScene)(idx))
+#define EV_GAME_SCENE_INDEX(handle) ((U32)((handle) & 0xFFFFFFFFull))
+#define EV_GAME_SCENE_GENERATION(handle) ((U32)((handle) >> 32))
+
+// NULL for stale handles, without logging: lookups through a destroyed
+// scene's handle are expected and can happen every frame.
+GameSceneStruct *
+ev_game_getscene(
+    GameScene scene_handle)
+{
+  GameScene handle = scene_handle?scene_handle:GameData.activeScene;
+  U32 idx = EV_GAME_SCENE_INDEX(handle);
+  if(idx == 0 || idx >= vec_len((vec_t*)&GameData.scenes)) {
+    return NULL;
+  }
+
+  GameSceneStruct *scene = &GameData.scenes[idx];
+  if(!scene->alive || scene->generation != EV_GAME_SCENE_GENERATION(handle)) {
+    return NULL;
+  }
+  return scene;
+}
+
+// Declares `scene` for `scene_handle`, returning `retval` from the calling
+// function if the handle is stale. Public accessors start with one of these
+// so that a destroyed scene yields a neutral value instead of a crash.
+#define GET_SCENE_OR_RETURN(scene, scene_handle, retval) \
+  GameSceneStruct *scene = ev_game_getscene(scene_handle); \
+  if(scene == NULL) { \
+    return retval; \
+  }
+#define GET_SCENE_OR_RETURN_VOID(scene, scene_handle) \
+  GameSceneStruct *scene = ev_game_getscene(scene_handle); \
+  if(scene == NULL) { \
+    return; \
+  }
+
+// Scene of the subtree walk in progress. forEachChild callbacks only get the
+// ECS world, so the scene is resolved once by scene_walk instead of on every
+// visited object.
+static GameSceneStruct *SceneWalkScene;
+
+void
+scene_walk(
+    GameSceneStruct *scene,
+    GameObject obj,
+    void (*fn)(ECSGameWorldHandle, GameEntityID))
+{
+  // Walks can start other walks of the same scene
+  GameSceneStruct *previous = SceneWalkScene;
+  SceneWalkScene = scene;
+  fn(scene->ecs_world, obj);
+  SceneWalkScene = previous;
+}
+
+GameScene
+scene_gethandle(
+    const GameSceneStruct *scene)
+{
+  return EV_GAME_SCENE_HANDLE((U32)(scene - GameData.scenes), scene->generation);
+}
+
+void
+sceneobjects_register(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  U32 slot = (U32)vec_push((vec_t*)&scene->objects, &obj);
+  char *no_path = NULL;
+  vec_push((vec_t*)&scene->object_paths, &no_path);
+  U8 no_flags = 0;
+  vec_push((vec_t*)&scene->object_flags, &no_flags);
+  U32 no_proxy = SCENEBVH_NULL;
+  vec_push((vec_t*)&scene->object_proxies, &no_proxy);
+  scene->archetype_counts[0]++;
+  indexmap_set(&scene->object_slots, obj, slot);
+}
+
+void
+sceneobjects_addflags(
+    GameSceneStruct *scene,
+    GameObject obj,
+    U8 flags)
+{
+  U32 slot;
+  if(scene == NULL || !indexmap_get(&scene->object_slots, obj, &slot)) {
+    return;
+  }
+  U8 old_flags = scene->object_flags[slot];
+  U8 new_flags = old_flags | flags;
+  if(new_flags != old_flags) {
+    scene->archetype_counts[old_flags]--;
+    scene->archetype_counts[new_flags]++;
+    scene->object_flags[slot] = new_flags;
+  }
+}
+
+void
+sceneobjects_removeflags(
+    GameSceneStruct *scene,
+    GameObject obj,
+    U8 flags)
+{
+  U32 slot;
+  if(scene == NULL || !indexmap_get(&scene->object_slots, obj, &slot)) {
+    return;
+  }
+  U8 old_flags = scene->object_flags[slot];
+  U8 new_flags = old_flags & ~flags;
+  if(new_flags != old_flags) {
+    scene->archetype_counts[old_flags]--;
+    scene->archetype_counts[new_flags]++;
+    scene->object_flags[slot] = new_flags;
+  }
+}
+
+// Teleports the object's rigidbody (if any) to its new local transform so
+// that moving an object is a single call for scripts and other modules. The
+// physics module is asked directly: bodies attached outside of the scene
+// loader don't carry SCENEOBJECT_FLAG_RIGIDBODY.
+void
+sceneobjects_syncrigidbody(
+    GameScene scene_handle,
+    GameObject obj,
+    const TransformComponent *transform,
+    bool syncPosition,
+    bool syncRotation)
+{
+  RigidbodyHandle rb = Rigidbody->getFromEntity(scene_handle, obj);
+  if(rb == 0) {
+    return;
+  }
+  if(syncPosition) {
+    Rigidbody->setPosition(rb, transform->position);
+  }
+  if(syncRotation) {
+    Rigidbody->setRotation(rb, transform->rotation);
+  }
+}
+
+U8
+sceneobjects_componentflag(
+    GameComponentID comp_id)
+{
+  if(comp_id == CameraComponentID) {
+    return SCENEOBJECT_FLAG_CAMERA;
+  }
+  if(comp_id == RenderingData.RenderingComponentID) {
+    return SCENEOBJECT_FLAG_RENDER;
+  }
+  if(comp_id == RenderingData.LightComponentID) {
+    return SCENEOBJECT_FLAG_LIGHT;
+  }
+  return 0;
+}
+
+// FNV-1a, never 0 as that marks empty IndexMap buckets
+U64
+scenepaths_hash(
+    CONST_STR path)
+{
+  U64 hash = 14695981039346656037ULL;
+  for(CONST_STR p = path; *p; p++) {
+    hash ^= (U8)*p;
+    hash *= 1099511628211ULL;
+  }
+  return hash ? hash : 1;
+}
+
+// Finds an object other than `slot` whose path hashes to `hash`, or ~0u. Such
+// objects were shadowed in `path_slots` by a later object with the same (or a
+// colliding) path, so this only scans the table while there are any.
+U32
+scenepaths_findshadowed(
+    GameSceneStruct *scene,
+    U64 hash,
+    U32 slot)
+{
+  if(scene->path_stats.shadowedPaths == 0) {
+    return ~0u;
+  }
+  U32 object_count = (U32)vec_len((vec_t*)&scene->objects);
+  for(U32 i = 0; i < object_count; i++) {
+    if(i != slot && scene->object_paths[i] && scenepaths_hash(scene->object_paths[i]) == hash) {
+      return i;
+    }
+  }
+  return ~0u;
+}
+
+// Takes ownership of `path`, which must come from the scene arena
+void
+scenepaths_set(
+    GameSceneStruct *scene,
+    U32 slot,
+    char *path)
+{
+  char *old_path = scene->object_paths[slot];
+  if(old_path && path && !strcmp(old_path, path)) {
+    scenearena_freestr(&scene->arena, path);
+    return;
+  }
+
+  if(old_path) {
+    U64 old_hash = scenepaths_hash(old_path);
+    U32 mapped_slot;
+    if(indexmap_get(&scene->path_slots, old_hash, &mapped_slot) && mapped_slot == slot) {
+      // Hand the entry over to an object the old path was shadowing, if any
+      U32 survivor_slot = scenepaths_findshadowed(scene, old_hash, slot);
+      if(survivor_slot != ~0u) {
+        indexmap_set(&scene->path_slots, old_hash, survivor_slot);
+        scene->path_stats.shadowedPaths--;
+      } else {
+        indexmap_remove(&scene->path_slots, old_hash);
+      }
+    } else {
+      // Another object claimed the path since; this one was shadowed
+      scene->path_stats.shadowedPaths--;
+    }
+    scenearena_freestr(&scene->arena, old_path);
+    scene->path_stats.indexedPaths--;
+  }
+
+  scene->object_paths[slot] = path;
+  if(path) {
+    U64 hash = scenepaths_hash(path);
+    if(indexmap_get(&scene->path_slots, hash, NULL)) {
+      scene->path_stats.shadowedPaths++;
+    }
+    indexmap_set(&scene->path_slots, hash, slot);
+    scene->path_stats.indexedPaths++;
+  }
+}
+
+// Recomputes the cached path of `entt` and its whole subtree. Called after
+// an object is renamed or reparented.
+void
+scenepaths_refresh(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameSceneStruct *scene = SceneWalkScene;
+  U32 slot;
+  if(!indexmap_get(&scene->object_slots, entt, &slot)) {
+    return;
+  }
+
+  char *path = NULL;
+  CONST_STR name = GameECS->getEntityName(world, entt);
+  if(name) {
+    GameObject parent = GameECS->getParent(world, entt);
+    U32 parent_slot;
+    if(parent == 0) {
+      path = scenearena_strdup(&scene->arena, name);
+    } else if(indexmap_get(&scene->object_slots, parent, &parent_slot) && scene->object_paths[parent_slot]) {
+      CONST_STR parent_path = scene->object_paths[parent_slot];
+      size_t parent_len = strlen(parent_path);
+      size_t name_len = strlen(name);
+      path = scenearena_alloc(&scene->arena, parent_len + name_len + 2);
+      memcpy(path, parent_path, parent_len);
+      path[parent_len] = '/';
+      memcpy(path + parent_len + 1, name, name_len + 1);
+    }
+  }
+  scenepaths_set(scene, slot, path);
+
+  GameECS->forEachChild(world, entt, scenepaths_refresh);
+}
+
+void
+scenestatic_remove(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  SceneStaticData *statics = &scene->statics;
+  U32 slot;
+  if(!indexmap_get(&statics->slots, obj, &slot)) {
+    return;
+  }
+  indexmap_remove(&statics->slots, obj);
+
+  size_t last_slot = vec_len((vec_t*)&statics->objects) - 1;
+  if(slot != last_slot) {
+    statics->objects[slot] = statics->objects[last_slot];
+    statics->renderComponents[slot] = statics->renderComponents[last_slot];
+    memcpy(statics->worldTransforms[slot], statics->worldTransforms[last_slot], sizeof(WorldTransformComponent));
+    statics->spheres[slot] = statics->spheres[last_slot];
+    indexmap_set(&statics->slots, statics->objects[slot], slot);
+  }
+  vec_setlen((vec_t*)&statics->objects, last_slot);
+  vec_setlen((vec_t*)&statics->renderComponents, last_slot);
+  vec_setlen((vec_t*)&statics->worldTransforms, last_slot);
+  vec_setlen((vec_t*)&statics->spheres, last_slot);
+}
+
+// Pool instances destroyed outside of the pool are dropped from it
+void
+sceneprefabpools_forget(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  ScenePrefabPools *prefab_pools = &scene->prefab_pools;
+  U32 pool_slot;
+  if(!indexmap_get(&prefab_pools->objectPools, obj, &pool_slot)) {
+    return;
+  }
+  indexmap_remove(&prefab_pools->objectPools, obj);
+
+  ScenePrefabPool *pool = &prefab_pools->pools[pool_slot];
+  size_t available_count = vec_len((vec_t*)&pool->available);
+  for(size_t i = 0; i < available_count; i++) {
+    if(pool->available[i] == obj) {
+      pool->available[i] = pool->available[available_count - 1];
+      vec_setlen((vec_t*)&pool->available, available_count - 1);
+      pool->stats.available--;
+      return;
+    }
+  }
+  pool->stats.live--;
+}
+
+void
+sceneobjects_unregister(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  U32 slot;
+  if(!indexmap_get(&scene->object_slots, obj, &slot)) {
+    return;
+  }
+  scenepaths_set(scene, slot, NULL);
+  indexmap_remove(&scene->object_slots, obj);
+  scene->archetype_counts[scene->object_flags[slot]]--;
+  scenestatic_remove(scene, obj);
+  sceneprefabpools_forget(scene, obj);
+  if(scene->object_proxies[slot] != SCENEBVH_NULL) {
+    scenebvh_destroyproxy(&scene->bvh, scene->object_proxies[slot]);
+  }
+
+  // Swap-remove to keep the table dense
+  size_t last_slot = vec_len((vec_t*)&scene->objects) - 1;
+  GameObject last = scene->objects[last_slot];
+  if(last != obj) {
+    scene->objects[slot] = last;
+    scene->object_paths[slot] = scene->object_paths[last_slot];
+    scene->object_flags[slot] = scene->object_flags[last_slot];
+    scene->object_proxies[slot] = scene->object_proxies[last_slot];
+    indexmap_set(&scene->object_slots, last, slot);
+    // The moved object may be shadowed, in which case its path maps elsewhere
+    U32 mapped_slot;
+    if(scene->object_paths[slot]) {
+      U64 hash = scenepaths_hash(scene->object_paths[slot]);
+      if(indexmap_get(&scene->path_slots, hash, &mapped_slot) && mapped_slot == last_slot) {
+        indexmap_set(&scene->path_slots, hash, slot);
+      }
+    }
+  }
+  vec_setlen((vec_t*)&scene->objects, last_slot);
+  vec_setlen((vec_t*)&scene->object_paths, last_slot);
+  vec_setlen((vec_t*)&scene->object_flags, last_slot);
+  vec_setlen((vec_t*)&scene->object_proxies, last_slot);
+}
+
+void
+sceneobjects_unregistersubtree(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameECS->forEachChild(world, entt, sceneobjects_unregistersubtree);
+  sceneobjects_unregister(SceneWalkScene, entt);
+}
+
+GameObject
+ev_scene_getobject(
+    GameScene scene_handle,
+    CONST_STR name);
+GameObject
+ev_scene_getactivecamera(
+    GameScene scene_handle);
+GameObject
+ev_scene_createchildobject(
+    GameScene scene_handle,
+    GameObject parent);
+
+PhysicsWorldHandle
+ev_scene_getphysicsworld(
+    GameScene scene_handle);
+ECSGameWorldHandle
+ev_scene_getecsworld(
+    GameScene scene_handle);
+void
+worldtransform_update(
+    GameScene scene_handle,
+    GameObject entt);
+void
+transform_computeworld(
+    const Matrix4x4 *parent_worldtransform,
+    const TransformComponent *transform,
+    Matrix4x4 out);
+
+void
+ev_object_settransform(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec3 new_pos,
+    Vec4 new_rot,
+    Vec3 new_scale);
+
+void
+ev_object_setcomponent(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id,
+    PTR data);
+
+void
+ev_scene_setactivecamera(
+    GameScene scene_handle,
+    GameObject camera);
+
+void
+ev_scene_destroyobject(
+    GameScene scene_handle,
+    GameObject object);
+
+void
+sceneobjects_destroyimmediate(
+    GameScene scene_handle,
+    GameObject object);
+
+void
+ev_object_setname(
+    GameScene scene_handle,
+    GameObject obj,
+    CONST_STR name);
+
+void
+ev_object_setstatic(
+    GameScene scene_handle,
+    GameObject obj,
+    bool isStatic);
+
+void
+ev_scene_warmpool(
+    GameScene scene_handle,
+    CONST_STR prefabPath,
+    U32 count);
+
+void
+scenesnapshot_removecomponent(
+    GameSceneStruct *scene,
+    GameObject obj,
+    GameComponentID comp_id);
+
+Vec3
+ev_object_getworldposition(
+    GameScene scene_handle,
+    GameObject obj);
+
+void
+ev_game_setactivescene(
+    GameScene scene_handle)
+{
+  GameData.activeScene = scene_handle;
+}
+
+void
+ev_scene_destroy(
+    GameScene scene_handle)
+{
+  GameScene handle = scene_handle?scene_handle:GameData.activeScene;
+  GameSceneStruct *scene = ev_game_getscene(handle);
+  if(scene == NULL) {
+    return;
+  }
+
+  gamescenestruct_destr(scene);
+  scene->alive = false;
+  scene->generation++;
+
+  U32 idx = EV_GAME_SCENE_INDEX(handle);
+  vec_push((vec_t*)&GameData.free_scene_slots, &idx);
+
+  if(GameData.activeScene == handle) {
+    GameData.activeScene = 0;
+  }
+  ev_log_trace("Scene { %llu } destroyed", handle);
+}
+
+bool
+ev_scene_isvalid(
+    GameScene scene_handle)
+{
+  U32 idx = EV_GAME_SCENE_INDEX(scene_handle);
+  return idx != 0
+    && idx < vec_len((vec_t*)&GameData.scenes)
+    && GameData.scenes[idx].alive
+    && GameData.scenes[idx].generation == EV_GAME_SCENE_GENERATION(scene_handle);
+}
+
+void
+ev_game_clearscenes()
+{
+  size_t scene_count = vec_len((vec_t*)&GameData.scenes);
+  for(size_t i = 1; i < scene_count; i++) {
+    if(GameData.scenes[i].alive) {
+      ev_scene_destroy(EV_GAME_SCENE_HANDLE(i, GameData.scenes[i].generation));
+    }
+  }
+  Hashmap(evstring, GameScene).clear(GameData.scene_map);
+  GameData.activeScene = 0;
+}
+
+void
+ev_game_reload()
+{
+  // TODO add more stuff as needed
+  ev_game_clearscenes();
+
+  if(GameData.renderer_module) {
+    evol_unloadmodule(GameData.renderer_module);
+  }
+  GameData.renderer_module = evol_loadmodule("renderer");
+  if(GameData.renderer_module) {
+    imports(GameData.renderer_module, (Renderer, Material, GraphicsPipeline, Light));
+  }
+}
+
+GameScene
+ev_scene_create()
+{
+  GameSceneStruct newscene = {
+    .generation = 1,
+    .alive = true,
+
+    .ecs_world = GameECS->newWorld(),
+    .physics_world = PhysicsWorld->newWorld(),
+    .script_context = ScriptContext->newContext(),
+
+    .activeCamera = 0,
+    .culling = { .enabled = true },
+    .streaming = NULL,
+    .sourcePath = NULL,
+    .sourceDesc = NULL,
+
+    .objects = vec_init(GameObject, NULL, NULL),
+    .object_paths = vec_init(char *, NULL, NULL),
+    .object_flags = vec_init(U8, NULL, NULL),
+    .object_proxies = vec_init(U32, NULL, NULL),
+  };
+  indexmap_init(&newscene.object_slots);
+  indexmap_init(&newscene.path_slots);
+  scenebvh_init(&newscene.bvh);
+  scenelights_init(&newscene.lights);
+  scenestatic_init(&newscene.statics);
+  scenetransformview_init(&newscene.transform_view);
+  scenequerybatch_init(&newscene.query_batch);
+  sceneprefabpools_init(&newscene.prefab_pools);
+  scenedestroyqueue_init(&newscene.destroy_queue);
+  scenereplication_init(&newscene.replication);
+  scenearena_init(&newscene.arena);
+
+  ev_log_trace("New game scene created: { .ecs_world = %llu, .physics_world = %llu, .activeCamera = %llu, .script_context = %llu }",
+      newscene.ecs_world,
+      newscene.physics_world,
+      newscene.activeCamera,
+      newscene.script_context);
+
+  U32 idx;
+  size_t free_count = vec_len((vec_t*)&GameData.free_scene_slots);
+  if(free_count > 0) {
+    idx = GameData.free_scene_slots[free_count - 1];
+    vec_setlen((vec_t*)&GameData.free_scene_slots, free_count - 1);
+    newscene.generation = GameData.scenes[idx].generation;
+    GameData.scenes[idx] = newscene;
+  } else {
+    idx = (U32)vec_push((vec_t*)&GameData.scenes, &newscene);
+  }
+
+  GameScene newscene_handle = EV_GAME_SCENE_HANDLE(idx, newscene.generation);
+  ev_log_trace("New scene given handle { %llu }", newscene_handle);
+  if(GameData.activeScene == 0) {
+    GameData.activeScene = newscene_handle;
+    ev_log_trace("Active scene set to { %llu }", GameData.activeScene);
+  }
+
+  return newscene_handle;
+}
+
+void
+ev_sceneloader_readtransform(
+    evjson_t *json,
+    evstring *comp_id,
+    TransformComponent *out)
+{
+  Vec3 rotation = {0};
+
+  evstring pos_id = evstring_newfmt("%s.position[x]", *comp_id);
+  size_t pos_id_len = evstring_len(pos_id);
+  for(size_t i = 0; i < 3; i++) {
+    pos_id[pos_id_len-2] = '0' + i;
+    ((float*)&out->position)[i] = (float)evjs_get(json, pos_id)->as_num;
+  }
+
+  evstring rot_id = evstring_newfmt("%s.rotation[x]", *comp_id);
+  size_t rot_id_len = evstring_len(rot_id);
+  for(size_t i = 0; i < 3; i++) {
+    rot_id[rot_id_len-2] = '0'+i;
+    ((float*)&rotation)[i] = glm_rad((float)evjs_get(json,rot_id)->as_num);
+  }
+
+  evstring scale_id = evstring_newfmt("%s.scale[x]", *comp_id);
+  size_t scale_id_len = evstring_len(scale_id);
+  for(size_t i = 0; i < 3; i++) {
+    scale_id[scale_id_len-2] = '0'+i;
+    ((float*)&out->scale)[i] = (float)evjs_get(json,scale_id)->as_num;
+  }
+
+  evstring_free(scale_id);
+  evstring_free(rot_id);
+  evstring_free(pos_id);
+
+  // Build rotation quaternion from loaded euler angles
+  Matrix4x4 rotationMatrix;
+  glm_euler((float*)&rotation, rotationMatrix);
+  glm_mat4_quat(rotationMatrix, (float*)&out->rotation);
+}
+
+void
+ev_sceneloader_loadscriptcomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  evstring scriptname_id = evstring_newfmt("%s.script_name", *comp_id);
+  evstring scriptpath_id = evstring_newfmt("%s.script_path", *comp_id);
+  evstring scriptname = evstring_refclone(evjs_get(json,scriptname_id)->as_str);
+  evstring scriptpath = evstring_refclone(evjs_get(json,scriptpath_id)->as_str);
+
+  AssetHandle script_asset = Asset->load(scriptpath);
+  TextAsset script_text = TextLoader->loadAsset(script_asset);
+  ScriptHandle script_handle = Script->new(scriptname, script_text.text);
+  Asset->free(script_asset);
+
+  Script->addToEntity(scene, obj, script_handle);
+  sceneobjects_addflags(ev_game_getscene(scene), obj, SCENEOBJECT_FLAG_SCRIPT);
+
+  evstring_free(scriptpath);
+  evstring_free(scriptname);
+  evstring_free(scriptname_id);
+  evstring_free(scriptpath_id);
+}
+
+void
+ev_sceneloader_loadcameracomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  evstring cameraview_id = evstring_newfmt("%s.view", *comp_id);
+  evstr_ref cameraview = evjs_get(json,cameraview_id)->as_str;
+
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene);
+  CameraComponent comp;
+
+  switch(*(cameraview.data + cameraview.offset)) {
+    case 'P':
+      comp.viewType = EV_CAMERA_VIEWTYPE_PERSPECTIVE;
+
+      evstring fov_id = evstring_newfmt("%s.fov", *comp_id);
+      evstring near_id = evstring_newfmt("%s.near", *comp_id);
+      evstring far_id = evstring_newfmt("%s.far", *comp_id);
+      evstring aspectratio_id = evstring_newfmt("%s.aspectRatio", *comp_id);
+
+      comp.hfov = (U32)evjs_get(json, fov_id)->as_num;
+      comp.nearPlane = (F32)evjs_get(json, near_id)->as_num;
+      comp.farPlane = (F32)evjs_get(json, far_id)->as_num;
+      comp.aspectRatio = (F32)evjs_get(json, aspectratio_id)->as_num;
+
+      evstring_free(fov_id);
+      evstring_free(near_id);
+      evstring_free(far_id);
+      evstring_free(aspectratio_id);
+      break;
+    case 'O':
+      comp.viewType = EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC;
+      // TODO Implement
+      UNIMPLEMENTED();
+      break;
+    default:
+      ev_log_error("Camera View type unknown `%.*s`", cameraview.len, cameraview.data + cameraview.offset);
+      break;
+  }
+
+  GameECS->setComponent(ecs_world, obj, CameraComponentID, &comp);
+  sceneobjects_addflags(ev_game_getscene(scene), obj, SCENEOBJECT_FLAG_CAMERA);
+
+  evstring_free(cameraview_id);
+}
+
+void
+ev_sceneloader_loadrigidbodycomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  evstring SphereCollisionShapeSTR = evstring_literal("Sphere");
+  evstring BoxCollisionShapeSTR = evstring_literal("Box");
+  evstring CapsuleCollisionShapeSTR = evstring_literal("Capsule");
+  evstring MeshCollisionShapeSTR = evstring_literal("Mesh");
+
+  RigidbodyInfo info;
+
+  evstring rigidbodytype_id = evstring_newfmt("%s.rigidbodyType", *comp_id);
+  evstr_ref rigidbodyType = evjs_get(json,rigidbodytype_id)->as_str;
+  switch(*(rigidbodyType.data + rigidbodyType.offset)) {
+    case 'D':
+      info.type = EV_RIGIDBODY_DYNAMIC;
+      break;
+    case 'S':
+      info.type = EV_RIGIDBODY_STATIC;
+      break;
+    case 'K':
+      info.type = EV_RIGIDBODY_KINEMATIC;
+      break;
+    case 'G':
+      info.type = EV_RIGIDBODY_GHOST;
+      break;
+    default:
+      ev_log_warn("Unidentified RigidbodyType `%.*s`. Falling back to `Kinematic`", rigidbodyType.len, (rigidbodyType.data + rigidbodyType.offset));
+      info.type = EV_RIGIDBODY_KINEMATIC;
+      break;
+  }
+  evstring_free(rigidbodytype_id);
+
+  evstring mass_id = evstring_newfmt("%s.mass", *comp_id);
+  info.mass = (F32)evjs_get(json, mass_id)->as_num;
+  evstring_free(mass_id);
+
+  evstring restitution_id = evstring_newfmt("%s.restitution", *comp_id);
+  info.restitution = (F32)evjs_get(json, restitution_id)->as_num;
+  evstring_free(restitution_id);
+
+
+  evstring collisionshapetype_id = evstring_newfmt("%s.collisionShape.type", *comp_id);
+  evstring collisionshapetype = evstring_refclone(evjs_get(json, collisionshapetype_id)->as_str);
+
+  PhysicsWorldHandle physWorld = ev_scene_getphysicsworld(scene);
+  CollisionShapeHandle collShapeHandle = NULL;
+  if(!evstring_cmp(collisionshapetype, SphereCollisionShapeSTR)) {
+    evstring radius_id = evstring_newfmt("%s.collisionShape.radius", *comp_id);
+    F32 radius = (F32)evjs_get(json, radius_id)->as_num;
+    collShapeHandle = CollisionShape->newSphere(physWorld, radius);
+    evstring_free(radius_id);
+  } else if(!evstring_cmp(collisionshapetype, BoxCollisionShapeSTR)) {
+    Vec3 halfExtents;
+    evstring halfextents_id = evstring_newfmt("%s.collisionShape.halfExtents[x]", *comp_id);
+    size_t halfextents_id_len = evstring_len(halfextents_id);
+    for(size_t i = 0; i < 3; i++) {
+      halfextents_id[halfextents_id_len-2] = '0' + i;
+      ((float*)&halfExtents)[i] = (float)evjs_get(json, halfextents_id)->as_num;
+    }
+    evstring_free(halfextents_id);
+
+    collShapeHandle = CollisionShape->newBox(physWorld, halfExtents);
+
+  } else if(!evstring_cmp(collisionshapetype, CapsuleCollisionShapeSTR)) {
+    evstring radius_id = evstring_newfmt("%s.collisionShape.radius", *comp_id);
+    evstring height_id = evstring_newfmt("%s.collisionShape.height", *comp_id);
+    F32 radius = (F32)evjs_get(json, radius_id)->as_num;
+    F32 height = (F32)evjs_get(json, height_id)->as_num;
+
+    collShapeHandle = CollisionShape->newCapsule(physWorld, radius, height);
+
+    evstring_free(radius_id);
+    evstring_free(height_id);
+  } else if(!evstring_cmp(collisionshapetype, MeshCollisionShapeSTR)) {
+    evstring meshpath_id = evstring_newfmt("%s.collisionShape.meshPath", *comp_id);
+    evstring meshpath = evstring_refclone(evjs_get(json, meshpath_id)->as_str);
+
+    collShapeHandle = CollisionShape->newMesh(physWorld, meshpath);
+
+    evstring_free(meshpath);
+    evstring_free(meshpath_id);
+  }
+
+  info.collisionShape = collShapeHandle;
+
+  Rigidbody->addToEntity(scene, obj, info);
+  sceneobjects_addflags(ev_game_getscene(scene), obj, SCENEOBJECT_FLAG_RIGIDBODY);
+
+  evstring_free(collisionshapetype);
+  evstring_free(collisionshapetype_id);
+}
+
+void
+ev_sceneloader_loadrendercomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  evstring meshPath_jsonid = evstring_newfmt("%s.mesh", *comp_id);
+  evstring materialName_jsonid = evstring_newfmt("%s.material", *comp_id);
+
+  evstring meshPath = evstring_refclone(evjs_get(json, meshPath_jsonid)->as_str);
+  evstring materialName = evstring_refclone(evjs_get(json, materialName_jsonid)->as_str);
+
+  RenderComponent newRenderComponent = Renderer->registerComponent(meshPath, materialName);
+  ev_object_setcomponent(scene, obj, RenderingData.RenderingComponentID, &newRenderComponent);
+
+  evstring_free(meshPath);
+  evstring_free(materialName);
+
+  evstring_free(meshPath_jsonid);
+  evstring_free(materialName_jsonid);
+}
+
+void
+ev_sceneloader_loadlightcomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  ev_log_debug("a light was found!");
+  LightComponent newLightComponent = Light->registerComponent(json, *comp_id);
+  ev_object_setcomponent(scene, obj, RenderingData.LightComponentID, &newLightComponent);
+
+  evstring range_id = evstring_newfmt("%s.range", *comp_id);
+  evjson_entry *range_entry = evjs_get(json, range_id);
+  if(range_entry) {
+    ev_object_setcomponent(scene, obj, LightRangeComponentID, &(LightRangeComponent) {
+        .radius = (F32)range_entry->as_num,
+    });
+  }
+  evstring_free(range_id);
+}
+
+void
+ev_sceneloader_loadboundscomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  BoundsComponent comp;
+
+  evstring center_id = evstring_newfmt("%s.center[x]", *comp_id);
+  size_t center_id_len = evstring_len(center_id);
+  for(size_t i = 0; i < 3; i++) {
+    center_id[center_id_len-2] = '0' + i;
+    ((float*)&comp.center)[i] = (float)evjs_get(json, center_id)->as_num;
+  }
+
+  evstring extents_id = evstring_newfmt("%s.extents[x]", *comp_id);
+  size_t extents_id_len = evstring_len(extents_id);
+  for(size_t i = 0; i < 3; i++) {
+    extents_id[extents_id_len-2] = '0' + i;
+    ((float*)&comp.extents)[i] = (float)evjs_get(json, extents_id)->as_num;
+  }
+
+  ev_object_setcomponent(scene, obj, BoundsComponentID, &comp);
+
+  evstring_free(extents_id);
+  evstring_free(center_id);
+}
+
+void
+ev_sceneloader_loadlodcomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  LODComponent comp = {
+    .hysteresis = EV_GAME_LOD_DEFAULT_HYSTERESIS,
+  };
+
+  evstring hysteresis_id = evstring_newfmt("%s.hysteresis", *comp_id);
+  evjson_entry *hysteresis_entry = evjs_get(json, hysteresis_id);
+  if(hysteresis_entry) {
+    comp.hysteresis = (F32)hysteresis_entry->as_num;
+  }
+  evstring_free(hysteresis_id);
+
+  evstring levels_count_id = evstring_newfmt("%s.levels.len", *comp_id);
+  U32 levels_count = (U32)evjs_get(json, levels_count_id)->as_num;
+  evstring_free(levels_count_id);
+  if(levels_count > EV_LOD_MAX_LEVELS) {
+    ev_log_warn("LODComponent at `%s` has %u levels, only the first %u are used", *comp_id, levels_count, EV_LOD_MAX_LEVELS);
+    levels_count = EV_LOD_MAX_LEVELS;
+  }
+
+  for(U32 i = 0; i < levels_count; i++) {
+    evstring meshPath_jsonid = evstring_newfmt("%s.levels[%u].mesh", *comp_id, i);
+    evstring materialName_jsonid = evstring_newfmt("%s.levels[%u].material", *comp_id, i);
+    evstring distance_jsonid = evstring_newfmt("%s.levels[%u].distance", *comp_id, i);
+
+    evstring meshPath = evstring_refclone(evjs_get(json, meshPath_jsonid)->as_str);
+    evstring materialName = evstring_refclone(evjs_get(json, materialName_jsonid)->as_str);
+    comp.levels[i] = Renderer->registerComponent(meshPath, materialName);
+
+    // The last level has no switch distance
+    evjson_entry *distance_entry = evjs_get(json, distance_jsonid);
+    comp.switchDistances[i] = distance_entry ? (F32)distance_entry->as_num : 0.f;
+
+    evstring_free(meshPath);
+    evstring_free(materialName);
+    evstring_free(distance_jsonid);
+    evstring_free(materialName_jsonid);
+    evstring_free(meshPath_jsonid);
+  }
+  comp.levelCount = levels_count;
+
+  if(levels_count == 0) {
+    return;
+  }
+  ev_object_setcomponent(scene, obj, LODComponentID, &comp);
+  ev_object_setcomponent(scene, obj, RenderingData.RenderingComponentID, &comp.levels[0]);
+}
+
+// Reads `<key_id>.<name>[0..2]` into `out`, leaving it untouched if the key
+// doesn't set that channel.
+bool
+ev_sceneloader_readanimationvec3(
+    evjson_t *json,
+    evstring *key_id,
+    CONST_STR name,
+    Vec3 *out)
+{
+  evstring vec_id = evstring_newfmt("%s.%s[x]", *key_id, name);
+  size_t vec_id_len = evstring_len(vec_id);
+  bool found = true;
+  Vec3 v;
+  for(size_t i = 0; i < 3 && found; i++) {
+    vec_id[vec_id_len-2] = '0' + i;
+    evjson_entry *entry = evjs_get(json, vec_id);
+    if(entry) {
+      ((float*)&v)[i] = (float)entry->as_num;
+    } else {
+      found = false;
+    }
+  }
+  evstring_free(vec_id);
+
+  if(found) {
+    *out = v;
+  }
+  return found;
+}
+
+void
+ev_sceneloader_loadanimationcomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  static const CONST_STR easingNames[] = {
+    [EV_ANIMATION_EASING_LINEAR] = "linear",
+    [EV_ANIMATION_EASING_EASEIN] = "easeIn",
+    [EV_ANIMATION_EASING_EASEOUT] = "easeOut",
+    [EV_ANIMATION_EASING_EASEINOUT] = "easeInOut",
+    [EV_ANIMATION_EASING_STEP] = "step",
+  };
+  static const CONST_STR wrapNames[] = {
+    [EV_ANIMATION_WRAP_ONCE] = "once",
+    [EV_ANIMATION_WRAP_LOOP] = "loop",
+    [EV_ANIMATION_WRAP_PINGPONG] = "pingpong",
+  };
+
+  AnimationComponent comp = {
+    .easing = EV_ANIMATION_EASING_LINEAR,
+    .wrap = EV_ANIMATION_WRAP_ONCE,
+    .speed = 1.f,
+    .playing = true,
+  };
+
+  evstring easing_id = evstring_newfmt("%s.easing", *comp_id);
+  evjson_entry *easing_entry = evjs_get(json, easing_id);
+  if(easing_entry) {
+    evstring easing = evstring_refclone(easing_entry->as_str);
+    for(U32 i = 0; i < sizeof(easingNames) / sizeof(easingNames[0]); i++) {
+      if(!strcmp(easing, easingNames[i])) {
+        comp.easing = (AnimationEasing)i;
+      }
+    }
+    evstring_free(easing);
+  }
+  evstring_free(easing_id);
+
+  evstring wrap_id = evstring_newfmt("%s.wrap", *comp_id);
+  evjson_entry *wrap_entry = evjs_get(json, wrap_id);
+  if(wrap_entry) {
+    evstring wrap = evstring_refclone(wrap_entry->as_str);
+    for(U32 i = 0; i < sizeof(wrapNames) / sizeof(wrapNames[0]); i++) {
+      if(!strcmp(wrap, wrapNames[i])) {
+        comp.wrap = (AnimationWrap)i;
+      }
+    }
+    evstring_free(wrap);
+  }
+  evstring_free(wrap_id);
+
+  evstring speed_id = evstring_newfmt("%s.speed", *comp_id);
+  evjson_entry *speed_entry = evjs_get(json, speed_id);
+  if(speed_entry) {
+    comp.speed = (F32)speed_entry->as_num;
+  }
+  evstring_free(speed_id);
+
+  evstring playing_id = evstring_newfmt("%s.playing", *comp_id);
+  evjson_entry *playing_entry = evjs_get(json, playing_id);
+  if(playing_entry) {
+    comp.playing = playing_entry->as_bool;
+  }
+  evstring_free(playing_id);
+
+  evstring keys_count_id = evstring_newfmt("%s.keys.len", *comp_id);
+  U32 keys_count = (U32)evjs_get(json, keys_count_id)->as_num;
+  evstring_free(keys_count_id);
+  if(keys_count > EV_ANIMATION_MAX_KEYS) {
+    ev_log_warn("AnimationComponent at `%s` has %u keys, only the first %u are used", *comp_id, keys_count, EV_ANIMATION_MAX_KEYS);
+    keys_count = EV_ANIMATION_MAX_KEYS;
+  }
+
+  // Channels a key leaves out carry over from the previous key, the first
+  // one starting from the object's own transform
+  GET_SCENE_OR_RETURN_VOID(scenePtr, scene);
+  const TransformComponent *tr = GameECS->getComponent(scenePtr->ecs_world, obj, TransformComponentID);
+  AnimationKey previous = {
+    .position = tr->position,
+    .rotation = tr->rotation,
+    .scale = tr->scale,
+  };
+
+  for(U32 i = 0; i < keys_count; i++) {
+    evstring key_id = evstring_newfmt("%s.keys[%u]", *comp_id, i);
+    evstring time_id = evstring_newfmt("%s.time", key_id);
+
+    AnimationKey key = previous;
+    key.time = (F32)evjs_get(json, time_id)->as_num;
+    if(i > 0 && key.time <= previous.time) {
+      ev_log_warn("AnimationComponent at `%s` has keys out of order, dropping the ones from %u on", *comp_id, i);
+      evstring_free(time_id);
+      evstring_free(key_id);
+      keys_count = i;
+      break;
+    }
+
+    if(ev_sceneloader_readanimationvec3(json, &key_id, "position", &key.position)) {
+      comp.channels |= EV_ANIMATION_CHANNEL_POSITION;
+    }
+    Vec3 rotation;
+    if(ev_sceneloader_readanimationvec3(json, &key_id, "rotation", &rotation)) {
+      comp.channels |= EV_ANIMATION_CHANNEL_ROTATION;
+      rotation = Vec3new(glm_rad(rotation.x), glm_rad(rotation.y), glm_rad(rotation.z));
+      Matrix4x4 rotationMatrix;
+      glm_euler((float*)&rotation, rotationMatrix);
+      glm_mat4_quat(rotationMatrix, (float*)&key.rotation);
+    }
+    if(ev_sceneloader_readanimationvec3(json, &key_id, "scale", &key.scale)) {
+      comp.channels |= EV_ANIMATION_CHANNEL_SCALE;
+    }
+
+    comp.keys[i] = key;
+    previous = key;
+
+    evstring_free(time_id);
+    evstring_free(key_id);
+  }
+  comp.keyCount = keys_count;
+
+  if(keys_count == 0 || comp.channels == 0) {
+    return;
+  }
+  ev_object_setcomponent(scene, obj, AnimationComponentID, &comp);
+}
+
+GameObject
+ev_scene_createobjectwithtransform(
+    GameScene scene_handle,
+    GameObject parent,
+    const TransformComponent *transform);
+
+bool
+ev_sceneloader_readnodetransform(
+    evjson_t *json,
+    CONST_STR prefix,
+    TransformComponent *out)
+{
+  evstring TransformComponentSTR = evstring_literal("TransformComponent");
+  bool found = false;
+
+  evstring components_id = evstring_newfmt("%scomponents", prefix);
+  evstring components_count_id = evstring_newfmt("%s.len", components_id);
+  int components_count = (int)evjs_get(json, components_count_id)->as_num;
+  for(int i = 0; i < components_count && !found; i++) {
+    evstring component_id = evstring_newfmt("%s[%d]", components_id, i);
+    evstring component_type_id = evstring_newfmt("%s.type", component_id);
+    evstring component_type = evstring_refclone(evjs_get(json, component_type_id)->as_str);
+
+    if(!evstring_cmp(component_type, TransformComponentSTR)) {
+      ev_sceneloader_readtransform(json, &component_id, out);
+      found = true;
+    }
+
+    evstring_free(component_type);
+    evstring_free(component_type_id);
+    evstring_free(component_id);
+  }
+  evstring_free(components_count_id);
+  evstring_free(components_id);
+
+  return found;
+}
+
+GameObject
+ev_sceneloader_loadnode(
+    GameScene scene,
+    evjson_t *json,
+    evstring *id,
+    GameObject parent);
+
+GameObject
+ev_sceneloader_loadprefab(
+    GameScene scene,
+    CONST_STR prefabPath)
+{
+  AssetHandle prefabAsset = Asset->load(prefabPath);
+  JSONAsset prefabData = JSONLoader->loadAsset(prefabAsset);
+
+  GameObject node = ev_sceneloader_loadnode(scene, prefabData.json_data, NULL, 0);
+
+  Asset->free(prefabAsset);
+
+  return node;
+}
+
+GameObject
+ev_sceneloader_loadnode(
+    GameScene scene,
+    evjson_t *json,
+    evstring *id,
+    GameObject parent)
+{
+  evstring TransformComponentSTR = evstring_literal("TransformComponent");
+  evstring RigidbodyComponentSTR = evstring_literal("RigidbodyComponent");
+  evstring ScriptComponentSTR = evstring_literal("ScriptComponent");
+  evstring CameraComponentSTR = evstring_literal("CameraComponent");
+  evstring RenderComponentSTR = evstring_literal("RenderComponent");
+  evstring LightComponentSTR = evstring_literal("LightComponent");
+  evstring BoundsComponentSTR = evstring_literal("BoundsComponent");
+  evstring LODComponentSTR = evstring_literal("LODComponent");
+  evstring AnimationComponentSTR = evstring_literal("AnimationComponent");
+
+  evstring prefix;
+  if(id) {
+    prefix = evstring_clone(*id);
+    evstring_pushchar(&prefix, '.');
+  } else {
+    prefix = evstring_new("");
+  }
+
+  // The transform is read ahead of creation so that the object lands in its
+  // final (Transform, WorldTransform) archetype in one step.
+  TransformComponent initialTransform = DefaultTransform;
+  ev_sceneloader_readnodetransform(json, prefix, &initialTransform);
+
+  GameObject obj = ev_scene_createobjectwithtransform(scene, parent, &initialTransform);
+
+  evstring nodename_id = evstring_newfmt("%sid", prefix);
+  evjson_entry *nodename_entry = evjs_get(json, nodename_id);
+  if(nodename_entry) {
+    evstring nodename = evstring_refclone(nodename_entry->as_str);
+    ev_object_setname(scene, obj, nodename);
+    evstring_free(nodename);
+  }
+  evstring_free(nodename_id);
+
+  evstring components_id = evstring_newfmt("%scomponents", prefix);
+  evstring components_count_id = evstring_newfmt("%s.len", components_id);
+
+  int components_count = (int)evjs_get(json, components_count_id)->as_num;
+  for(int i = 0; i < components_count; i++) {
+    evstring component_id = evstring_newfmt("%s[%d]", components_id, i);
+    evstring component_type_id = evstring_newfmt("%s.type", component_id);
+    evstring component_type = evstring_refclone(evjs_get(json, component_type_id)->as_str);
+
+    if(!evstring_cmp(component_type, TransformComponentSTR)) {
+      // Already applied on creation
+    } else if(!evstring_cmp(component_type, ScriptComponentSTR)) {
+      ev_sceneloader_loadscriptcomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, RigidbodyComponentSTR)) {
+      ev_sceneloader_loadrigidbodycomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, CameraComponentSTR)) {
+      ev_sceneloader_loadcameracomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, RenderComponentSTR)) {
+      ev_sceneloader_loadrendercomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, LightComponentSTR)) {
+     ev_sceneloader_loadlightcomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, BoundsComponentSTR)) {
+      ev_sceneloader_loadboundscomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, LODComponentSTR)) {
+      ev_sceneloader_loadlodcomponent(scene, obj, json, &component_id);
+    } else if(!evstring_cmp(component_type, AnimationComponentSTR)) {
+      ev_sceneloader_loadanimationcomponent(scene, obj, json, &component_id);
+    }
+
+    evstring_free(component_type);
+    evstring_free(component_type_id);
+    evstring_free(component_id);
+  }
+
+  evstring_free(components_count_id);
+  evstring_free(components_id);
+
+  EV_DEFER(
+      evstring children_count_id = evstring_newfmt("%schildren.len", prefix),
+      evstring_free(children_count_id))
+  {
+    evjson_entry *children_count_res = evjs_get(json, children_count_id);
+    if(children_count_res) {
+      int children_count = (int)children_count_res->as_num;
+      for(int i = 0; i < children_count; i++) {
+        evstring child_id = evstring_newfmt("%schildren[%d]", prefix, i);
+        ev_sceneloader_loadnode(scene, json, &child_id, obj);
+        evstring_free(child_id);
+      }
+    }
+  }
+
+  // Baked after the children are loaded so that the whole subtree is frozen
+  evstring static_id = evstring_newfmt("%sstatic", prefix);
+  evjson_entry *static_entry = evjs_get(json, static_id);
+  if(static_entry && static_entry->as_bool) {
+    ev_object_setstatic(scene, obj, true);
+  }
+  evstring_free(static_id);
+
+  return obj;
+}
+
+// "pools": [{ "prefab": path, "count": n }] warms up prefab pools on load
+void
+ev_sceneloader_loadpools(
+    GameScene scene,
+    evjson_t *json)
+{
+  evjson_entry *pools_count_res = evjs_get(json, "pools.len");
+  if(!pools_count_res) {
+    return;
+  }
+
+  int pools_count = (int)pools_count_res->as_num;
+  for(int i = 0; i < pools_count; i++) {
+    evstring prefab_id = evstring_newfmt("pools[%d].prefab", i);
+    evstring count_id = evstring_newfmt("pools[%d].count", i);
+
+    evstring prefab = evstring_refclone(evjs_get(json, prefab_id)->as_str);
+    evjson_entry *count_entry = evjs_get(json, count_id);
+    ev_scene_warmpool(scene, prefab, count_entry ? (U32)count_entry->as_num : 0);
+
+    evstring_free(prefab);
+    evstring_free(count_id);
+    evstring_free(prefab_id);
+  }
+}
+
+GameScene
+ev_scene_loadfromfile(
+    CONST_STR path)
+{
+  GameScene newscene = ev_scene_create();
+  AssetHandle scenefile_handle = Asset->load(path);
+  JSONAsset scene_jsonasset = JSONLoader->loadAsset(scenefile_handle);
+  evjson_t *scene_desc = (evjson_t*)scene_jsonasset.json_data;
+
+  if (evjs_get(scene_desc, "pipelines")) {
+    GraphicsPipeline->readJSONList(scene_desc, "pipelines");
+  }
+
+  if (evjs_get(scene_desc, "materials")) {
+    Material->readJSONList(scene_desc, "materials");
+  }
+
+  int nodes_count = (int)evjs_get(scene_desc, "nodes.len")->as_num;
+  for(int i = 0; i < nodes_count; i++) {
+    evstring node_id = evstring_newfmt("nodes[%d]", i);
+    ev_sceneloader_loadnode(newscene, scene_desc, &node_id, 0);
+    evstring_free(node_id);
+  }
+
+  ev_sceneloader_loadpools(newscene, scene_desc);
+
+  evstring activeCamera = evstring_refclone(evjs_get(scene_desc, "activeCamera")->as_str);
+  ev_scene_setactivecamera(newscene, ev_scene_getobject(newscene, activeCamera));
+  evstring_free(activeCamera);
+
+  GameSceneStruct *scene = ev_game_getscene(newscene);
+  scene->sourcePath = scenearena_strdup(&scene->arena, path);
+  Asset->free(scenefile_handle);
+
+  return newscene;
+}
+
+F64
+ev_game_gettimems()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (F64)ts.tv_sec * 1000.0 + (F64)ts.tv_nsec / 1000000.0;
+}
+
+U32
+ev_sceneloader_countnodes(
+    evjson_t *json,
+    CONST_STR node_id)
+{
+  U32 count = 1;
+  evstring children_count_id = evstring_newfmt("%s.children.len", node_id);
+  evjson_entry *children_count_res = evjs_get(json, children_count_id);
+  if(children_count_res) {
+    int children_count = (int)children_count_res->as_num;
+    for(int i = 0; i < children_count; i++) {
+      evstring child_id = evstring_newfmt("%s.children[%d]", node_id, i);
+      count += ev_sceneloader_countnodes(json, child_id);
+      evstring_free(child_id);
+    }
+  }
+  evstring_free(children_count_id);
+  return count;
+}
+
+// Both coordinates packed in one key. The sign bits are flipped so that the
+// key is only 0 (an empty bucket) for a cell no position can fall in.
+U64
+scenestreaming_cellkey(
+    I32 x,
+    I32 z)
+{
+  return (((U64)(U32)x << 32) | (U32)z) ^ 0x8000000080000000ULL;
+}
+
+SceneStreamingCell *
+scenestreaming_getcell(
+    SceneStreamingData *streaming,
+    I32 x,
+    I32 z)
+{
+  U64 key = scenestreaming_cellkey(x, z);
+  U32 slot;
+  if(indexmap_get(&streaming->cellSlots, key, &slot)) {
+    return &streaming->cells[slot];
+  }
+
+  SceneStreamingCell newcell = {
+    .x = x,
+    .z = z,
+    .nodes = vec_init(U32, NULL, NULL),
+    .objects = vec_init(GameObject, NULL, NULL),
+    .nodeCount = 0,
+    .resident = false,
+  };
+  I32 idx = vec_push((vec_t*)&streaming->cells, &newcell);
+  indexmap_set(&streaming->cellSlots, key, (U32)idx);
+  return &streaming->cells[idx];
+}
+
+// Squared distance on the XZ plane from `pos` to the closest point of a cell
+F32
+scenestreaming_celldistance2(
+    SceneStreamingData *streaming,
+    SceneStreamingCell *cell,
+    Vec3 pos)
+{
+  F32 min_x = cell->x * streaming->cellSize;
+  F32 min_z = cell->z * streaming->cellSize;
+  F32 dx = 0.f;
+  F32 dz = 0.f;
+  if(pos.x < min_x) {
+    dx = min_x - pos.x;
+  } else if(pos.x > min_x + streaming->cellSize) {
+    dx = pos.x - (min_x + streaming->cellSize);
+  }
+  if(pos.z < min_z) {
+    dz = min_z - pos.z;
+  } else if(pos.z > min_z + streaming->cellSize) {
+    dz = pos.z - (min_z + streaming->cellSize);
+  }
+  return dx * dx + dz * dz;
+}
+
+void
+scenestreaming_loadcell(
+    GameScene scene_handle,
+    SceneStreamingData *streaming,
+    SceneStreamingCell *cell)
+{
+  F64 start = ev_game_gettimems();
+
+  size_t node_count = vec_len((vec_t*)&cell->nodes);
+  for(size_t i = 0; i < node_count; i++) {
+    evstring node_id = evstring_newfmt("nodes[%u]", cell->nodes[i]);
+    GameObject obj = ev_sceneloader_loadnode(scene_handle, streaming->scene_desc, &node_id, 0);
+    vec_push((vec_t*)&cell->objects, &obj);
+    evstring_free(node_id);
+  }
+  cell->resident = true;
+
+  F32 elapsed = (F32)(ev_game_gettimems() - start);
+  streaming->totalLoadMs += elapsed;
+  streaming->totalLoads++;
+  streaming->stats.lastLoadMs = elapsed;
+  streaming->stats.avgLoadMs = (F32)(streaming->totalLoadMs / streaming->totalLoads);
+  if(elapsed > streaming->stats.maxLoadMs) {
+    streaming->stats.maxLoadMs = elapsed;
+  }
+  streaming->stats.residentCells++;
+  streaming->stats.residentObjects += cell->nodeCount;
+}
+
+void
+scenestreaming_unloadcell(
+    GameScene scene_handle,
+    SceneStreamingData *streaming,
+    SceneStreamingCell *cell)
+{
+  size_t object_count = vec_len((vec_t*)&cell->objects);
+  for(size_t i = 0; i < object_count; i++) {
+    ev_scene_destroyobject(scene_handle, cell->objects[i]);
+  }
+  vec_clear(cell->objects);
+  cell->resident = false;
+
+  streaming->stats.residentCells--;
+  streaming->stats.residentObjects -= cell->nodeCount;
+}
+
+GameScene
+ev_scene_loadfromfilestreamed(
+    CONST_STR path,
+    F32 cellSize)
+{
+  GameScene newscene = ev_scene_create();
+  SceneStreamingData *streaming = scenearena_alloc(&ev_game_getscene(newscene)->arena, sizeof(SceneStreamingData));
+  *streaming = (SceneStreamingData){0};
+  streaming->scenefile = Asset->load(path);
+  streaming->scene_desc = (evjson_t*)JSONLoader->loadAsset(streaming->scenefile).json_data;
+  streaming->cellSize = cellSize > 0.f ? cellSize : EV_GAME_STREAMING_DEFAULT_CELLSIZE;
+  streaming->radius = streaming->cellSize * 2.f;
+  streaming->budgetMs = EV_GAME_STREAMING_DEFAULT_BUDGET_MS;
+  streaming->cells = vec_init(SceneStreamingCell, NULL, scenestreamingcell_destr);
+  indexmap_init(&streaming->cellSlots);
+  ev_game_getscene(newscene)->streaming = streaming;
+
+  evjson_t *scene_desc = streaming->scene_desc;
+
+  if (evjs_get(scene_desc, "pipelines")) {
+    GraphicsPipeline->readJSONList(scene_desc, "pipelines");
+  }
+
+  if (evjs_get(scene_desc, "materials")) {
+    Material->readJSONList(scene_desc, "materials");
+  }
+
+  evstring activeCamera = evstring_refclone(evjs_get(scene_desc, "activeCamera")->as_str);
+
+  // Nodes without a transform and the active camera are always resident;
+  // every other top-level node goes to the cell containing its position.
+  int nodes_count = (int)evjs_get(scene_desc, "nodes.len")->as_num;
+  for(int i = 0; i < nodes_count; i++) {
+    evstring node_id = evstring_newfmt("nodes[%d]", i);
+    evstring node_prefix = evstring_newfmt("%s.", node_id);
+    evstring nodename_id = evstring_newfmt("%sid", node_prefix);
+
+    bool always_resident = true;
+    TransformComponent transform = DefaultTransform;
+    if(ev_sceneloader_readnodetransform(scene_desc, node_prefix, &transform)) {
+      always_resident = false;
+      evjson_entry *nodename_entry = evjs_get(scene_desc, nodename_id);
+      if(nodename_entry) {
+        evstring nodename = evstring_refclone(nodename_entry->as_str);
+        always_resident = !evstring_cmp(nodename, activeCamera);
+        evstring_free(nodename);
+      }
+    }
+
+    if(always_resident) {
+      ev_sceneloader_loadnode(newscene, scene_desc, &node_id, 0);
+    } else {
+      SceneStreamingCell *cell = scenestreaming_getcell(streaming,
+          (I32)floorf(transform.position.x / streaming->cellSize),
+          (I32)floorf(transform.position.z / streaming->cellSize));
+      U32 node_idx = (U32)i;
+      vec_push((vec_t*)&cell->nodes, &node_idx);
+      cell->nodeCount += ev_sceneloader_countnodes(scene_desc, node_id);
+    }
+
+    evstring_free(nodename_id);
+    evstring_free(node_prefix);
+    evstring_free(node_id);
+  }
+
+  ev_scene_setactivecamera(newscene, ev_scene_getobject(newscene, activeCamera));
+  evstring_free(activeCamera);
+
+  ev_sceneloader_loadpools(newscene, scene_desc);
+
+  streaming->stats.cellCount = (U32)vec_len((vec_t*)&streaming->cells);
+
+  ev_log_trace("Streamed scene %s partitioned into %u cells of size %f", path, streaming->stats.cellCount, streaming->cellSize);
+
+  return newscene;
+}
+
+void
+ev_scene_setstreamingradius(
+    GameScene scene_handle,
+    F32 radius)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneStreamingData *streaming = scene->streaming;
+  if(streaming) {
+    streaming->radius = radius;
+  }
+}
+
+void
+ev_scene_setstreamingbudget(
+    GameScene scene_handle,
+    F32 budgetMs)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneStreamingData *streaming = scene->streaming;
+  if(streaming) {
+    streaming->budgetMs = budgetMs;
+  }
+}
+
+SceneStreamingStats
+ev_scene_getstreamingstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneStreamingStats){0});
+  SceneStreamingData *streaming = scene->streaming;
+  if(streaming == NULL) {
+    return (SceneStreamingStats){0};
+  }
+
+  SceneStreamingStats stats = streaming->stats;
+  // Estimated from the transforms every resident object carries; components
+  // owned by other modules are not accounted for
+  stats.residentBytes = (U64)stats.residentObjects * (sizeof(TransformComponent) + sizeof(WorldTransformComponent));
+  return stats;
+}
+
+void
+scenestreaming_update(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneStreamingData *streaming = scene->streaming;
+  if(streaming == NULL || scene->activeCamera == 0) {
+    return;
+  }
+
+  Vec3 camera_pos = ev_object_getworldposition(scene_handle, scene->activeCamera);
+  F32 load_radius2 = streaming->radius * streaming->radius;
+  // Cells are only dropped a full cell past the load radius so that a camera
+  // moving along a cell border does not keep reloading the same cells.
+  F32 unload_radius = streaming->radius + streaming->cellSize;
+  F32 unload_radius2 = unload_radius * unload_radius;
+
+  size_t cell_count = vec_len((vec_t*)&streaming->cells);
+  U32 pending = 0;
+  for(size_t i = 0; i < cell_count; i++) {
+    SceneStreamingCell *cell = &streaming->cells[i];
+    F32 dist2 = scenestreaming_celldistance2(streaming, cell, camera_pos);
+    if(cell->resident && dist2 > unload_radius2) {
+      scenestreaming_unloadcell(scene_handle, streaming, cell);
+    } else if(!cell->resident && dist2 <= load_radius2) {
+      pending++;
+    }
+  }
+
+  // Nearest cells first; at least one cell is loaded per frame so that a
+  // budget smaller than a single cell's load time still makes progress.
+  F64 start = ev_game_gettimems();
+  while(pending > 0) {
+    SceneStreamingCell *nearest = NULL;
+    F32 nearest_dist2 = 0.f;
+    for(size_t i = 0; i < cell_count; i++) {
+      SceneStreamingCell *cell = &streaming->cells[i];
+      if(cell->resident) {
+        continue;
+      }
+      F32 dist2 = scenestreaming_celldistance2(streaming, cell, camera_pos);
+      if(dist2 <= load_radius2 && (nearest == NULL || dist2 < nearest_dist2)) {
+        nearest = cell;
+        nearest_dist2 = dist2;
+      }
+    }
+
+    scenestreaming_loadcell(scene_handle, streaming, nearest);
+    pending--;
+
+    if(ev_game_gettimems() - start >= streaming->budgetMs) {
+      break;
+    }
+  }
+  streaming->stats.pendingCells = pending;
+}
+
+// Fields the scene loader reads from a component, compared one by one on
+// hot-reload. Kinds: 'n' number, 's' string, 'b' bool, 'v' array of three
+// numbers, 'a' array of objects made of `fields`.
+typedef struct SceneReloadField {
+  CONST_STR name;
+  char kind;
+  const struct SceneReloadField *fields;
+} SceneReloadField;
+
+static const SceneReloadField SceneReloadTransformFields[] = {
+  { .name = "position", .kind = 'v' },
+  { .name = "rotation", .kind = 'v' },
+  { .name = "scale", .kind = 'v' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadScriptFields[] = {
+  { .name = "script_name", .kind = 's' },
+  { .name = "script_path", .kind = 's' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadCameraFields[] = {
+  { .name = "view", .kind = 's' },
+  { .name = "fov", .kind = 'n' },
+  { .name = "near", .kind = 'n' },
+  { .name = "far", .kind = 'n' },
+  { .name = "aspectRatio", .kind = 'n' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadRigidbodyFields[] = {
+  { .name = "rigidbodyType", .kind = 's' },
+  { .name = "mass", .kind = 'n' },
+  { .name = "restitution", .kind = 'n' },
+  { .name = "collisionShape.type", .kind = 's' },
+  { .name = "collisionShape.radius", .kind = 'n' },
+  { .name = "collisionShape.height", .kind = 'n' },
+  { .name = "collisionShape.halfExtents", .kind = 'v' },
+  { .name = "collisionShape.meshPath", .kind = 's' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadRenderFields[] = {
+  { .name = "mesh", .kind = 's' },
+  { .name = "material", .kind = 's' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadBoundsFields[] = {
+  { .name = "center", .kind = 'v' },
+  { .name = "extents", .kind = 'v' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadLODLevelFields[] = {
+  { .name = "mesh", .kind = 's' },
+  { .name = "material", .kind = 's' },
+  { .name = "distance", .kind = 'n' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadLODFields[] = {
+  { .name = "hysteresis", .kind = 'n' },
+  { .name = "levels", .kind = 'a', .fields = SceneReloadLODLevelFields },
+  { 0 },
+};
+static const SceneReloadField SceneReloadAnimationKeyFields[] = {
+  { .name = "time", .kind = 'n' },
+  { .name = "position", .kind = 'v' },
+  { .name = "rotation", .kind = 'v' },
+  { .name = "scale", .kind = 'v' },
+  { 0 },
+};
+static const SceneReloadField SceneReloadAnimationFields[] = {
+  { .name = "easing", .kind = 's' },
+  { .name = "wrap", .kind = 's' },
+  { .name = "speed", .kind = 'n' },
+  { .name = "playing", .kind = 'b' },
+  { .name = "keys", .kind = 'a', .fields = SceneReloadAnimationKeyFields },
+  { 0 },
+};
+
+// LightComponent is read by the renderer's Light module, so its fields are
+// unknown here and it is always reapplied.
+static const struct {
+  CONST_STR type;
+  const SceneReloadField *fields;
+} SceneReloadComponentFields[] = {
+  { "TransformComponent", SceneReloadTransformFields },
+  { "ScriptComponent", SceneReloadScriptFields },
+  { "CameraComponent", SceneReloadCameraFields },
+  { "RigidbodyComponent", SceneReloadRigidbodyFields },
+  { "RenderComponent", SceneReloadRenderFields },
+  { "BoundsComponent", SceneReloadBoundsFields },
+  { "LODComponent", SceneReloadLODFields },
+  { "AnimationComponent", SceneReloadAnimationFields },
+};
+
+bool
+scenehotreload_valueequal(
+    evjson_t *new_json,
+    CONST_STR new_id,
+    evjson_t *old_json,
+    CONST_STR old_id,
+    char kind)
+{
+  evjson_entry *new_entry = evjs_get(new_json, new_id);
+  evjson_entry *old_entry = evjs_get(old_json, old_id);
+  if(new_entry == NULL || old_entry == NULL) {
+    return new_entry == old_entry;
+  }
+  switch(kind) {
+    case 'n':
+      return new_entry->as_num == old_entry->as_num;
+    case 'b':
+      return new_entry->as_bool == old_entry->as_bool;
+    default: {
+      evstr_ref a = new_entry->as_str;
+      evstr_ref b = old_entry->as_str;
+      return a.len == b.len && !memcmp(a.data + a.offset, b.data + b.offset, a.len);
+    }
+  }
+}
+
+bool
+scenehotreload_fieldsequal(
+    evjson_t *new_json,
+    CONST_STR new_id,
+    evjson_t *old_json,
+    CONST_STR old_id,
+    const SceneReloadField *fields)
+{
+  bool equal = true;
+  for(const SceneReloadField *field = fields; field->name && equal; field++) {
+    evstring new_field_id = evstring_newfmt("%s.%s", new_id, field->name);
+    evstring old_field_id = evstring_newfmt("%s.%s", old_id, field->name);
+    if(field->kind == 'v' || field->kind == 'a') {
+      U32 count = 3;
+      if(field->kind == 'a') {
+        evstring new_len_id = evstring_newfmt("%s.len", new_field_id);
+        evstring old_len_id = evstring_newfmt("%s.len", old_field_id);
+        equal = scenehotreload_valueequal(new_json, new_len_id, old_json, old_len_id, 'n');
+        evjson_entry *len_entry = evjs_get(new_json, new_len_id);
+        count = len_entry ? (U32)len_entry->as_num : 0;
+        evstring_free(old_len_id);
+        evstring_free(new_len_id);
+      }
+      for(U32 i = 0; i < count && equal; i++) {
+        evstring new_elem_id = evstring_newfmt("%s[%u]", new_field_id, i);
+        evstring old_elem_id = evstring_newfmt("%s[%u]", old_field_id, i);
+        equal = field->kind == 'v'
+          ? scenehotreload_valueequal(new_json, new_elem_id, old_json, old_elem_id, 'n')
+          : scenehotreload_fieldsequal(new_json, new_elem_id, old_json, old_elem_id, field->fields);
+        evstring_free(old_elem_id);
+        evstring_free(new_elem_id);
+      }
+    } else {
+      equal = scenehotreload_valueequal(new_json, new_field_id, old_json, old_field_id, field->kind);
+    }
+    evstring_free(old_field_id);
+    evstring_free(new_field_id);
+  }
+  return equal;
+}
+
+// Compares two components field by field, as read by the scene loader.
+// Components whose fields aren't known never compare equal.
+bool
+scenehotreload_componentequal(
+    evjson_t *new_json,
+    CONST_STR new_id,
+    evjson_t *old_json,
+    CONST_STR old_id)
+{
+  evstring new_type_id = evstring_newfmt("%s.type", new_id);
+  evstring old_type_id = evstring_newfmt("%s.type", old_id);
+  bool equal = scenehotreload_valueequal(new_json, new_type_id, old_json, old_type_id, 's');
+  const SceneReloadField *fields = NULL;
+  if(equal) {
+    evstring type = evstring_refclone(evjs_get(new_json, new_type_id)->as_str);
+    for(U32 i = 0; i < sizeof(SceneReloadComponentFields) / sizeof(SceneReloadComponentFields[0]); i++) {
+      if(!strcmp(type, SceneReloadComponentFields[i].type)) {
+        fields = SceneReloadComponentFields[i].fields;
+      }
+    }
+    evstring_free(type);
+  }
+  evstring_free(old_type_id);
+  evstring_free(new_type_id);
+
+  return fields && scenehotreload_fieldsequal(new_json, new_id, old_json, old_id, fields);
+}
+
+void
+scenehotreload_applycomponent(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *json,
+    evstring *comp_id)
+{
+  evstring TransformComponentSTR = evstring_literal("TransformComponent");
+  evstring CameraComponentSTR = evstring_literal("CameraComponent");
+  evstring RenderComponentSTR = evstring_literal("RenderComponent");
+  evstring LightComponentSTR = evstring_literal("LightComponent");
+  evstring BoundsComponentSTR = evstring_literal("BoundsComponent");
+  evstring LODComponentSTR = evstring_literal("LODComponent");
+  evstring AnimationComponentSTR = evstring_literal("AnimationComponent");
+
+  evstring component_type_id = evstring_newfmt("%s.type", *comp_id);
+  evstring component_type = evstring_refclone(evjs_get(json, component_type_id)->as_str);
+
+  if(!evstring_cmp(component_type, TransformComponentSTR)) {
+    TransformComponent transform;
+    ev_sceneloader_readtransform(json, comp_id, &transform);
+    ev_object_settransform(scene, obj, transform.position, transform.rotation, transform.scale);
+  } else if(!evstring_cmp(component_type, CameraComponentSTR)) {
+    ev_sceneloader_loadcameracomponent(scene, obj, json, comp_id);
+  } else if(!evstring_cmp(component_type, RenderComponentSTR)) {
+    ev_sceneloader_loadrendercomponent(scene, obj, json, comp_id);
+  } else if(!evstring_cmp(component_type, LightComponentSTR)) {
+    ev_sceneloader_loadlightcomponent(scene, obj, json, comp_id);
+  } else if(!evstring_cmp(component_type, BoundsComponentSTR)) {
+    ev_sceneloader_loadboundscomponent(scene, obj, json, comp_id);
+  } else if(!evstring_cmp(component_type, LODComponentSTR)) {
+    ev_sceneloader_loadlodcomponent(scene, obj, json, comp_id);
+  } else if(!evstring_cmp(component_type, AnimationComponentSTR)) {
+    ev_sceneloader_loadanimationcomponent(scene, obj, json, comp_id);
+  } else {
+    // Scripts and rigidbodies own state in other modules that cannot be
+    // swapped in place.
+    ev_log_warn("Hot-reload: changes to `%s` at `%s` need a full reload", component_type, *comp_id);
+  }
+
+  evstring_free(component_type);
+  evstring_free(component_type_id);
+}
+
+bool
+scenehotreload_hascomponent(
+    evjson_t *json,
+    CONST_STR node_id,
+    U32 count,
+    CONST_STR type)
+{
+  bool found = false;
+  for(U32 i = 0; i < count && !found; i++) {
+    evstring type_id = evstring_newfmt("%s.components[%u].type", node_id, i);
+    evjson_entry *type_entry = evjs_get(json, type_id);
+    if(type_entry) {
+      evstring component_type = evstring_refclone(type_entry->as_str);
+      found = !strcmp(component_type, type);
+      evstring_free(component_type);
+    }
+    evstring_free(type_id);
+  }
+  return found;
+}
+
+// Undoes what the scene loader did for a component type that is no longer on
+// the node. The transform goes back to the default one, as for nodes loaded
+// without one.
+void
+scenehotreload_removecomponent(
+    GameScene scene_handle,
+    GameObject obj,
+    CONST_STR type,
+    bool keep_render)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  GameComponentID ids[2];
+  U32 id_count = 0;
+  if(!strcmp(type, "TransformComponent")) {
+    ev_object_settransform(scene_handle, obj, DefaultTransform.position, DefaultTransform.rotation, DefaultTransform.scale);
+  } else if(!strcmp(type, "CameraComponent")) {
+    ids[id_count++] = CameraComponentID;
+  } else if(!strcmp(type, "RenderComponent")) {
+    ids[id_count++] = RenderingData.RenderingComponentID;
+  } else if(!strcmp(type, "LightComponent")) {
+    ids[id_count++] = RenderingData.LightComponentID;
+    ids[id_count++] = LightRangeComponentID;
+  } else if(!strcmp(type, "BoundsComponent")) {
+    ids[id_count++] = BoundsComponentID;
+  } else if(!strcmp(type, "LODComponent")) {
+    ids[id_count++] = LODComponentID;
+    // The level the LOD swapped in, unless the node also has its own
+    if(!keep_render) {
+      ids[id_count++] = RenderingData.RenderingComponentID;
+    }
+  } else if(!strcmp(type, "AnimationComponent")) {
+    ids[id_count++] = AnimationComponentID;
+  } else {
+    ev_log_warn("Hot-reload: removing `%s` needs a full reload", type);
+  }
+
+  for(U32 i = 0; i < id_count; i++) {
+    if(GameECS->hasComponent(scene->ecs_world, obj, ids[i])) {
+      scenesnapshot_removecomponent(scene, obj, ids[i]);
+    }
+  }
+}
+
+bool
+scenehotreload_diffcomponents(
+    GameScene scene,
+    GameObject obj,
+    evjson_t *new_json,
+    CONST_STR new_node_id,
+    evjson_t *old_json,
+    CONST_STR old_node_id)
+{
+  bool changed = false;
+  evstring new_count_id = evstring_newfmt("%s.components.len", new_node_id);
+  evstring old_count_id = evstring_newfmt("%s.components.len", old_node_id);
+  evjson_entry *new_count_entry = evjs_get(new_json, new_count_id);
+  evjson_entry *old_count_entry = evjs_get(old_json, old_count_id);
+  U32 new_count = new_count_entry ? (U32)new_count_entry->as_num : 0;
+  U32 old_count = old_count_entry ? (U32)old_count_entry->as_num : 0;
+  evstring_free(old_count_id);
+  evstring_free(new_count_id);
+
+  for(U32 i = 0; i < new_count; i++) {
+    evstring component_id = evstring_newfmt("%s.components[%u]", new_node_id, i);
+    evstring old_component_id = evstring_newfmt("%s.components[%u]", old_node_id, i);
+    if(i >= old_count || !scenehotreload_componentequal(new_json, component_id, old_json, old_component_id)) {
+      scenehotreload_applycomponent(scene, obj, new_json, &component_id);
+      changed = true;
+    }
+    evstring_free(old_component_id);
+    evstring_free(component_id);
+  }
+
+  bool keep_render = scenehotreload_hascomponent(new_json, new_node_id, new_count, "RenderComponent");
+  for(U32 i = 0; i < old_count; i++) {
+    evstring type_id = evstring_newfmt("%s.components[%u].type", old_node_id, i);
+    evjson_entry *type_entry = evjs_get(old_json, type_id);
+    if(type_entry) {
+      evstring type = evstring_refclone(type_entry->as_str);
+      if(!scenehotreload_hascomponent(new_json, new_node_id, new_count, type)) {
+        scenehotreload_removecomponent(scene, obj, type, keep_render);
+        changed = true;
+      }
+      evstring_free(type);
+    }
+    evstring_free(type_id);
+  }
+
+  return changed;
+}
+
+// Matches the nodes of `new_array_id` against `old_array_id` by `id`, through
+// an index of the old ids built once per level. Matching nodes only get their
+// changed components reapplied and the ones they lost removed, new ones are
+// loaded and removed ones destroyed. Nodes without an `id` cannot be matched
+// and are left untouched.
+void
+scenehotreload_diffnodes(
+    GameScene scene,
+    evjson_t *new_json,
+    CONST_STR new_array_id,
+    evjson_t *old_json,
+    CONST_STR old_array_id,
+    GameObject parent,
+    SceneReloadStats *stats)
+{
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene);
+
+  evstring new_count_id = evstring_newfmt("%s.len", new_array_id);
+  evstring old_count_id = evstring_newfmt("%s.len", old_array_id);
+  evjson_entry *new_count_entry = evjs_get(new_json, new_count_id);
+  evjson_entry *old_count_entry = evjs_get(old_json, old_count_id);
+  U32 new_count = new_count_entry ? (U32)new_count_entry->as_num : 0;
+  U32 old_count = old_count_entry ? (U32)old_count_entry->as_num : 0;
+  evstring_free(old_count_id);
+  evstring_free(new_count_id);
+
+  // Old node names, and an index from their hash to the first node using it
+  vec(evstring) old_names = vec_init(evstring, NULL, NULL);
+  vec(bool) old_matched = vec_init(bool, NULL, NULL);
+  vec_setlen((vec_t*)&old_names, old_count);
+  vec_setlen((vec_t*)&old_matched, old_count);
+  IndexMap old_slots;
+  indexmap_init(&old_slots);
+  for(U32 j = 0; j < old_count; j++) {
+    evstring name_id = evstring_newfmt("%s[%u].id", old_array_id, j);
+    evjson_entry *name_entry = evjs_get(old_json, name_id);
+    old_names[j] = name_entry ? evstring_refclone(name_entry->as_str) : NULL;
+    old_matched[j] = false;
+    if(old_names[j] && !indexmap_get(&old_slots, scenepaths_hash(old_names[j]), NULL)) {
+      indexmap_set(&old_slots, scenepaths_hash(old_names[j]), j);
+    }
+    evstring_free(name_id);
+  }
+
+  for(U32 i = 0; i < new_count; i++) {
+    evstring node_id = evstring_newfmt("%s[%u]", new_array_id, i);
+    evstring name_id = evstring_newfmt("%s.id", node_id);
+    evjson_entry *name_entry = evjs_get(new_json, name_id);
+    evstring_free(name_id);
+    if(name_entry == NULL) {
+      evstring_free(node_id);
+      continue;
+    }
+    evstring name = evstring_refclone(name_entry->as_str);
+
+    // The name compare guards against hash collisions
+    U32 match;
+    bool matched = indexmap_get(&old_slots, scenepaths_hash(name), &match)
+      && !old_matched[match] && !strcmp(old_names[match], name);
+
+    GameObject obj = 0;
+    if(matched) {
+      old_matched[match] = true;
+      obj = parent ? GameECS->getChildFromName(ecs_world, parent, name)
+                   : GameECS->getEntityFromName(ecs_world, name);
+    }
+
+    evstring old_node_id = matched ? evstring_newfmt("%s[%u]", old_array_id, match) : NULL;
+    if(obj == 0) {
+      ev_sceneloader_loadnode(scene, new_json, &node_id, parent);
+      stats->created++;
+    } else {
+      bool changed = scenehotreload_diffcomponents(scene, obj, new_json, node_id, old_json, old_node_id);
+      if(changed) {
+        stats->updated++;
+      } else {
+        stats->unchanged++;
+      }
+
+      evstring children_id = evstring_newfmt("%s.children", node_id);
+      evstring old_children_id = evstring_newfmt("%s.children", old_node_id);
+      scenehotreload_diffnodes(scene, new_json, children_id, old_json, old_children_id, obj, stats);
+      evstring_free(old_children_id);
+      evstring_free(children_id);
+    }
+
+    if(old_node_id) {
+      evstring_free(old_node_id);
+    }
+    evstring_free(name);
+    evstring_free(node_id);
+  }
+
+  for(U32 j = 0; j < old_count; j++) {
+    if(old_names[j] == NULL) {
+      continue;
+    }
+    if(!old_matched[j]) {
+      GameObject obj = parent ? GameECS->getChildFromName(ecs_world, parent, old_names[j])
+                              : GameECS->getEntityFromName(ecs_world, old_names[j]);
+      if(obj != 0) {
+        sceneobjects_destroyimmediate(scene, obj);
+        stats->destroyed++;
+      }
+    }
+    evstring_free(old_names[j]);
+  }
+
+  indexmap_fini(&old_slots);
+  vec_fini(old_matched);
+  vec_fini(old_names);
+}
+
+// Keeps the scene's source file parsed, as the baseline the next hot-reload
+// diffs against. Off by default, as the parsed file can be larger than the
+// scene itself. The file as it is when enabling becomes the baseline.
+void
+ev_scene_enablehotreload(
+    GameScene scene_handle,
+    bool enabled)
+{
+  GameScene scene_idx = scene_handle?scene_handle:GameData.activeScene;
+  GET_SCENE_OR_RETURN_VOID(scene, scene_idx);
+  if(scene->sourcePath == NULL) {
+    ev_log_warn("Hot-reload: scene { %llu } was not loaded from a file", scene_idx);
+    return;
+  }
+  if(enabled == (scene->sourceDesc != NULL)) {
+    return;
+  }
+
+  if(enabled) {
+    scene->sourceFile = Asset->load(scene->sourcePath);
+    scene->sourceDesc = (evjson_t*)JSONLoader->loadAsset(scene->sourceFile).json_data;
+  } else {
+    Asset->free(scene->sourceFile);
+    scene->sourceDesc = NULL;
+  }
+}
+
+SceneReloadStats
+ev_scene_hotreload(
+    GameScene scene_handle)
+{
+  GameScene scene_idx = scene_handle?scene_handle:GameData.activeScene;
+  GET_SCENE_OR_RETURN(scene, scene_idx, (SceneReloadStats){0});
+  SceneReloadStats stats = {0};
+
+  if(scene->sourceDesc == NULL) {
+    ev_log_warn("Hot-reload: not enabled for scene { %llu }, see Scene.enableHotReload", scene_idx);
+    return stats;
+  }
+
+  F64 start = ev_game_gettimems();
+
+  AssetHandle scenefile_handle = Asset->load(scene->sourcePath);
+  evjson_t *scene_desc = (evjson_t*)JSONLoader->loadAsset(scenefile_handle).json_data;
+
+  scenehotreload_diffnodes(scene_idx, scene_desc, "nodes", scene->sourceDesc, "nodes", 0, &stats);
+
+  evstring activeCamera = evstring_refclone(evjs_get(scene_desc, "activeCamera")->as_str);
+  ev_scene_setactivecamera(scene_idx, ev_scene_getobject(scene_idx, activeCamera));
+  evstring_free(activeCamera);
+
+  // Loading nodes can grow the scenes array
+  scene = ev_game_getscene(scene_idx);
+  Asset->free(scene->sourceFile);
+  scene->sourceFile = scenefile_handle;
+  scene->sourceDesc = scene_desc;
+
+  stats.durationMs = (F32)(ev_game_gettimems() - start);
+  ev_log_info("Hot-reloaded %s: %u created, %u updated, %u destroyed, %u unchanged in %.2fms",
+      scene->sourcePath, stats.created, stats.updated, stats.destroyed, stats.unchanged, stats.durationMs);
+
+  return stats;
+}
+
+U32
+scenelights_depthslice(
+    const SceneLightData *lights,
+    F32 depth)
+{
+  if(depth <= lights->clusterNear) {
+    return 0;
+  }
+  F32 slice = logf(depth / lights->clusterNear) / logf(lights->clusterFar / lights->clusterNear) * EV_GAME_LIGHTCLUSTERS_Z;
+  return slice >= EV_GAME_LIGHTCLUSTERS_Z ? EV_GAME_LIGHTCLUSTERS_Z - 1 : (U32)slice;
+}
+
+// Maps a view-space x (or y) extent at the given depth range to a tile
+// range. x/depth is monotonic in depth, so the extremes are at the ends.
+void
+scenelights_tilerange(
+    F32 lo,
+    F32 hi,
+    F32 depth_near,
+    F32 depth_far,
+    F32 tan_half_fov,
+    U32 tiles,
+    U32 *out_first,
+    U32 *out_last)
+{
+  F32 ndc_lo = lo / (depth_near * tan_half_fov);
+  F32 ndc_lo2 = lo / (depth_far * tan_half_fov);
+  F32 ndc_hi = hi / (depth_near * tan_half_fov);
+  F32 ndc_hi2 = hi / (depth_far * tan_half_fov);
+  ndc_lo = ndc_lo < ndc_lo2 ? ndc_lo : ndc_lo2;
+  ndc_hi = ndc_hi > ndc_hi2 ? ndc_hi : ndc_hi2;
+
+  F32 first = (ndc_lo * 0.5f + 0.5f) * tiles;
+  F32 last = (ndc_hi * 0.5f + 0.5f) * tiles;
+  *out_first = first <= 0.f ? 0 : (first >= tiles ? tiles - 1 : (U32)first);
+  *out_last = last <= 0.f ? 0 : (last >= tiles ? tiles - 1 : (U32)last);
+}
+
+const Matrix4x4 *
+_ev_object_getworldtransform(
+    GameScene world,
+    GameObject entt);
+
+// Bins this frame's visible bounded lights into the froxel grid: a counting
+// pass, a prefix sum, then a fill pass.
+void
+scenelights_buildclusters(
+    GameSceneStruct *scene)
+{
+  SceneLightData *lights = &scene->lights;
+  vec_setlen((vec_t*)&lights->clusterOffsets, EV_GAME_LIGHTCLUSTERS_COUNT);
+  vec_setlen((vec_t*)&lights->clusterCounts, EV_GAME_LIGHTCLUSTERS_COUNT);
+  memset(lights->clusterCounts, 0, EV_GAME_LIGHTCLUSTERS_COUNT * sizeof(U32));
+  vec_clear(lights->clusterIndices);
+
+  GameObject camera = scene->activeCamera;
+  if(camera == 0 || !GameECS->hasComponent(scene->ecs_world, camera, CameraComponentID)) {
+    memset(lights->clusterOffsets, 0, EV_GAME_LIGHTCLUSTERS_COUNT * sizeof(U32));
+    return;
+  }
+  const CameraComponent *cameraComp = GameECS->getComponent(scene->ecs_world, camera, CameraComponentID);
+  // The camera's world transform is only brought up to date on demand
+  const Matrix4x4 *cameraTransform = _ev_object_getworldtransform(scene_gethandle(scene), camera);
+  Matrix4x4 view;
+  glm_mat4_inv((vec4*)*cameraTransform, view);
+
+  lights->clusterNear = cameraComp->nearPlane;
+  lights->clusterFar = cameraComp->farPlane;
+  F32 tan_y = tanf(glm_rad(cameraComp->hfov) * 0.5f);
+  F32 tan_x = tan_y * cameraComp->aspectRatio;
+
+  U32 light_count = (U32)vec_len((vec_t*)&lights->frameSpheres);
+  vec_setlen((vec_t*)&lights->clusterRanges, light_count);
+  SceneLightClusterRange *ranges = lights->clusterRanges;
+  for(U32 l = 0; l < light_count; l++) {
+    Vec4 sphere = lights->frameSpheres[l];
+    F32 vx = view[0][0] * sphere.x + view[1][0] * sphere.y + view[2][0] * sphere.z + view[3][0];
+    F32 vy = view[0][1] * sphere.x + view[1][1] * sphere.y + view[2][1] * sphere.z + view[3][1];
+    F32 vz = view[0][2] * sphere.x + view[1][2] * sphere.y + view[2][2] * sphere.z + view[3][2];
+    F32 r = sphere.w;
+
+    // The camera looks down -Z
+    F32 depth_near = -vz - r;
+    F32 depth_far = -vz + r;
+    if(depth_far < lights->clusterNear || depth_near > lights->clusterFar) {
+      // Empty range, skipped by the fill pass
+      ranges[l][0] = 1;
+      ranges[l][1] = 0;
+      continue;
+    }
+    depth_near = depth_near > lights->clusterNear ? depth_near : lights->clusterNear;
+    depth_far = depth_far < lights->clusterFar ? depth_far : lights->clusterFar;
+
+    scenelights_tilerange(vx - r, vx + r, depth_near, depth_far, tan_x, EV_GAME_LIGHTCLUSTERS_X, &ranges[l][0], &ranges[l][1]);
+    scenelights_tilerange(vy - r, vy + r, depth_near, depth_far, tan_y, EV_GAME_LIGHTCLUSTERS_Y, &ranges[l][2], &ranges[l][3]);
+    ranges[l][4] = scenelights_depthslice(lights, depth_near);
+    ranges[l][5] = scenelights_depthslice(lights, depth_far);
+
+    for(U32 z = ranges[l][4]; z <= ranges[l][5]; z++) {
+      for(U32 y = ranges[l][2]; y <= ranges[l][3]; y++) {
+        for(U32 x = ranges[l][0]; x <= ranges[l][1]; x++) {
+          lights->clusterCounts[(z * EV_GAME_LIGHTCLUSTERS_Y + y) * EV_GAME_LIGHTCLUSTERS_X + x]++;
+        }
+      }
+    }
+  }
+
+  U32 total = 0;
+  for(U32 c = 0; c < EV_GAME_LIGHTCLUSTERS_COUNT; c++) {
+    lights->clusterOffsets[c] = total;
+    total += lights->clusterCounts[c];
+  }
+  vec_setlen((vec_t*)&lights->clusterIndices, total);
+
+  // Reuses the counts as fill cursors and restores them on the way
+  memset(lights->clusterCounts, 0, EV_GAME_LIGHTCLUSTERS_COUNT * sizeof(U32));
+  for(U32 l = 0; l < light_count; l++) {
+    if(ranges[l][0] > ranges[l][1]) {
+      continue;
+    }
+    for(U32 z = ranges[l][4]; z <= ranges[l][5]; z++) {
+      for(U32 y = ranges[l][2]; y <= ranges[l][3]; y++) {
+        for(U32 x = ranges[l][0]; x <= ranges[l][1]; x++) {
+          U32 c = (z * EV_GAME_LIGHTCLUSTERS_Y + y) * EV_GAME_LIGHTCLUSTERS_X + x;
+          lights->clusterIndices[lights->clusterOffsets[c] + lights->clusterCounts[c]++] = lights->frameIndices[l];
+        }
+      }
+    }
+  }
+}
+
+void
+renderbatch_flush(
+    GameSceneStruct *scene);
+void
+scenestatic_push(
+    GameSceneStruct *scene);
+U32
+ev_commands_apply();
+U32
+ev_scene_flushdestroyed(
+    GameScene scene_handle);
+
+U32
+ev_game_progress(
+    F32 deltaTime)
+{
+  U32 result = 0;
+
+  GameScene scene_handle = GameData.activeScene;
+  GameSceneStruct *scene = ev_game_getscene(scene_handle);
+  if(scene == NULL) {
+    return result;
+  }
+
+  GameData.deltaTime = deltaTime;
+  scenestreaming_update(scene_handle);
+
+  result |= PhysicsWorld->progress(scene->physics_world, deltaTime);
+  result |= Script->progress(deltaTime);
+  // Commands recorded by scripts and gameplay jobs, in time for this frame's
+  // systems
+  ev_commands_apply();
+  // Scripts and commands can create scenes, which may move the scenes array,
+  // or destroy this one
+  scene = ev_game_getscene(scene_handle);
+  if(scene == NULL) {
+    return result;
+  }
+  scene->culling.frustumChecked = false;
+  scene->culling.frame = (SceneCullingStats){0};
+  scene->lights.frame = (SceneLightStats){0};
+  scene->batching.frame = (SceneRenderBatchStats){0};
+  scene->lights.pushedLights = 0;
+  vec_clear(scene->lights.frameIndices);
+  vec_clear(scene->lights.frameSpheres);
+  result |= GameECS->progress(scene->ecs_world, deltaTime);
+  scenestatic_push(scene);
+  scene->culling.stats = scene->culling.frame;
+  scene->lights.stats = scene->lights.frame;
+  if(scene->batching.enabled) {
+    renderbatch_flush(scene);
+    scene->batching.stats = scene->batching.frame;
+  }
+  if(scene->lights.clustering) {
+    scenelights_buildclusters(scene);
+  }
+  // Commands and scripts can queue objects of any scene, not only the active
+  // one. Flushing doesn't move the scenes array.
+  for(U32 i = 1; i < vec_len((vec_t*)&GameData.scenes); i++) {
+    if(GameData.scenes[i].alive) {
+      ev_scene_flushdestroyed(scene_gethandle(&GameData.scenes[i]));
+    }
+  }
+
+  return result;
+}
+
+void
+ev_gamemod_scriptapi_loader(
+    EVNS_ScriptInterface *ScriptInterface,
+    ScriptContextHandle ctx_h);
+
+void
+transform_setdirty(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  // Static subtrees keep their baked world transforms
+  if(GameECS->hasTag(world, entt, DirtyTransformTagID) || GameECS->hasTag(world, entt, StaticTransformTagID)) {
+    return;
+  }
+
+  GameECS->addTag(world, entt, DirtyTransformTagID);
+  GameECS->forEachChild(world, entt, transform_setdirty);
+}
+
+void
+_ev_object_setrotation(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec4 new_rot)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(tr == NULL) {
+    return;
+  }
+  TransformComponent newTransform = {
+      .position = tr->position,
+      .rotation = new_rot,
+      .scale = tr->scale
+  };
+  GameECS->setComponent(scene->ecs_world, entt, TransformComponentID, &newTransform);
+  transform_setdirty(scene->ecs_world, entt);
+  sceneobjects_syncrigidbody(scene_handle, entt, &newTransform, false, true);
+}
+
+GameObject
+scenepaths_lookup(
+    GameSceneStruct *scene,
+    CONST_STR path)
+{
+  scene->path_stats.lookups++;
+  U32 slot;
+  // The string compare guards against hash collisions
+  if(indexmap_get(&scene->path_slots, scenepaths_hash(path), &slot) && !strcmp(scene->object_paths[slot], path)) {
+    scene->path_stats.hits++;
+    return scene->objects[slot];
+  }
+  return 0;
+}
+
+GameObject
+ev_scene_getobjectbypath(
+    GameScene scene_handle,
+    CONST_STR path)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  return scenepaths_lookup(scene, path);
+}
+
+GameObject
+ev_scene_getobject(
+    GameScene scene_handle,
+    CONST_STR name)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  GameObject res = scenepaths_lookup(scene, name);
+  if(res == 0) {
+    // Entities named outside of this module are not indexed
+    scene->path_stats.fallbacks++;
+    res = GameECS->getEntityFromName(scene->ecs_world, name);
+  }
+  return res;
+}
+
+GameObject
+ev_object_getchild(
+    GameScene scene_handle,
+    GameObject parent,
+    CONST_STR name)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  U32 parent_slot;
+  if(indexmap_get(&scene->object_slots, parent, &parent_slot) && scene->object_paths[parent_slot]) {
+    char path[EV_GAME_PATH_BUFFER_SIZE];
+    int path_len = snprintf(path, sizeof(path), "%s/%s", scene->object_paths[parent_slot], name);
+    if(path_len > 0 && (size_t)path_len < sizeof(path)) {
+      GameObject res = scenepaths_lookup(scene, path);
+      if(res) {
+        return res;
+      }
+    }
+  }
+  scene->path_stats.fallbacks++;
+  return GameECS->getChildFromName(scene->ecs_world, parent, name);
+}
+
+void
+ev_object_setname(
+    GameScene scene_handle,
+    GameObject obj,
+    CONST_STR name)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  GameECS->setEntityName(scene->ecs_world, obj, name);
+  scene_walk(scene, obj, scenepaths_refresh);
+}
+
+// (Re)captures a static object's render data into the baked arrays
+void
+scenestatic_capture(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  SceneStaticData *statics = &scene->statics;
+  if(!GameECS->hasComponent(scene->ecs_world, obj, RenderingData.RenderingComponentID)
+      || GameECS->hasTag(scene->ecs_world, obj, InactiveTagID)) {
+    return;
+  }
+
+  U32 slot;
+  if(!indexmap_get(&statics->slots, obj, &slot)) {
+    slot = (U32)vec_len((vec_t*)&statics->objects);
+    vec_setlen((vec_t*)&statics->objects, slot + 1);
+    vec_setlen((vec_t*)&statics->renderComponents, slot + 1);
+    vec_setlen((vec_t*)&statics->worldTransforms, slot + 1);
+    vec_setlen((vec_t*)&statics->spheres, slot + 1);
+    indexmap_set(&statics->slots, obj, slot);
+  }
+
+  const WorldTransformComponent *worldTransform = GameECS->getComponent(scene->ecs_world, obj, WorldTransformComponentID);
+  statics->objects[slot] = obj;
+  statics->renderComponents[slot] = *(const RenderComponent *)GameECS->getComponent(scene->ecs_world, obj, RenderingData.RenderingComponentID);
+  memcpy(statics->worldTransforms[slot], *worldTransform, sizeof(WorldTransformComponent));
+
+  Vec4 sphere = { 0.f, 0.f, 0.f, -1.f };
+  if(GameECS->hasComponent(scene->ecs_world, obj, BoundsComponentID)) {
+    const BoundsComponent *bounds = GameECS->getComponent(scene->ecs_world, obj, BoundsComponentID);
+    vec4 *m = (vec4 *)*worldTransform;
+    Vec3 c = bounds->center;
+    Vec3 e = bounds->extents;
+    sphere.x = m[0][0] * c.x + m[1][0] * c.y + m[2][0] * c.z + m[3][0];
+    sphere.y = m[0][1] * c.x + m[1][1] * c.y + m[2][1] * c.z + m[3][1];
+    sphere.z = m[0][2] * c.x + m[1][2] * c.y + m[2][2] * c.z + m[3][2];
+    F32 sx = m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2];
+    F32 sy = m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2];
+    F32 sz = m[2][0] * m[2][0] + m[2][1] * m[2][1] + m[2][2] * m[2][2];
+    F32 s = sx > sy ? (sx > sz ? sx : sz) : (sy > sz ? sy : sz);
+    sphere.w = sqrtf(s * (e.x * e.x + e.y * e.y + e.z * e.z));
+  }
+  statics->spheres[slot] = sphere;
+}
+
+// forEachChild callbacks; parents are handled before their children so that
+// each world transform is computed from an already final parent.
+void
+scenestatic_bakesubtree(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameSceneStruct *scene = SceneWalkScene;
+
+  if(!GameECS->hasTag(world, entt, StaticTransformTagID)) {
+    worldtransform_update(scene_gethandle(scene), entt);
+    GameECS->addTag(world, entt, StaticTransformTagID);
+    scenestatic_capture(scene, entt);
+  }
+  GameECS->forEachChild(world, entt, scenestatic_bakesubtree);
+}
+
+void
+scenestatic_unbakesubtree(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameSceneStruct *scene = SceneWalkScene;
+
+  if(GameECS->hasTag(world, entt, StaticTransformTagID)) {
+    GameECS->removeTag(world, entt, StaticTransformTagID);
+    scenestatic_remove(scene, entt);
+  }
+  GameECS->forEachChild(world, entt, scenestatic_unbakesubtree);
+}
+
+// Freezes (or thaws) the world transforms of `obj` and all of its
+// descendants. Transform changes made to a static object only apply once it
+// is made dynamic again.
+void
+ev_object_setstatic(
+    GameScene scene_handle,
+    GameObject obj,
+    bool isStatic)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  if(isStatic) {
+    scene_walk(scene, obj, scenestatic_bakesubtree);
+  } else {
+    scene_walk(scene, obj, scenestatic_unbakesubtree);
+    // Pick up anything that changed while it was frozen
+    transform_setdirty(scene->ecs_world, obj);
+  }
+}
+
+void
+scenebounds_update(
+    GameSceneStruct *scene,
+    GameObject obj);
+
+// forEachChild callbacks of ev_object_setactive. Deactivation drops the
+// object from every per-scene structure that doesn't go through the ECS
+// (BVH, render table, baked statics); activation puts it back. Both reuse
+// the slots freed before, so toggling a subtree doesn't allocate. Activation
+// stops at objects deactivated on their own. Script callbacks of inactive
+// objects are skipped in script_api.lua.
+void
+sceneactive_deactivatesubtree(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameSceneStruct *scene = SceneWalkScene;
+
+  if(!GameECS->hasTag(world, entt, InactiveTagID)) {
+    GameECS->addTag(world, entt, InactiveTagID);
+    U32 slot;
+    if(indexmap_get(&scene->object_slots, entt, &slot) && scene->object_proxies[slot] != SCENEBVH_NULL) {
+      scenebvh_destroyproxy(&scene->bvh, scene->object_proxies[slot]);
+      scene->object_proxies[slot] = SCENEBVH_NULL;
+    }
+    scenestatic_remove(scene, entt);
+  }
+  GameECS->forEachChild(world, entt, sceneactive_deactivatesubtree);
+}
+
+void
+sceneactive_activatesubtree(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  GameSceneStruct *scene = SceneWalkScene;
+  if(GameECS->hasTag(world, entt, InactiveSelfTagID)) {
+    return;
+  }
+
+  if(GameECS->hasTag(world, entt, InactiveTagID)) {
+    GameECS->removeTag(world, entt, InactiveTagID);
+    scenebounds_update(scene, entt);
+    if(GameECS->hasTag(world, entt, StaticTransformTagID)) {
+      scenestatic_capture(scene, entt);
+    }
+  }
+  GameECS->forEachChild(world, entt, sceneactive_activatesubtree);
+}
+
+// Brings the subtree of `obj` in line with its own state and its parent's,
+// after either of them changed
+void
+sceneactive_refresh(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  GameObject parent = GameECS->getParent(scene->ecs_world, obj);
+  if(parent != 0 && GameECS->hasTag(scene->ecs_world, parent, InactiveTagID)) {
+    scene_walk(scene, obj, sceneactive_deactivatesubtree);
+  } else if(GameECS->hasTag(scene->ecs_world, obj, InactiveSelfTagID)) {
+    scene_walk(scene, obj, sceneactive_deactivatesubtree);
+  } else {
+    scene_walk(scene, obj, sceneactive_activatesubtree);
+  }
+}
+
+// Activates or deactivates `obj` itself. Its descendants follow, except those
+// that were deactivated on their own, which stay inactive. An object under an
+// inactive parent only becomes active once the parent does.
+void
+ev_object_setactive(
+    GameScene scene_handle,
+    GameObject obj,
+    bool active)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  if(active) {
+    if(GameECS->hasTag(scene->ecs_world, obj, InactiveSelfTagID)) {
+      GameECS->removeTag(scene->ecs_world, obj, InactiveSelfTagID);
+    }
+  } else if(!GameECS->hasTag(scene->ecs_world, obj, InactiveSelfTagID)) {
+    GameECS->addTag(scene->ecs_world, obj, InactiveSelfTagID);
+  }
+  sceneactive_refresh(scene, obj);
+}
+
+bool
+ev_object_isactive(
+    GameScene scene_handle,
+    GameObject obj)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  return !GameECS->hasTag(scene->ecs_world, obj, InactiveTagID);
+}
+
+// Pauses or resumes the object's AnimationComponent, if it has one. A track
+// that ran out plays again from where its playhead is.
+void
+ev_object_setanimationplaying(
+    GameScene scene_handle,
+    GameObject obj,
+    bool playing)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  if(!GameECS->hasComponent(scene->ecs_world, obj, AnimationComponentID)) {
+    return;
+  }
+  AnimationComponent *comp = GameECS->getComponentMut(scene->ecs_world, obj, AnimationComponentID);
+  comp->playing = playing;
+}
+
+bool
+ev_object_isanimationplaying(
+    GameScene scene_handle,
+    GameObject obj)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  if(!GameECS->hasComponent(scene->ecs_world, obj, AnimationComponentID)) {
+    return false;
+  }
+  const AnimationComponent *comp = GameECS->getComponent(scene->ecs_world, obj, AnimationComponentID);
+  return comp->playing;
+}
+
+// Moves the playhead. The pose is sampled on the next frame the track plays.
+void
+ev_object_setanimationtime(
+    GameScene scene_handle,
+    GameObject obj,
+    F32 time)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  if(!GameECS->hasComponent(scene->ecs_world, obj, AnimationComponentID)) {
+    return;
+  }
+  AnimationComponent *comp = GameECS->getComponentMut(scene->ecs_world, obj, AnimationComponentID);
+  comp->time = time;
+}
+
+ScenePrefabPool *
+sceneprefabpools_get(
+    GameSceneStruct *scene,
+    CONST_STR prefabPath,
+    bool create,
+    U32 *out_slot)
+{
+  ScenePrefabPools *prefab_pools = &scene->prefab_pools;
+  U64 hash = scenepaths_hash(prefabPath);
+  U32 slot;
+  bool indexed = indexmap_get(&prefab_pools->poolSlots, hash, &slot);
+  bool found = indexed && !strcmp(prefab_pools->pools[slot].path, prefabPath);
+  if(indexed && !found) {
+    U32 pool_count = (U32)vec_len((vec_t*)&prefab_pools->pools);
+    for(slot = 0; slot < pool_count; slot++) {
+      ScenePrefabPool *pool = &prefab_pools->pools[slot];
+      if(pool->pathHash == hash && !strcmp(pool->path, prefabPath)) {
+        found = true;
+        break;
+      }
+    }
+  }
+  if(!found) {
+    if(!create) {
+      return NULL;
+    }
+    slot = (U32)vec_len((vec_t*)&prefab_pools->pools);
+    ScenePrefabPool pool = {
+      .pathHash = hash,
+      .path = scenearena_strdup(&scene->arena, prefabPath),
+      .templateTransforms = vec_init(TransformComponent, NULL, NULL),
+      .templateMasks = vec_init(U32, NULL, NULL),
+      .templateData = vec_init(U8, NULL, NULL),
+      .available = vec_init(GameObject, NULL, NULL),
+    };
+    vec_push((vec_t*)&prefab_pools->pools, &pool);
+    if(!indexed) {
+      indexmap_set(&prefab_pools->poolSlots, hash, slot);
+    }
+  }
+  if(out_slot) {
+    *out_slot = slot;
+  }
+  return &prefab_pools->pools[slot];
+}
+
+// Components reset on acquire besides the transforms, in template order
+#define SCENEPREFAB_TEMPLATE_COMPONENTS 5
+
+void
+sceneprefabpools_components(
+    GameComponentID ids[SCENEPREFAB_TEMPLATE_COMPONENTS],
+    size_t sizes[SCENEPREFAB_TEMPLATE_COMPONENTS])
+{
+  ids[0] = CameraComponentID;
+  sizes[0] = sizeof(CameraComponent);
+  ids[1] = RenderingData.RenderingComponentID;
+  sizes[1] = sizeof(RenderComponent);
+  ids[2] = RenderingData.LightComponentID;
+  sizes[2] = sizeof(LightComponent);
+  ids[3] = BoundsComponentID;
+  sizes[3] = sizeof(BoundsComponent);
+  ids[4] = AnimationComponentID;
+  sizes[4] = sizeof(AnimationComponent);
+}
+
+// forEachChild has no user data; the instance is collected here while walking
+static vec(GameObject) *PrefabWalkObjects;
+
+void
+sceneprefabpools_collect(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  vec_push((vec_t*)PrefabWalkObjects, &entt);
+  GameECS->forEachChild(world, entt, sceneprefabpools_collect);
+}
+
+// Fills `walk` with the instance rooted at `root`, depth-first
+U32
+sceneprefabpools_walk(
+    GameSceneStruct *scene,
+    GameObject root)
+{
+  vec_clear(scene->prefab_pools.walk);
+  PrefabWalkObjects = &scene->prefab_pools.walk;
+  sceneprefabpools_collect(scene->ecs_world, root);
+  PrefabWalkObjects = NULL;
+  return (U32)vec_len((vec_t*)&scene->prefab_pools.walk);
+}
+
+void
+sceneprefabpools_capture(
+    GameSceneStruct *scene,
+    ScenePrefabPool *pool,
+    GameObject root)
+{
+  GameComponentID ids[SCENEPREFAB_TEMPLATE_COMPONENTS];
+  size_t sizes[SCENEPREFAB_TEMPLATE_COMPONENTS];
+  sceneprefabpools_components(ids, sizes);
+
+  U32 object_count = sceneprefabpools_walk(scene, root);
+  for(U32 i = 0; i < object_count; i++) {
+    GameObject obj = scene->prefab_pools.walk[i];
+    vec_push((vec_t*)&pool->templateTransforms, (PTR)GameECS->getComponent(scene->ecs_world, obj, TransformComponentID));
+    U32 mask = 0;
+    for(U32 c = 0; c < SCENEPREFAB_TEMPLATE_COMPONENTS; c++) {
+      if(!GameECS->hasComponent(scene->ecs_world, obj, ids[c])) {
+        continue;
+      }
+      mask |= 1u << c;
+      size_t offset = vec_len((vec_t*)&pool->templateData);
+      vec_setlen((vec_t*)&pool->templateData, offset + sizes[c]);
+      memcpy(pool->templateData + offset, GameECS->getComponent(scene->ecs_world, obj, ids[c]), sizes[c]);
+    }
+    vec_push((vec_t*)&pool->templateMasks, &mask);
+  }
+  pool->hasTemplate = true;
+}
+
+// Puts every object of an instance back into the template's state: local
+// transforms, rigidbody poses and velocities, and the components the
+// template covers, stripping the ones gained since. Objects added to the
+// instance after loading are left alone.
+void
+sceneprefabpools_reset(
+    GameScene scene_handle,
+    GameSceneStruct *scene,
+    ScenePrefabPool *pool,
+    GameObject root)
+{
+  GameComponentID ids[SCENEPREFAB_TEMPLATE_COMPONENTS];
+  size_t sizes[SCENEPREFAB_TEMPLATE_COMPONENTS];
+  sceneprefabpools_components(ids, sizes);
+
+  U32 object_count = sceneprefabpools_walk(scene, root);
+  U32 template_count = (U32)vec_len((vec_t*)&pool->templateTransforms);
+  if(object_count > template_count) {
+    object_count = template_count;
+  }
+  size_t offset = 0;
+  for(U32 i = 0; i < object_count; i++) {
+    GameObject obj = scene->prefab_pools.walk[i];
+    TransformComponent *transform = &pool->templateTransforms[i];
+    if(i > 0) {
+      // The root's transform is set last, dirtying the whole instance
+      GameECS->setComponent(scene->ecs_world, obj, TransformComponentID, transform);
+    }
+    sceneobjects_syncrigidbody(scene_handle, obj, transform, true, true);
+    RigidbodyHandle rb = Rigidbody->getFromEntity(scene_handle, obj);
+    if(rb) {
+      Rigidbody->setVelocity(rb, (Vec3){0});
+    }
+
+    U32 mask = pool->templateMasks[i];
+    for(U32 c = 0; c < SCENEPREFAB_TEMPLATE_COMPONENTS; c++) {
+      if(mask & (1u << c)) {
+        ev_object_setcomponent(scene_handle, obj, ids[c], pool->templateData + offset);
+        offset += sizes[c];
+      } else if(GameECS->hasComponent(scene->ecs_world, obj, ids[c])) {
+        scenesnapshot_removecomponent(scene, obj, ids[c]);
+      }
+    }
+  }
+  TransformComponent *rootTransform = &pool->templateTransforms[0];
+  ev_object_settransform(scene_handle, root, rootTransform->position, rootTransform->rotation, rootTransform->scale);
+}
+
+// Loads a new instance of the pool's prefab, deactivated
+GameObject
+sceneprefabpools_instantiate(
+    GameScene scene_handle,
+    GameSceneStruct *scene,
+    U32 pool_slot)
+{
+  GameObject obj = ev_sceneloader_loadprefab(scene_handle, scene->prefab_pools.pools[pool_slot].path);
+  ScenePrefabPool *pool = &scene->prefab_pools.pools[pool_slot];
+  if(!pool->hasTemplate) {
+    sceneprefabpools_capture(scene, pool, obj);
+  }
+  indexmap_set(&scene->prefab_pools.objectPools, obj, pool_slot);
+  ev_object_setactive(scene_handle, obj, false);
+  return obj;
+}
+
+// Instantiates `count` more pooled instances of the prefab ahead of use
+void
+ev_scene_warmpool(
+    GameScene scene_handle,
+    CONST_STR prefabPath,
+    U32 count)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  U32 pool_slot;
+  sceneprefabpools_get(scene, prefabPath, true, &pool_slot);
+  for(U32 i = 0; i < count; i++) {
+    GameObject obj = sceneprefabpools_instantiate(scene_handle, scene, pool_slot);
+    ScenePrefabPool *pool = &scene->prefab_pools.pools[pool_slot];
+    vec_push((vec_t*)&pool->available, &obj);
+    pool->stats.available++;
+  }
+}
+
+// Takes an instance of the prefab out of its pool, loading a new one when the
+// pool is empty. The whole instance is reset to the state the prefab was
+// first loaded with (see sceneprefabpools_reset) and is returned deactivated,
+// so that it can be set up before being shown with Object.setActive.
+GameObject
+ev_scene_acquire(
+    GameScene scene_handle,
+    CONST_STR prefabPath)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  U32 pool_slot;
+  ScenePrefabPool *pool = sceneprefabpools_get(scene, prefabPath, true, &pool_slot);
+
+  GameObject obj;
+  size_t available_count = vec_len((vec_t*)&pool->available);
+  if(available_count > 0) {
+    obj = pool->available[available_count - 1];
+    vec_setlen((vec_t*)&pool->available, available_count - 1);
+    pool->stats.available--;
+    pool->stats.hits++;
+  } else {
+    pool->stats.misses++;
+    obj = sceneprefabpools_instantiate(scene_handle, scene, pool_slot);
+    pool = &scene->prefab_pools.pools[pool_slot];
+  }
+  pool->stats.live++;
+
+  sceneprefabpools_reset(scene_handle, scene, pool, obj);
+  return obj;
+}
+
+// Deactivates an acquired instance and returns it to its pool. Returns false
+// (and leaves the object alone) if it didn't come from a pool.
+bool
+ev_scene_release(
+    GameScene scene_handle,
+    GameObject obj)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  U32 pool_slot;
+  if(!indexmap_get(&scene->prefab_pools.objectPools, obj, &pool_slot)) {
+    return false;
+  }
+  ScenePrefabPool *pool = &scene->prefab_pools.pools[pool_slot];
+  if(!ev_object_isactive(scene_handle, obj)) {
+    // Either already released or acquired and never activated
+    for(size_t i = 0; i < vec_len((vec_t*)&pool->available); i++) {
+      if(pool->available[i] == obj) {
+        return true;
+      }
+    }
+  }
+
+  ev_object_setactive(scene_handle, obj, false);
+  vec_push((vec_t*)&pool->available, &obj);
+  pool->stats.available++;
+  pool->stats.live--;
+  return true;
+}
+
+ScenePoolStats
+ev_scene_getpoolstats(
+    GameScene scene_handle,
+    CONST_STR prefabPath)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (ScenePoolStats){0});
+  ScenePrefabPool *pool = sceneprefabpools_get(scene, prefabPath, false, NULL);
+  return pool ? pool->stats : (ScenePoolStats){0};
+}
+
+bool
+ev_object_isstatic(
+    GameScene scene_handle,
+    GameObject obj)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  return GameECS->hasTag(scene->ecs_world, obj, StaticTransformTagID);
+}
+
+void
+ev_object_setbounds(
+    GameScene scene_handle,
+    GameObject obj,
+    Vec3 center,
+    Vec3 extents)
+{
+  ev_object_setcomponent(scene_handle, obj, BoundsComponentID, &(BoundsComponent) {
+      .center = center,
+      .extents = extents,
+  });
+}
+
+bool
+scenebvh_boxoverlap(
+    const F32 amin[3],
+    const F32 amax[3],
+    const F32 bmin[3],
+    const F32 bmax[3])
+{
+  return amin[0] <= bmax[0] && amax[0] >= bmin[0]
+      && amin[1] <= bmax[1] && amax[1] >= bmin[1]
+      && amin[2] <= bmax[2] && amax[2] >= bmin[2];
+}
+
+F32
+scenebvh_boxdistance2(
+    const F32 min[3],
+    const F32 max[3],
+    const F32 point[3])
+{
+  F32 dist2 = 0.f;
+  for(U32 i = 0; i < 3; i++) {
+    F32 d = 0.f;
+    if(point[i] < min[i]) {
+      d = min[i] - point[i];
+    } else if(point[i] > max[i]) {
+      d = point[i] - max[i];
+    }
+    dist2 += d * d;
+  }
+  return dist2;
+}
+
+// Slab test; on a hit, `t_out` is where the ray enters the box (0 if it
+// starts inside)
+bool
+scenebvh_rayslab(
+    const F32 min[3],
+    const F32 max[3],
+    const F32 origin[3],
+    const F32 inv_dir[3],
+    F32 max_t,
+    F32 *t_out)
+{
+  F32 t_enter = 0.f;
+  F32 t_exit = max_t;
+  for(U32 i = 0; i < 3; i++) {
+    F32 t1 = (min[i] - origin[i]) * inv_dir[i];
+    F32 t2 = (max[i] - origin[i]) * inv_dir[i];
+    if(t1 > t2) {
+      F32 tmp = t1;
+      t1 = t2;
+      t2 = tmp;
+    }
+    t_enter = t1 > t_enter ? t1 : t_enter;
+    t_exit = t2 < t_exit ? t2 : t_exit;
+    if(t_enter > t_exit) {
+      return false;
+    }
+  }
+  *t_out = t_enter;
+  return true;
+}
+
+// Traversals take their stack as a parameter so that read-only queries can
+// run concurrently, each with its own stack.
+U32
+scenebvh_popnode(
+    vec(U32) *stack)
+{
+  size_t top = vec_len((vec_t*)stack) - 1;
+  U32 idx = (*stack)[top];
+  vec_setlen((vec_t*)stack, top);
+  return idx;
+}
+
+void
+scenebvh_pushchildren(
+    vec(U32) *stack,
+    SceneBVHNode *node)
+{
+  vec_push((vec_t*)stack, &node->child1);
+  vec_push((vec_t*)stack, &node->child2);
+}
+
+// Fills `bvh->results` with the objects whose bounds overlap the box
+U32
+scenebvh_querybox(
+    SceneBVH *bvh,
+    const F32 min[3],
+    const F32 max[3])
+{
+  vec_clear(bvh->results);
+  vec_clear(bvh->stack);
+  if(bvh->root != SCENEBVH_NULL) {
+    vec_push((vec_t*)&bvh->stack, &bvh->root);
+  }
+
+  while(vec_len((vec_t*)&bvh->stack) > 0) {
+    SceneBVHNode *node = &bvh->nodes[scenebvh_popnode(&bvh->stack)];
+    if(!scenebvh_boxoverlap(node->min, node->max, min, max)) {
+      continue;
+    }
+    if(node->height > 0) {
+      scenebvh_pushchildren(&bvh->stack, node);
+    } else if(scenebvh_boxoverlap(node->objectMin, node->objectMax, min, max)) {
+      vec_push((vec_t*)&bvh->results, &node->object);
+    }
+  }
+  return (U32)vec_len((vec_t*)&bvh->results);
+}
+
+// Fills `bvh->results` with the objects whose bounds overlap the sphere
+U32
+scenebvh_querysphere(
+    SceneBVH *bvh,
+    const F32 center[3],
+    F32 radius)
+{
+  F32 radius2 = radius * radius;
+  vec_clear(bvh->results);
+  vec_clear(bvh->stack);
+  if(bvh->root != SCENEBVH_NULL) {
+    vec_push((vec_t*)&bvh->stack, &bvh->root);
+  }
+
+  while(vec_len((vec_t*)&bvh->stack) > 0) {
+    SceneBVHNode *node = &bvh->nodes[scenebvh_popnode(&bvh->stack)];
+    if(scenebvh_boxdistance2(node->min, node->max, center) > radius2) {
+      continue;
+    }
+    if(node->height > 0) {
+      scenebvh_pushchildren(&bvh->stack, node);
+    } else if(scenebvh_boxdistance2(node->objectMin, node->objectMax, center) <= radius2) {
+      vec_push((vec_t*)&bvh->results, &node->object);
+    }
+  }
+  return (U32)vec_len((vec_t*)&bvh->results);
+}
+
+// Closest object whose bounds the ray hits. `direction` must be normalized.
+bool
+scenebvh_raycast(
+    const SceneBVH *bvh,
+    vec(U32) *stack,
+    const F32 origin[3],
+    const F32 direction[3],
+    F32 max_distance,
+    SceneBoundsHit *hit)
+{
+  F32 inv_dir[3] = { 1.f / direction[0], 1.f / direction[1], 1.f / direction[2] };
+  F32 closest = max_distance;
+  bool found = false;
+
+  vec_clear(*stack);
+  if(bvh->root != SCENEBVH_NULL) {
+    vec_push((vec_t*)stack, (PTR)&bvh->root);
+  }
+
+  while(vec_len((vec_t*)stack) > 0) {
+    SceneBVHNode *node = &bvh->nodes[scenebvh_popnode(stack)];
+    F32 t;
+    // Subtrees entered past the closest hit so far can't do any better
+    if(!scenebvh_rayslab(node->min, node->max, origin, inv_dir, closest, &t)) {
+      continue;
+    }
+    if(node->height > 0) {
+      scenebvh_pushchildren(stack, node);
+    } else if(scenebvh_rayslab(node->objectMin, node->objectMax, origin, inv_dir, closest, &t)) {
+      closest = t;
+      hit->object = node->object;
+      hit->distance = t;
+      found = true;
+    }
+  }
+  return found;
+}
+
+// Writes up to `max_results` objects overlapping the sphere to `out` and
+// returns the total number of them
+U32
+scenebvh_overlapsphere(
+    const SceneBVH *bvh,
+    vec(U32) *stack,
+    const F32 center[3],
+    F32 radius,
+    GameObject *out,
+    U32 max_results)
+{
+  F32 radius2 = radius * radius;
+  U32 count = 0;
+  vec_clear(*stack);
+  if(bvh->root != SCENEBVH_NULL) {
+    vec_push((vec_t*)stack, (PTR)&bvh->root);
+  }
+
+  while(vec_len((vec_t*)stack) > 0) {
+    SceneBVHNode *node = &bvh->nodes[scenebvh_popnode(stack)];
+    if(scenebvh_boxdistance2(node->min, node->max, center) > radius2) {
+      continue;
+    }
+    if(node->height > 0) {
+      scenebvh_pushchildren(stack, node);
+    } else if(scenebvh_boxdistance2(node->objectMin, node->objectMax, center) <= radius2) {
+      if(count < max_results) {
+        out[count] = node->object;
+      }
+      count++;
+    }
+  }
+  return count;
+}
+
+U32
+scenebvh_copyresults(
+    const SceneBVH *bvh,
+    GameObject *out,
+    U32 max_results)
+{
+  U32 count = (U32)vec_len((vec_t*)&bvh->results);
+  if(out) {
+    memcpy(out, bvh->results, (count < max_results ? count : max_results) * sizeof(GameObject));
+  }
+  return count;
+}
+
+// Writes up to `max_results` objects to `out` and returns the total number of
+// hits, which can be larger.
+U32
+ev_scene_querybox(
+    GameScene scene_handle,
+    Vec3 min,
+    Vec3 max,
+    GameObject *out,
+    U32 max_results)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  SceneBVH *bvh = &scene->bvh;
+  scenebvh_querybox(bvh, (F32[3]){ min.x, min.y, min.z }, (F32[3]){ max.x, max.y, max.z });
+  return scenebvh_copyresults(bvh, out, max_results);
+}
+
+U32
+ev_scene_querysphere(
+    GameScene scene_handle,
+    Vec3 center,
+    F32 radius,
+    GameObject *out,
+    U32 max_results)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  SceneBVH *bvh = &scene->bvh;
+  scenebvh_querysphere(bvh, (F32[3]){ center.x, center.y, center.z }, radius);
+  return scenebvh_copyresults(bvh, out, max_results);
+}
+
+bool
+ev_scene_raycastbounds(
+    GameScene scene_handle,
+    Vec3 origin,
+    Vec3 direction,
+    F32 maxDistance,
+    SceneBoundsHit *out_hit)
+{
+  F32 len = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+  if(len == 0.f) {
+    return false;
+  }
+
+  SceneBoundsHit hit = {0};
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  SceneBVH *bvh = &scene->bvh;
+  bool found = scenebvh_raycast(bvh, &bvh->stack,
+      (F32[3]){ origin.x, origin.y, origin.z },
+      (F32[3]){ direction.x / len, direction.y / len, direction.z / len },
+      maxDistance, &hit);
+  if(found && out_hit) {
+    *out_hit = hit;
+  }
+  return found;
+}
+
+// Claims chunks of the current batch until none are left
+void
+queryworkers_drain(
+    U32 worker)
+{
+  for(;;) {
+    pthread_mutex_lock(&QueryWorkers.lock);
+    U32 begin = QueryWorkers.nextItem;
+    QueryWorkers.nextItem += EV_GAME_QUERYBATCH_CHUNK;
+    pthread_mutex_unlock(&QueryWorkers.lock);
+    if(begin >= QueryWorkers.itemCount) {
+      return;
+    }
+    U32 end = begin + EV_GAME_QUERYBATCH_CHUNK;
+    if(end > QueryWorkers.itemCount) {
+      end = QueryWorkers.itemCount;
+    }
+    QueryWorkers.fn(QueryWorkers.ctx, begin, end, &QueryWorkers.stacks[worker]);
+  }
+}
+
+void *
+queryworkers_main(
+    void *arg)
+{
+  U32 worker = (U32)(uintptr_t)arg;
+  U64 generation = 0;
+
+  pthread_mutex_lock(&QueryWorkers.lock);
+  for(;;) {
+    while(!QueryWorkers.shutdown && QueryWorkers.generation == generation) {
+      pthread_cond_wait(&QueryWorkers.wake, &QueryWorkers.lock);
+    }
+    if(QueryWorkers.shutdown) {
+      break;
+    }
+    generation = QueryWorkers.generation;
+    pthread_mutex_unlock(&QueryWorkers.lock);
+
+    queryworkers_drain(worker);
+
+    pthread_mutex_lock(&QueryWorkers.lock);
+    if(--QueryWorkers.busyWorkers == 0) {
+      pthread_cond_signal(&QueryWorkers.done);
+    }
+  }
+  pthread_mutex_unlock(&QueryWorkers.lock);
+  return NULL;
+}
+
+// Threads are only spawned once a batch is large enough to need them
+void
+queryworkers_start()
+{
+  if(QueryWorkers.started) {
+    return;
+  }
+  QueryWorkers.started = true;
+  pthread_mutex_init(&QueryWorkers.lock, NULL);
+  pthread_cond_init(&QueryWorkers.wake, NULL);
+  pthread_cond_init(&QueryWorkers.done, NULL);
+  for(U32 i = 0; i < EV_GAME_QUERY_WORKERS; i++) {
+    if(pthread_create(&QueryWorkers.threads[QueryWorkers.threadCount], NULL, queryworkers_main, (void *)(uintptr_t)QueryWorkers.threadCount)) {
+      ev_log_warn("Failed to start spatial query worker %u", i);
+      break;
+    }
+    QueryWorkers.threadCount++;
+  }
+}
+
+void
+queryworkers_stop()
+{
+  if(!QueryWorkers.started) {
+    return;
+  }
+  pthread_mutex_lock(&QueryWorkers.lock);
+  QueryWorkers.shutdown = true;
+  pthread_cond_broadcast(&QueryWorkers.wake);
+  pthread_mutex_unlock(&QueryWorkers.lock);
+  for(U32 i = 0; i < QueryWorkers.threadCount; i++) {
+    pthread_join(QueryWorkers.threads[i], NULL);
+  }
+  pthread_cond_destroy(&QueryWorkers.done);
+  pthread_cond_destroy(&QueryWorkers.wake);
+  pthread_mutex_destroy(&QueryWorkers.lock);
+  QueryWorkers.started = false;
+  QueryWorkers.threadCount = 0;
+}
+
+// Runs `fn` over [0, count), split across the pool for large batches.
+// Returns once every item is done.
+void
+queryworkers_run(
+    QueryBatchFn fn,
+    PTR ctx,
+    U32 count)
+{
+  PTR callerStack = &QueryWorkers.stacks[EV_GAME_QUERY_WORKERS];
+  if(count < EV_GAME_QUERYBATCH_PARALLEL_MIN) {
+    fn(ctx, 0, count, callerStack);
+    return;
+  }
+  queryworkers_start();
+  if(QueryWorkers.threadCount == 0) {
+    fn(ctx, 0, count, callerStack);
+    return;
+  }
+
+  pthread_mutex_lock(&QueryWorkers.lock);
+  QueryWorkers.fn = fn;
+  QueryWorkers.ctx = ctx;
+  QueryWorkers.itemCount = count;
+  QueryWorkers.nextItem = 0;
+  QueryWorkers.busyWorkers = QueryWorkers.threadCount;
+  QueryWorkers.generation++;
+  pthread_cond_broadcast(&QueryWorkers.wake);
+  pthread_mutex_unlock(&QueryWorkers.lock);
+
+  queryworkers_drain(EV_GAME_QUERY_WORKERS);
+
+  pthread_mutex_lock(&QueryWorkers.lock);
+  while(QueryWorkers.busyWorkers > 0) {
+    pthread_cond_wait(&QueryWorkers.done, &QueryWorkers.lock);
+  }
+  pthread_mutex_unlock(&QueryWorkers.lock);
+}
+
+typedef struct {
+  const SceneBVH *bvh;
+  const SceneRaycastQuery *queries;
+  SceneBoundsHit *hits;
+} RaycastBatchJob;
+
+void
+raycastbatch_run(
+    PTR ctx,
+    U32 begin,
+    U32 end,
+    vec(U32) *stack)
+{
+  RaycastBatchJob *job = ctx;
+  for(U32 i = begin; i < end; i++) {
+    const SceneRaycastQuery *query = &job->queries[i];
+    Vec3 dir = query->direction;
+    F32 len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+    job->hits[i] = (SceneBoundsHit){0};
+    if(len == 0.f) {
+      continue;
+    }
+    scenebvh_raycast(job->bvh, stack,
+        (F32[3]){ query->origin.x, query->origin.y, query->origin.z },
+        (F32[3]){ dir.x / len, dir.y / len, dir.z / len },
+        query->maxDistance, &job->hits[i]);
+  }
+}
+
+typedef struct {
+  const SceneBVH *bvh;
+  const SceneOverlapQuery *queries;
+  U32 *counts;
+  GameObject *objects;
+  U32 maxResults;
+} OverlapBatchJob;
+
+void
+overlapbatch_run(
+    PTR ctx,
+    U32 begin,
+    U32 end,
+    vec(U32) *stack)
+{
+  OverlapBatchJob *job = ctx;
+  for(U32 i = begin; i < end; i++) {
+    const SceneOverlapQuery *query = &job->queries[i];
+    job->counts[i] = scenebvh_overlapsphere(job->bvh, stack,
+        (F32[3]){ query->center.x, query->center.y, query->center.z }, query->radius,
+        job->objects + (U64)i * job->maxResults, job->maxResults);
+  }
+}
+
+// Casts all rays at once against the BoundsComponent BVH; this is not a
+// physics query, so hits are on bounds, not collision shapes, and objects
+// without bounds are never hit. `out_hits[i].object` is 0 for rays that hit
+// nothing. Returns the number of rays that hit.
+U32
+ev_scene_raycastbatch(
+    GameScene scene_handle,
+    const SceneRaycastQuery *queries,
+    U32 count,
+    SceneBoundsHit *out_hits)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  RaycastBatchJob job = {
+    .bvh = &scene->bvh,
+    .queries = queries,
+    .hits = out_hits,
+  };
+  queryworkers_run(raycastbatch_run, &job, count);
+
+  U32 hitCount = 0;
+  for(U32 i = 0; i < count; i++) {
+    hitCount += out_hits[i].object != 0;
+  }
+  return hitCount;
+}
+
+// Runs all sphere overlaps at once against the BoundsComponent BVH; this is
+// not a physics query, so only objects with bounds are found. Query `i`
+// writes up to `max_results` objects starting at
+// `out_objects[i * max_results]`; `out_counts[i]` is its total number of
+// overlaps, which can be larger.
+void
+ev_scene_overlapbatch(
+    GameScene scene_handle,
+    const SceneOverlapQuery *queries,
+    U32 count,
+    U32 *out_counts,
+    GameObject *out_objects,
+    U32 max_results)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  OverlapBatchJob job = {
+    .bvh = &scene->bvh,
+    .queries = queries,
+    .counts = out_counts,
+    .objects = out_objects,
+    .maxResults = max_results,
+  };
+  queryworkers_run(overlapbatch_run, &job, count);
+}
+
+SceneArenaStats
+ev_scene_getarenastats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneArenaStats){0});
+  return scene->arena.stats;
+}
+
+ScenePathIndexStats
+ev_scene_getpathindexstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (ScenePathIndexStats){0});
+  return scene->path_stats;
+}
+
+void
+ev_scene_setrenderbatching(
+    GameScene scene_handle,
+    bool enabled)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  scene->batching.enabled = enabled;
+}
+
+SceneRenderBatchStats
+ev_scene_getrenderbatchstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneRenderBatchStats){0});
+  return scene->batching.stats;
+}
+
+SceneLightStats
+ev_scene_getlightstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneLightStats){0});
+  return scene->lights.stats;
+}
+
+void
+ev_scene_setlightclustering(
+    GameScene scene_handle,
+    bool enabled)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  scene->lights.clustering = enabled;
+}
+
+// Light indices refer to the order lights were handed to
+// `Light->addFrameLightData` during the last frame.
+SceneLightClusters
+ev_scene_getlightclusters(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneLightClusters){0});
+  SceneLightData *lights = &scene->lights;
+  if(!lights->clustering || vec_len((vec_t*)&lights->clusterOffsets) == 0) {
+    return (SceneLightClusters){0};
+  }
+  return (SceneLightClusters) {
+    .dimX = EV_GAME_LIGHTCLUSTERS_X,
+    .dimY = EV_GAME_LIGHTCLUSTERS_Y,
+    .dimZ = EV_GAME_LIGHTCLUSTERS_Z,
+    .nearPlane = lights->clusterNear,
+    .farPlane = lights->clusterFar,
+    .indexCount = (U32)vec_len((vec_t*)&lights->clusterIndices),
+    .offsets = lights->clusterOffsets,
+    .counts = lights->clusterCounts,
+    .lightIndices = lights->clusterIndices,
+  };
+}
+
+SceneCullingStats
+ev_scene_getcullingstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneCullingStats){0});
+  return scene->culling.stats;
+}
+
+void
+ev_scene_setfrustumculling(
+    GameScene scene_handle,
+    bool enabled)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  scene->culling.enabled = enabled;
+}
+
+// Counts come from the per-object flags, which are kept up to date wherever
+// this module adds or removes a component, so this is proportional to the
+// number of archetypes and streaming cells, not objects. Rigidbody and
+// script counts are not read from the physics world or script context:
+// they only include what the scene loader attached. Components attached
+// straight through the ECS by other modules aren't counted either. The
+// physics and script modules don't expose their own memory usage.
+SceneStats
+ev_scene_getstats(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneStats){0});
+  SceneStats stats = {0};
+
+  stats.objectCount = (U32)vec_len((vec_t*)&scene->objects);
+  stats.namedObjects = scene->path_stats.indexedPaths;
+  stats.staticRenderObjects = (U32)vec_len((vec_t*)&scene->statics.objects);
+  for(U32 flags = 0; flags < SCENEOBJECT_ARCHETYPES; flags++) {
+    U32 count = scene->archetype_counts[flags];
+    stats.archetypeObjects[flags] = count;
+    if(count == 0) {
+      continue;
+    }
+    stats.archetypeCount++;
+    if(flags & SCENEOBJECT_FLAG_CAMERA) {
+      stats.cameraCount += count;
+    }
+    if(flags & SCENEOBJECT_FLAG_RENDER) {
+      stats.renderCount += count;
+    }
+    if(flags & SCENEOBJECT_FLAG_LIGHT) {
+      stats.lightCount += count;
+    }
+    if(flags & SCENEOBJECT_FLAG_RIGIDBODY) {
+      stats.rigidbodyCount += count;
+    }
+    if(flags & SCENEOBJECT_FLAG_SCRIPT) {
+      stats.scriptCount += count;
+    }
+  }
+
+  stats.componentBytes = (U64)stats.objectCount * (sizeof(TransformComponent) + sizeof(WorldTransformComponent))
+                       + (U64)stats.cameraCount * sizeof(CameraComponent)
+                       + (U64)stats.renderCount * sizeof(RenderComponent)
+                       + (U64)stats.lightCount * sizeof(LightComponent);
+
+  stats.tableBytes = (U64)stats.objectCount * (sizeof(GameObject) + sizeof(char *) + sizeof(U8) + sizeof(U32))
+                   + (U64)(scene->object_slots.capacity + scene->path_slots.capacity) * (sizeof(U64) + sizeof(U32))
+                   + vec_len((vec_t*)&scene->bvh.nodes) * sizeof(SceneBVHNode)
+                   + stats.staticRenderObjects * (sizeof(GameObject) + sizeof(RenderComponent) + sizeof(WorldTransformComponent) + sizeof(Vec4));
+  if(scene->streaming) {
+    size_t cell_count = vec_len((vec_t*)&scene->streaming->cells);
+    stats.tableBytes += cell_count * sizeof(SceneStreamingCell)
+                      + (U64)scene->streaming->cellSlots.capacity * (sizeof(U64) + sizeof(U32));
+    for(size_t i = 0; i < cell_count; i++) {
+      SceneStreamingCell *cell = &scene->streaming->cells[i];
+      stats.tableBytes += vec_len((vec_t*)&cell->nodes) * sizeof(U32)
+                        + vec_len((vec_t*)&cell->objects) * sizeof(GameObject);
+    }
+  }
+
+  stats.arenaBytes = scene->arena.stats.reservedBytes;
+  stats.sourceBytes = scene->sourceDesc ? evjs_get(scene->sourceDesc, "nodes")->as_str.len : 0;
+  stats.totalBytes = stats.componentBytes + stats.tableBytes + stats.arenaBytes + stats.sourceBytes;
+
+  return stats;
+}
+
+void
+_ev_object_setposition(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec3 new_pos)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(tr == NULL) {
+    return;
+  }
+  TransformComponent newTransform = {
+      .position = new_pos,
+      .rotation = tr->rotation,
+      .scale = tr->scale
+  };
+  GameECS->setComponent(scene->ecs_world, entt, TransformComponentID, &newTransform);
+  transform_setdirty(scene->ecs_world, entt);
+  sceneobjects_syncrigidbody(scene_handle, entt, &newTransform, true, false);
+}
+
+void
+ev_object_settransform(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec3 new_pos,
+    Vec4 new_rot,
+    Vec3 new_scale)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  TransformComponent transform = {
+      .position = new_pos,
+      .rotation = new_rot,
+      .scale = new_scale
+  };
+  GameECS->setComponent(scene->ecs_world, entt, TransformComponentID, &transform);
+  WorldTransformComponent wt;
+  GameECS->setComponent(scene->ecs_world, entt, WorldTransformComponentID, &wt);
+  transform_setdirty(scene->ecs_world, entt);
+  worldtransform_update(scene_handle, entt);
+}
+
+Vec3
+_ev_object_getrotationeuler(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  const Matrix4x4 *rotationMatrix = _ev_object_getworldtransform(scene_handle, entt);
+  Vec3 res = {0};
+  if(rotationMatrix == NULL) {
+    return res;
+  }
+  glm_euler_angles((vec4*)*rotationMatrix, (float*)&res);
+  return res;
+}
+
+void
+_ev_object_setrotationeuler(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec3 new_angles)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(tr == NULL) {
+    return;
+  }
+
+
+  Vec4 rot_quat;
+  Matrix4x4 rotationMatrix;
+  glm_euler((float*)&new_angles, rotationMatrix);
+  glm_mat4_quat(rotationMatrix, (float*)&rot_quat);
+
+  TransformComponent newTransform = {
+      .position = tr->position,
+      .rotation = rot_quat,
+      .scale = tr->scale
+  };
+  GameECS->setComponent(scene->ecs_world, entt, TransformComponentID, &newTransform);
+
+  transform_setdirty(scene->ecs_world, entt);
+  sceneobjects_syncrigidbody(scene_handle, entt, &newTransform, false, true);
+}
+
+void
+_ev_object_setscale(
+    GameScene scene_handle,
+    GameObject entt,
+    Vec3 new_scale)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(tr == NULL) {
+    return;
+  }
+  GameECS->setComponent(scene->ecs_world, entt, TransformComponentID, &(TransformComponent) {
+      .position = tr->position,
+      .rotation = tr->rotation,
+      .scale = new_scale
+  });
+  transform_setdirty(scene->ecs_world, entt);
+}
+
+Vec4
+_ev_object_getrotation(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (Vec4){0});
+  const TransformComponent *comp = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(comp == NULL) {
+    return (Vec4){0};
+  }
+  return comp->rotation;
+}
+
+CONST_STR
+ev_object_getname(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, NULL);
+  return GameECS->getEntityName(scene->ecs_world,entt);
+}
+
+Vec3
+_ev_object_getposition(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (Vec3){0});
+  const TransformComponent *comp = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(comp == NULL) {
+    return (Vec3){0};
+  }
+  return comp->position;
+}
+
+Vec3
+_ev_object_getscale(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (Vec3){0});
+  const TransformComponent *comp = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  if(comp == NULL) {
+    return (Vec3){0};
+  }
+  return comp->scale;
+}
+
+void
+transform_computeworld(
+    const Matrix4x4 *parent_worldtransform,
+    const TransformComponent *transform,
+    Matrix4x4 out)
+{
+  if(parent_worldtransform) {
+    glm_mat4_dup((vec4*)*parent_worldtransform, out);
+  } else {
+    glm_mat4_identity(out);
+  }
+
+  glm_translate(out, (float*)&transform->position);
+  glm_quat_rotate(out, (float*)&transform->rotation, out);
+  glm_scale(out, (float*)&transform->scale);
+}
+
+// Keeps the object's BVH leaf in sync with its bounds and world transform.
+// Objects without a BoundsComponent are not in the tree.
+void
+scenebounds_update(
+    GameSceneStruct *scene,
+    GameObject obj)
+{
+  U32 slot;
+  if(!indexmap_get(&scene->object_slots, obj, &slot) || !GameECS->hasComponent(scene->ecs_world, obj, BoundsComponentID)) {
+    return;
+  }
+  // Inactive objects are kept out of the BVH
+  if(GameECS->hasTag(scene->ecs_world, obj, InactiveTagID)) {
+    return;
+  }
+
+  const BoundsComponent *bounds = GameECS->getComponent(scene->ecs_world, obj, BoundsComponentID);
+  const WorldTransformComponent *worldTransform = GameECS->getComponent(scene->ecs_world, obj, WorldTransformComponentID);
+  vec3 box[2] = {
+    { bounds->center.x - bounds->extents.x, bounds->center.y - bounds->extents.y, bounds->center.z - bounds->extents.z },
+    { bounds->center.x + bounds->extents.x, bounds->center.y + bounds->extents.y, bounds->center.z + bounds->extents.z },
+  };
+  vec3 world_box[2];
+  glm_aabb_transform(box, (vec4*)*worldTransform, world_box);
+
+  if(scene->object_proxies[slot] == SCENEBVH_NULL) {
+    scene->object_proxies[slot] = scenebvh_createproxy(&scene->bvh, obj, world_box[0], world_box[1]);
+  } else {
+    scenebvh_moveproxy(&scene->bvh, scene->object_proxies[slot], world_box[0], world_box[1]);
+  }
+}
+
+void
+worldtransform_update(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  if(!GameECS->hasTag(scene->ecs_world, entt, DirtyTransformTagID)) {
+    return;
+  }
+
+  WorldTransformComponent worldTransform = {0};
+
+  const Matrix4x4 *parent_worldtransform = NULL;
+  GameObject parent = GameECS->getParent(scene->ecs_world, entt);
+  if(parent != 0) {
+    parent_worldtransform = _ev_object_getworldtransform(scene_handle, parent);
+  }
+
+  const TransformComponent *transform = GameECS->getComponent(scene->ecs_world, entt, TransformComponentID);
+  transform_computeworld(parent_worldtransform, transform, worldTransform);
+
+  GameECS->setComponent(scene->ecs_world, entt, WorldTransformComponentID, &worldTransform);
+  scenebounds_update(scene, entt);
+
+  GameECS->removeTag(scene->ecs_world, entt, DirtyTransformTagID);
+}
+
+const Matrix4x4 *
+_ev_object_getworldtransform(
+    GameScene scene_handle,
+    GameObject entt)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, NULL);
+  worldtransform_update(scene_handle, entt);
+  return GameECS->getComponent(scene->ecs_world, entt, WorldTransformComponentID);
+}
+
+ECSGameWorldHandle
+ev_scene_getecsworld(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  return scene->ecs_world;
+}
+
+PhysicsWorldHandle
+ev_scene_getphysicsworld(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  return scene->physics_world;
+}
+
+ScriptContextHandle
+ev_scene_getscriptcontext(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  return scene->script_context;
+}
+
+void
+_ev_camera_sethfov(
+  GameScene scene_handle,
+  GameObject camera,
+  U32 hfov)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  CameraComponent *comp = GameECS->getComponentMut(scene->ecs_world, camera, CameraComponentID);
+  if(comp->hfov != hfov) {
+    comp->hfov = hfov;
+    GameECS->modified(scene->ecs_world, camera, CameraComponentID);
+  }
+}
+
+void
+_ev_camera_setvfov(
+  GameScene scene_handle,
+  GameObject camera,
+  U32 vfov)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  CameraComponent *comp = GameECS->getComponentMut(scene->ecs_world, camera, CameraComponentID);
+  if(comp->vfov != vfov) {
+    comp->vfov = vfov;
+    GameECS->modified(scene->ecs_world, camera, CameraComponentID);
+  }
+}
+
+void
+_ev_camera_setaspectratio(
+  GameScene scene_handle,
+  GameObject camera,
+  F32 aspectRatio)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  CameraComponent *comp = GameECS->getComponentMut(scene->ecs_world, camera, CameraComponentID);
+  if(comp->aspectRatio != aspectRatio) {
+    comp->aspectRatio = aspectRatio;
+    GameECS->modified(scene->ecs_world, camera, CameraComponentID);
+  }
+}
+
+void
+_ev_camera_setnearplane(
+  GameScene scene_handle,
+  GameObject camera,
+  F32 nearPlane)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  CameraComponent *comp = GameECS->getComponentMut(scene->ecs_world, camera, CameraComponentID);
+  if(comp->nearPlane != nearPlane) {
+    comp->nearPlane = nearPlane;
+    GameECS->modified(scene->ecs_world, camera, CameraComponentID);
+  }
+}
+
+void
+_ev_camera_setfarplane(
+  GameScene scene_handle,
+  GameObject camera,
+  F32 farPlane)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  CameraComponent *comp = GameECS->getComponentMut(scene->ecs_world, camera, CameraComponentID);
+  if(comp->farPlane != farPlane) {
+    comp->farPlane = farPlane;
+    GameECS->modified(scene->ecs_world, camera, CameraComponentID);
+  }
+}
+
+void
+_ev_camera_getviewmat(
+  GameScene scene_handle,
+  GameObject camera,
+  Matrix4x4 outViewMat)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  const Matrix4x4 *transform = _ev_object_getworldtransform(scene_handle, camera);
+  if(transform == NULL) {
+    return;
+  }
+  glm_mat4_inv((vec4*)*transform, outViewMat);
+}
+
+void
+_ev_camera_getprojectionmat(
+  GameScene scene_handle,
+  GameObject camera,
+  Matrix4x4 outProjMat)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  camera = camera?camera:scene->activeCamera;
+  const CameraComponent *comp = GameECS->getComponent(scene->ecs_world, camera, CameraComponentID);
+  glm_mat4_dup((vec4*)comp->projectionMatrix, outProjMat);
+}
+
+void
+_ev_object_setworldtransform(
+    GameScene scene_handle,
+    GameObject entt,
+    Matrix4x4 new_transform)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  WorldTransformComponent *world_transform = GameECS->getComponentMut(scene->ecs_world, entt, WorldTransformComponentID);
+  if(world_transform == NULL) {
+    return;
+  }
+  glm_mat4_copy(new_transform, *world_transform);
+  GameECS->modified(scene->ecs_world, entt, WorldTransformComponentID);
+
+  // The local transform is brought in line (parent inverse x world) so that
+  // the pose isn't undone the next time the object is recomputed from it,
+  // e.g. when its parent moves. Scale stays the local one.
+  Matrix4x4 local;
+  GameObject parent = GameECS->getParent(scene->ecs_world, entt);
+  const Matrix4x4 *parent_worldtransform = parent ? _ev_object_getworldtransform(scene_handle, parent) : NULL;
+  if(parent_worldtransform) {
+    Matrix4x4 parent_inverse;
+    glm_mat4_inv((vec4*)*parent_worldtransform, parent_inverse);
+    glm_mat4_mul(parent_inverse, new_transform, local);
+  } else {
+    glm_mat4_copy(new_transform, local);
+  }
+  Matrix4x4 rotationMatrix;
+  glm_mat4_identity(rotationMatrix);
+  for(U32 c = 0; c < 3; c++) {
+    F32 len = sqrtf(local[c][0] * local[c][0] + local[c][1] * local[c][1] + local[c][2] * local[c][2]);
+    F32 invLen = len > 0.f ? 1.f / len : 0.f;
+    rotationMatrix[c][0] = local[c][0] * invLen;
+    rotationMatrix[c][1] = local[c][1] * invLen;
+    rotationMatrix[c][2] = local[c][2] * invLen;
+  }
+  TransformComponent *transform = GameECS->getComponentMut(scene->ecs_world, entt, TransformComponentID);
+  transform->position = Vec3new(local[3][0], local[3][1], local[3][2]);
+  glm_mat4_quat(rotationMatrix, (float*)&transform->rotation);
+  GameECS->modified(scene->ecs_world, entt, TransformComponentID);
+  scenebounds_update(scene, entt);
+
+  GameECS->forEachChild(scene->ecs_world, entt, transform_setdirty);
+}
+
+const PTR
+ev_object_getcomponent(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id)
+{
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
+  return GameECS->getComponent(ecs_world, entt, comp_id);
+}
+
+PTR
+ev_object_getcomponentmut(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id)
+{
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
+  return GameECS->getComponentMut(ecs_world, entt, comp_id);
+}
+
+bool
+ev_object_hascomponent(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id)
+{
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
+  return GameECS->hasComponent(ecs_world, entt, comp_id);
+}
+
+void
+ev_object_addcomponent(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  GameECS->addComponent(scene->ecs_world, entt, comp_id);
+  sceneobjects_addflags(scene, entt, sceneobjects_componentflag(comp_id));
+}
+
+void
+ev_object_addtag(
+    GameScene scene_handle,
+    GameObject entt,
+    GameTagID tag_id)
+{
+  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
+  GameECS->addTag(ecs_world, entt, tag_id);
+}
+
+void
+ev_object_setcomponent(
+    GameScene scene_handle,
+    GameObject entt,
+    GameComponentID comp_id,
+    PTR data)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  GameECS->setComponent(scene->ecs_world, entt, comp_id, data);
+  sceneobjects_addflags(scene, entt, sceneobjects_componentflag(comp_id));
+  if(comp_id == BoundsComponentID) {
+    scenebounds_update(scene, entt);
+  }
+  if(GameECS->hasTag(scene->ecs_world, entt, StaticTransformTagID)) {
+    scenestatic_capture(scene, entt);
+  }
+}
+
+void
+CameraComponentOnAddTrigger(ECSQuery query)
+{
+  CameraComponent *cameraComp = ECS->getQueryColumn(query, sizeof(CameraComponent), 1);
+  glm_mat4_identity(cameraComp->projectionMatrix);
+}
+
+void
+CameraComponentOnSetTrigger(ECSQuery query)
+{
+  CameraComponent *cameraComp = ECS->getQueryColumn(query, sizeof(CameraComponent), 1);
+  U32 count = ECS->getQueryMatchCount(query);
+
+  for(U32 i = 0; i < count; i++) {
+    if(cameraComp[i].viewType == EV_CAMERA_VIEWTYPE_PERSPECTIVE) {
+      glm_perspective(glm_rad(cameraComp[i].hfov), cameraComp[i].aspectRatio, cameraComp[i].nearPlane, cameraComp[i].farPlane, cameraComp[i].projectionMatrix);
+
+      //Complience with vulkan coordinate system
+      cameraComp[i].projectionMatrix[1][1] *= -1;
+      
+    } else if (cameraComp[i].viewType == EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC){
+      assert(!"Unimplemented: Orthographic Camera");
+    } else {
+      ev_log_error("Invalid camera view type. Choose one from: (EV_CAMERA_VIEWTYPE_PERSPECTIVE, EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC)");
+      assert(false);
+    }
+  }
+}
+
+GameObject
+ev_scene_createobjectwithtransform(
+    GameScene scene_handle,
+    GameObject parent,
+    const TransformComponent *transform)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+
+  // World transform is computed up front (before the parent's table can move)
+  // so that no dirty tagging or lazy update is needed for fresh objects.
+  WorldTransformComponent worldTransform;
+  const Matrix4x4 *parent_worldtransform = NULL;
+  if(parent != 0) {
+    parent_worldtransform = _ev_object_getworldtransform(scene_handle, parent);
+  }
+  transform_computeworld(parent_worldtransform, transform, worldTransform);
+
+  GameObject object;
+  if(parent == 0) {
+    object = GameECS->createEntity(scene->ecs_world);
+  } else {
+    object = GameECS->createChildEntity(scene->ecs_world, parent);
+  }
+
+  // The ECS takes a mutable pointer, even though it only copies from it
+  TransformComponent initialTransform = *transform;
+  GameECS->setComponent(scene->ecs_world, object, TransformComponentID, &initialTransform);
+  GameECS->setComponent(scene->ecs_world, object, WorldTransformComponentID, &worldTransform);
+
+  sceneobjects_register(scene, object);
+  // Objects created under an inactive parent start out inactive
+  if(parent != 0 && GameECS->hasTag(scene->ecs_world, parent, InactiveTagID)) {
+    GameECS->addTag(scene->ecs_world, object, InactiveTagID);
+  }
+
+  return object;
+}
+
+GameObject
+ev_scene_createobject(
+    GameScene scene_handle)
+{
+  return ev_scene_createobjectwithtransform(scene_handle, 0, &DefaultTransform);
+}
+
+GameObject
+ev_scene_createchildobject(
+    GameScene scene_handle,
+    GameObject parent)
+{
+  return ev_scene_createobjectwithtransform(scene_handle, parent, &DefaultTransform);
+}
+
+void
+ev_scene_createobjects(
+    GameScene scene_handle,
+    GameObject parent,
+    U32 count,
+    GameObject *out_objects)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
 
-    if(!evstring_cmp(component_type, TransformComponentSTR)) {
-      ev_sceneloader_loadtransformcomponent(scene, obj, json, &component_id);
-    } else if(!evstring_cmp(component_type, ScriptComponentSTR)) {
-      ev_sceneloader_loadscriptcomponent(scene, obj, json, &component_id);
-    } else if(!evstring_cmp(component_type, RigidbodyComponentSTR)) {
-      ev_sceneloader_loadrigidbodycomponent(scene, obj, json, &component_id);
-    } else if(!evstring_cmp(component_type, CameraComponentSTR)) {
-      ev_sceneloader_loadcameracomponent(scene, obj, json, &component_id);
-    } else if(!evstring_cmp(component_type, RenderComponentSTR)) {
-      ev_sceneloader_loadrendercomponent(scene, obj, json, &component_id);
-    } else if(!evstring_cmp(component_type, LightComponentSTR)) {
-     ev_sceneloader_loadlightcomponent(scene, obj, json, &component_id);
+  // All objects of a batch share the same initial world transform
+  WorldTransformComponent worldTransform;
+  const Matrix4x4 *parent_worldtransform = NULL;
+  if(parent != 0) {
+    parent_worldtransform = _ev_object_getworldtransform(scene_handle, parent);
+  }
+  transform_computeworld(parent_worldtransform, &DefaultTransform, worldTransform);
+  TransformComponent initialTransform = DefaultTransform;
+  bool inactive = parent != 0 && GameECS->hasTag(scene->ecs_world, parent, InactiveTagID);
+
+  for(U32 i = 0; i < count; i++) {
+    GameObject object;
+    if(parent == 0) {
+      object = GameECS->createEntity(scene->ecs_world);
+    } else {
+      object = GameECS->createChildEntity(scene->ecs_world, parent);
+    }
+    GameECS->setComponent(scene->ecs_world, object, TransformComponentID, &initialTransform);
+    GameECS->setComponent(scene->ecs_world, object, WorldTransformComponentID, &worldTransform);
+    sceneobjects_register(scene, object);
+    if(inactive) {
+      GameECS->addTag(scene->ecs_world, object, InactiveTagID);
+    }
+
+    if(out_objects) {
+      out_objects[i] = object;
+    }
+  }
+}
+
+void
+ev_scene_addchildtoobject(
+    GameScene scene_handle,
+    GameObject parent,
+    GameObject child)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  GameECS->addChildToEntity(scene->ecs_world, parent, child);
+  scene_walk(scene, child, scenepaths_refresh);
+  sceneactive_refresh(scene, child);
+}
+
+// Destroys right away. Used where the object has to be gone before carrying
+// on (hot reload, snapshot restore).
+void
+sceneobjects_destroyimmediate(
+    GameScene scene_handle,
+    GameObject object)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  scene_walk(scene, object, sceneobjects_unregistersubtree);
+  GameECS->destroyEntity(scene->ecs_world, object);
+}
+
+// Queues the object and its subtree for destruction at the end of the frame
+void
+ev_scene_destroyobject(
+    GameScene scene_handle,
+    GameObject object)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneDestroyQueue *queue = &scene->destroy_queue;
+  if(indexmap_get(&queue->queuedSet, object, NULL)) {
+    return;
+  }
+  indexmap_set(&queue->queuedSet, object, (U32)vec_push((vec_t*)&queue->queued, &object));
+}
+
+// forEachChild has no user data; children are collected here while walking
+static vec(SceneDestroyEntry) *DestroyWalkStack;
+static U32 DestroyWalkDepth;
+
+void
+scenedestroy_pushchild(
+    ECSGameWorldHandle world,
+    GameEntityID entt)
+{
+  SceneDestroyEntry entry = { .object = entt, .key = DestroyWalkDepth };
+  vec_push((vec_t*)DestroyWalkStack, &entry);
+}
+
+int
+scenedestroy_compareentries(
+    const void *a,
+    const void *b)
+{
+  const SceneDestroyEntry *lhs = a;
+  const SceneDestroyEntry *rhs = b;
+  if(lhs->key != rhs->key) {
+    return lhs->key < rhs->key ? -1 : 1;
+  }
+  return lhs->order < rhs->order ? -1 : (lhs->order > rhs->order);
+}
+
+// Destroys everything queued so far. Subtrees are walked with an explicit
+// stack, then objects are destroyed deepest first so the ECS never has to
+// recurse, and within a depth grouped by their components so that objects of
+// the same kind are destroyed together. Physics bodies and scripts are still
+// released one entity at a time, by the physics and script modules' own ECS
+// hooks; neither module has a batched release.
+U32
+ev_scene_flushdestroyed(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  SceneDestroyQueue *queue = &scene->destroy_queue;
+  U32 queued_count = (U32)vec_len((vec_t*)&queue->queued);
+  if(queued_count == 0) {
+    return 0;
+  }
+
+  vec_clear(queue->entries);
+  indexmap_clear(&queue->visited);
+  DestroyWalkStack = &queue->stack;
+  for(U32 i = 0; i < queued_count; i++) {
+    vec_clear(queue->stack);
+    scenedestroy_pushchild(scene->ecs_world, queue->queued[i]);
+    while(vec_len((vec_t*)&queue->stack) > 0) {
+      size_t top = vec_len((vec_t*)&queue->stack) - 1;
+      SceneDestroyEntry entry = queue->stack[top];
+      vec_setlen((vec_t*)&queue->stack, top);
+      if(indexmap_get(&queue->visited, entry.object, NULL)) {
+        continue;
+      }
+      indexmap_set(&queue->visited, entry.object, 0);
+
+      U32 slot;
+      U32 flags = indexmap_get(&scene->object_slots, entry.object, &slot) ? scene->object_flags[slot] : 0;
+      U32 depth = entry.key;
+      entry.order = (U32)vec_len((vec_t*)&queue->entries);
+      entry.key = ((0xFFFFu - (depth < 0xFFFFu ? depth : 0xFFFFu)) << 8) | flags;
+      vec_push((vec_t*)&queue->entries, &entry);
+
+      DestroyWalkDepth = depth + 1;
+      GameECS->forEachChild(scene->ecs_world, entry.object, scenedestroy_pushchild);
+    }
+  }
+  DestroyWalkStack = NULL;
+
+  // An object queued along with one of its ancestors was reached from both;
+  // it only appears once since the walk skips visited objects.
+  U32 entry_count = (U32)vec_len((vec_t*)&queue->entries);
+  qsort(queue->entries, entry_count, sizeof(SceneDestroyEntry), scenedestroy_compareentries);
+
+  for(U32 i = 0; i < entry_count; i++) {
+    sceneobjects_unregister(scene, queue->entries[i].object);
+  }
+  for(U32 i = 0; i < entry_count; i++) {
+    GameECS->destroyEntity(scene->ecs_world, queue->entries[i].object);
+  }
+
+  vec_clear(queue->queued);
+  indexmap_clear(&queue->queuedSet);
+  return entry_count;
+}
+
+void
+commands_threadexit(
+    void *data)
+{
+  GameCommandBuffer *buffer = data;
+  atomic_store(&buffer->exited, true);
+}
+
+GameCommandBuffer *
+commands_getthreadbuffer()
+{
+  if(ThreadCommandBuffer) {
+    return ThreadCommandBuffer;
+  }
+
+  GameCommandBuffer *buffer = malloc(sizeof(GameCommandBuffer));
+  for(U32 i = 0; i < 2; i++) {
+    buffer->pages[i].commands = vec_init(GameCommand, NULL, NULL);
+    buffer->pages[i].data = vec_init(U8, NULL, NULL);
+  }
+  atomic_init(&buffer->page, 0);
+  atomic_init(&buffer->recording, false);
+  atomic_init(&buffer->order, pthread_equal(pthread_self(), CommandsData.mainThread) ? 0 : EV_GAME_COMMAND_UNORDERED);
+  atomic_init(&buffer->exited, false);
+  buffer->nextPlaceholder = 0;
+
+  pthread_mutex_lock(&CommandsData.lock);
+  buffer->id = CommandsData.nextBufferId++;
+  vec_push((vec_t*)&CommandsData.buffers, &buffer);
+  pthread_mutex_unlock(&CommandsData.lock);
+  pthread_setspecific(CommandsData.threadKey, buffer);
+
+  ThreadCommandBuffer = buffer;
+  return buffer;
+}
+
+// The page is picked only after `recording` is raised. The sync point flips
+// `page` before checking `recording`, so it either waits for this record or
+// the record lands in the page it left to the owner (both sequentially
+// consistent).
+void
+commands_record(
+    GameCommand *command,
+    const void *data)
+{
+  GameCommandBuffer *buffer = commands_getthreadbuffer();
+  atomic_store(&buffer->recording, true);
+  GameCommandPage *page = &buffer->pages[atomic_load(&buffer->page)];
+  if(data) {
+    command->dataOffset = (U32)vec_len((vec_t*)&page->data);
+    vec_setlen((vec_t*)&page->data, command->dataOffset + command->dataSize);
+    memcpy(page->data + command->dataOffset, data, command->dataSize);
+  }
+  vec_push((vec_t*)&page->commands, command);
+  atomic_store(&buffer->recording, false);
+}
+
+// Takes over the page the owner has been recording to. A record in flight is
+// only a few stores away from done, so it is spun on.
+GameCommandPage *
+commands_drain(
+    GameCommandBuffer *buffer)
+{
+  U32 page = atomic_fetch_xor(&buffer->page, 1);
+  while(atomic_load(&buffer->recording)) {
+  }
+  return &buffer->pages[page];
+}
+
+// Buffers are applied by ascending order, each in recording order. The thread
+// that loaded the module defaults to 0; other threads come after every thread
+// with an order set, in an unspecified order among themselves. Worker threads
+// that call this with a fixed index get the same ordering on every run.
+void
+ev_commands_setthreadorder(
+    U32 order)
+{
+  atomic_store(&commands_getthreadbuffer()->order, order);
+}
+
+// Returns a placeholder for the new object. It can be used in any later
+// command, and turned into the real object with Commands.resolve once the
+// commands have been applied.
+GameObject
+ev_commands_createobject(
+    GameScene scene_handle,
+    GameObject parent)
+{
+  GameCommandBuffer *buffer = commands_getthreadbuffer();
+  GameObject placeholder = EV_GAME_COMMAND_PLACEHOLDER_BIT | ((U64)buffer->id << 32) | buffer->nextPlaceholder++;
+  commands_record(&(GameCommand) {
+      .type = GAMECOMMAND_CREATE,
+      .scene = scene_handle,
+      .object = placeholder,
+      .parent = parent,
+      .transform = DefaultTransform,
+  }, NULL);
+  return placeholder;
+}
+
+void
+ev_commands_destroyobject(
+    GameScene scene_handle,
+    GameObject obj)
+{
+  commands_record(&(GameCommand) {
+      .type = GAMECOMMAND_DESTROY,
+      .scene = scene_handle,
+      .object = obj,
+  }, NULL);
+}
+
+void
+ev_commands_settransform(
+    GameScene scene_handle,
+    GameObject obj,
+    Vec3 position,
+    Vec4 rotation,
+    Vec3 scale)
+{
+  commands_record(&(GameCommand) {
+      .type = GAMECOMMAND_SETTRANSFORM,
+      .scene = scene_handle,
+      .object = obj,
+      .transform = {
+        .position = position,
+        .rotation = rotation,
+        .scale = scale,
+      },
+  }, NULL);
+}
+
+// `data` is copied; `size` is the size of the component
+void
+ev_commands_setcomponent(
+    GameScene scene_handle,
+    GameObject obj,
+    GameComponentID comp_id,
+    const PTR data,
+    U32 size)
+{
+  commands_record(&(GameCommand) {
+      .type = GAMECOMMAND_SETCOMPONENT,
+      .scene = scene_handle,
+      .object = obj,
+      .component = comp_id,
+      .dataSize = size,
+  }, data);
+}
+
+void
+ev_commands_setparent(
+    GameScene scene_handle,
+    GameObject parent,
+    GameObject child)
+{
+  commands_record(&(GameCommand) {
+      .type = GAMECOMMAND_SETPARENT,
+      .scene = scene_handle,
+      .object = child,
+      .parent = parent,
+  }, NULL);
+}
+
+GameObject
+commands_resolve(
+    GameObject obj)
+{
+  if(!(obj & EV_GAME_COMMAND_PLACEHOLDER_BIT)) {
+    return obj;
+  }
+  U32 slot;
+  return indexmap_get(&CommandsData.placeholders, obj, &slot) ? CommandsData.createdObjects[slot] : 0;
+}
+
+// Placeholders stay resolvable until the next sync point
+GameObject
+ev_commands_resolve(
+    GameObject placeholder)
+{
+  return commands_resolve(placeholder);
+}
+
+int
+commands_comparebuffers(
+    const void *a,
+    const void *b)
+{
+  const GameCommandBufferKey *lhs = a;
+  const GameCommandBufferKey *rhs = b;
+  if(lhs->order != rhs->order) {
+    return lhs->order < rhs->order ? -1 : 1;
+  }
+  return lhs->id < rhs->id ? -1 : (lhs->id > rhs->id);
+}
+
+// Consecutive creations under the same parent go through
+// ev_scene_createobjects in one call
+void
+commands_applycreates(
+    GameScene scene_handle,
+    const GameCommand *commands,
+    U32 count)
+{
+  U32 begin = 0;
+  while(begin < count) {
+    U32 end = begin + 1;
+    while(end < count && commands[end].parent == commands[begin].parent) {
+      end++;
+    }
+    U32 slot = (U32)vec_len((vec_t*)&CommandsData.createdObjects);
+    vec_setlen((vec_t*)&CommandsData.createdObjects, slot + end - begin);
+    ev_scene_createobjects(scene_handle, commands_resolve(commands[begin].parent), end - begin, CommandsData.createdObjects + slot);
+    for(U32 i = begin; i < end; i++) {
+      indexmap_set(&CommandsData.placeholders, commands[i].object, slot + i - begin);
+    }
+    begin = end;
+  }
+}
+
+// Local transforms are written in place and only flagged dirty; the world
+// transforms are brought up to date once, by the transform system (or
+// lazily by whatever reads them first).
+void
+commands_applytransforms(
+    GameSceneStruct *scene,
+    const GameCommand *commands,
+    U32 count)
+{
+  for(U32 i = 0; i < count; i++) {
+    GameObject obj = commands_resolve(commands[i].object);
+    if(obj == 0 || !indexmap_get(&scene->object_slots, obj, NULL)) {
+      continue;
+    }
+    TransformComponent *transform = GameECS->getComponentMut(scene->ecs_world, obj, TransformComponentID);
+    *transform = commands[i].transform;
+    GameECS->modified(scene->ecs_world, obj, TransformComponentID);
+    transform_setdirty(scene->ecs_world, obj);
+  }
+}
+
+// Sync point: applies everything recorded so far, on the main thread. Every
+// buffer's page is taken over (see commands_drain) and merged into one list
+// in apply order, which is then applied in runs of commands of the same kind
+// and scene. Buffers of threads that have exited are freed once drained.
+U32
+ev_commands_apply()
+{
+  vec_clear(CommandsData.createdObjects);
+  indexmap_clear(&CommandsData.placeholders);
+
+  vec_clear(CommandsData.sortedBuffers);
+  pthread_mutex_lock(&CommandsData.lock);
+  for(size_t b = 0; b < vec_len((vec_t*)&CommandsData.buffers);) {
+    GameCommandBuffer *buffer = CommandsData.buffers[b];
+    GameCommandBufferKey key = {
+      .order = atomic_load(&buffer->order),
+      .id = buffer->id,
+      .exited = atomic_load(&buffer->exited),
+      .buffer = buffer,
+    };
+    vec_push((vec_t*)&CommandsData.sortedBuffers, &key);
+    if(key.exited) {
+      // Nothing records to it anymore; it goes once this drain is done
+      size_t last = vec_len((vec_t*)&CommandsData.buffers) - 1;
+      CommandsData.buffers[b] = CommandsData.buffers[last];
+      vec_setlen((vec_t*)&CommandsData.buffers, last);
+    } else {
+      b++;
+    }
+  }
+  pthread_mutex_unlock(&CommandsData.lock);
+  size_t buffer_count = vec_len((vec_t*)&CommandsData.sortedBuffers);
+  qsort(CommandsData.sortedBuffers, buffer_count, sizeof(GameCommandBufferKey), commands_comparebuffers);
+
+  vec_clear(CommandsData.applyCommands);
+  vec_clear(CommandsData.applyData);
+  for(size_t b = 0; b < buffer_count; b++) {
+    GameCommandBufferKey *key = &CommandsData.sortedBuffers[b];
+    GameCommandPage *page = commands_drain(key->buffer);
+    U32 command_count = (U32)vec_len((vec_t*)&page->commands);
+    U32 data_size = (U32)vec_len((vec_t*)&page->data);
+    U32 command_base = (U32)vec_len((vec_t*)&CommandsData.applyCommands);
+    U32 data_base = (U32)vec_len((vec_t*)&CommandsData.applyData);
+    vec_setlen((vec_t*)&CommandsData.applyCommands, command_base + command_count);
+    vec_setlen((vec_t*)&CommandsData.applyData, data_base + data_size);
+    memcpy(CommandsData.applyCommands + command_base, page->commands, command_count * sizeof(GameCommand));
+    memcpy(CommandsData.applyData + data_base, page->data, data_size);
+    for(U32 i = 0; i < command_count; i++) {
+      CommandsData.applyCommands[command_base + i].dataOffset += data_base;
+    }
+    vec_clear(page->commands);
+    vec_clear(page->data);
+
+    if(key->exited) {
+      for(U32 i = 0; i < 2; i++) {
+        vec_fini(key->buffer->pages[i].commands);
+        vec_fini(key->buffer->pages[i].data);
+      }
+      free(key->buffer);
+    }
+  }
+
+  GameCommand *commands = CommandsData.applyCommands;
+  U8 *data = CommandsData.applyData;
+  U32 command_count = (U32)vec_len((vec_t*)&CommandsData.applyCommands);
+  U32 begin = 0;
+  while(begin < command_count) {
+    U32 end = begin + 1;
+    while(end < command_count && commands[end].type == commands[begin].type && commands[end].scene == commands[begin].scene) {
+      end++;
+    }
+    GameScene scene_handle = commands[begin].scene ? commands[begin].scene : GameData.activeScene;
+    GameSceneStruct *scene = ev_scene_isvalid(scene_handle) ? ev_game_getscene(scene_handle) : NULL;
+    if(scene == NULL) {
+      begin = end;
+      continue;
+    }
+
+    switch(commands[begin].type) {
+      case GAMECOMMAND_CREATE:
+        commands_applycreates(scene_handle, commands + begin, end - begin);
+        break;
+      case GAMECOMMAND_SETTRANSFORM:
+        commands_applytransforms(scene, commands + begin, end - begin);
+        break;
+      default:
+        for(U32 i = begin; i < end; i++) {
+          GameCommand *command = &commands[i];
+          GameObject obj = commands_resolve(command->object);
+          if(obj == 0) {
+            continue;
+          }
+          if(command->type == GAMECOMMAND_DESTROY) {
+            // Queued; the destroy queue tears the whole run down in one flush
+            ev_scene_destroyobject(scene_handle, obj);
+          } else if(command->type == GAMECOMMAND_SETCOMPONENT) {
+            ev_object_setcomponent(scene_handle, obj, command->component, data + command->dataOffset);
+          } else {
+            GameObject parent = commands_resolve(command->parent);
+            if(parent) {
+              ev_scene_addchildtoobject(scene_handle, parent, obj);
+            }
+          }
+        }
+        break;
+    }
+    begin = end;
+  }
+  return command_count;
+}
+
+GameObject
+ev_scene_getactivecamera(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  return scene->activeCamera;
+}
+
+void
+ev_scene_setactivecamera(
+    GameScene scene_handle,
+    GameObject camera)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  scene->activeCamera = camera;
+}
+
+GameObject
+ev_scene_createcamera(
+    GameScene scene_handle,
+    CameraViewType type)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  GameObject camera = ev_scene_createobject(scene_handle);
+  GameECS->setComponent(scene->ecs_world, camera, CameraComponentID, &(CameraComponent) {
+      .viewType = type,
+  });
+  sceneobjects_addflags(scene, camera, SCENEOBJECT_FLAG_CAMERA);
+
+  if(scene->activeCamera == 0) {
+    scene->activeCamera = camera;
+  }
+
+  return camera;
+}
+
+#define EV_SCENE_SNAPSHOT_MAGIC   0x53535645 // "EVSS"
+#define EV_SCENE_SNAPSHOT_VERSION 2
+
+// Components captured besides the transforms, in snapshot order
+#define EV_SCENE_SNAPSHOT_COMPONENTS 4
+
+// Snapshot layout: header, then flat arrays in this order:
+//   GameObject objects[objectCount], parents[objectCount]
+//   TransformComponent transforms[objectCount]
+//   WorldTransformComponent worldTransforms[objectCount]
+//   U32 nameOffsets[objectCount] (into `names`, ~0u when unnamed)
+//   for each of camera, render, light and bounds:
+//     U32 slots[componentCounts[c]], Component data[componentCounts[c]]
+//   char names[nameBytes] (NUL-terminated)
+// where slots index into the object arrays.
+typedef struct {
+  U32 magic;
+  U32 version;
+  U32 objectCount;
+  U32 componentCounts[EV_SCENE_SNAPSHOT_COMPONENTS];
+  U32 nameBytes;
+  GameObject activeCamera;
+} SceneSnapshotHeader;
+
+void
+scenesnapshot_components(
+    GameComponentID ids[EV_SCENE_SNAPSHOT_COMPONENTS],
+    size_t sizes[EV_SCENE_SNAPSHOT_COMPONENTS])
+{
+  ids[0] = CameraComponentID;
+  sizes[0] = sizeof(CameraComponent);
+  ids[1] = RenderingData.RenderingComponentID;
+  sizes[1] = sizeof(RenderComponent);
+  ids[2] = RenderingData.LightComponentID;
+  sizes[2] = sizeof(LightComponent);
+  ids[3] = BoundsComponentID;
+  sizes[3] = sizeof(BoundsComponent);
+}
+
+U64
+scenesnapshot_size(
+    const SceneSnapshotHeader *header,
+    const size_t sizes[EV_SCENE_SNAPSHOT_COMPONENTS])
+{
+  U64 size = sizeof(SceneSnapshotHeader)
+    + (U64)header->objectCount * (2 * sizeof(GameObject) + sizeof(TransformComponent) + sizeof(WorldTransformComponent) + sizeof(U32))
+    + header->nameBytes;
+  for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+    size += (U64)header->componentCounts[c] * (sizeof(U32) + sizes[c]);
+  }
+  return size;
+}
+
+// Copies `size` bytes out of the (unaligned) snapshot buffer. NULL when
+// there is nothing to copy.
+PTR
+scenesnapshot_copyarray(
+    const U8 *src,
+    size_t size)
+{
+  if(size == 0) {
+    return NULL;
+  }
+  PTR dst = malloc(size);
+  memcpy(dst, src, size);
+  return dst;
+}
+
+SceneSnapshot
+ev_scene_snapshot(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneSnapshot){0});
+  U32 objectCount = (U32)vec_len((vec_t*)&scene->objects);
+  GameComponentID comp_ids[EV_SCENE_SNAPSHOT_COMPONENTS];
+  size_t comp_sizes[EV_SCENE_SNAPSHOT_COMPONENTS];
+  scenesnapshot_components(comp_ids, comp_sizes);
+
+  SceneSnapshotHeader header = {
+    .magic = EV_SCENE_SNAPSHOT_MAGIC,
+    .version = EV_SCENE_SNAPSHOT_VERSION,
+    .objectCount = objectCount,
+    .activeCamera = scene->activeCamera,
+  };
+  for(U32 i = 0; i < objectCount; i++) {
+    GameObject obj = scene->objects[i];
+    for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+      header.componentCounts[c] += GameECS->hasComponent(scene->ecs_world, obj, comp_ids[c]);
+    }
+    CONST_STR name = GameECS->getEntityName(scene->ecs_world, obj);
+    if(name) {
+      header.nameBytes += (U32)strlen(name) + 1;
+    }
+  }
+
+  SceneSnapshot snapshot;
+  snapshot.size = scenesnapshot_size(&header, comp_sizes);
+  snapshot.data = malloc(snapshot.size);
+
+  U8 *header_ptr = snapshot.data;
+  U8 *objects_ptr = header_ptr + sizeof(SceneSnapshotHeader);
+  U8 *parents_ptr = objects_ptr + objectCount * sizeof(GameObject);
+  U8 *transforms_ptr = parents_ptr + objectCount * sizeof(GameObject);
+  U8 *worldtransforms_ptr = transforms_ptr + objectCount * sizeof(TransformComponent);
+  U8 *nameoffsets_ptr = worldtransforms_ptr + objectCount * sizeof(WorldTransformComponent);
+  U8 *slots_ptrs[EV_SCENE_SNAPSHOT_COMPONENTS];
+  U8 *data_ptrs[EV_SCENE_SNAPSHOT_COMPONENTS];
+  U8 *section_ptr = nameoffsets_ptr + objectCount * sizeof(U32);
+  for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+    slots_ptrs[c] = section_ptr;
+    data_ptrs[c] = slots_ptrs[c] + header.componentCounts[c] * sizeof(U32);
+    section_ptr = data_ptrs[c] + header.componentCounts[c] * comp_sizes[c];
+  }
+  U8 *names_ptr = section_ptr;
+  U32 name_offset = 0;
+
+  memcpy(header_ptr, &header, sizeof(SceneSnapshotHeader));
+  if(objectCount > 0) {
+    memcpy(objects_ptr, scene->objects, objectCount * sizeof(GameObject));
+  }
+
+  for(U32 i = 0; i < objectCount; i++) {
+    GameObject obj = scene->objects[i];
+    GameObject parent = GameECS->getParent(scene->ecs_world, obj);
+    memcpy(parents_ptr + i * sizeof(GameObject), &parent, sizeof(GameObject));
+    memcpy(transforms_ptr + i * sizeof(TransformComponent),
+        GameECS->getComponent(scene->ecs_world, obj, TransformComponentID), sizeof(TransformComponent));
+    // Brings dirty world transforms up to date so the snapshot is consistent
+    memcpy(worldtransforms_ptr + i * sizeof(WorldTransformComponent),
+        _ev_object_getworldtransform(scene_handle, obj), sizeof(WorldTransformComponent));
+
+    CONST_STR name = GameECS->getEntityName(scene->ecs_world, obj);
+    U32 offset = ~0u;
+    if(name) {
+      size_t name_len = strlen(name) + 1;
+      memcpy(names_ptr + name_offset, name, name_len);
+      offset = name_offset;
+      name_offset += (U32)name_len;
+    }
+    memcpy(nameoffsets_ptr + i * sizeof(U32), &offset, sizeof(U32));
+
+    for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+      if(GameECS->hasComponent(scene->ecs_world, obj, comp_ids[c])) {
+        memcpy(slots_ptrs[c], &i, sizeof(U32));
+        memcpy(data_ptrs[c], GameECS->getComponent(scene->ecs_world, obj, comp_ids[c]), comp_sizes[c]);
+        slots_ptrs[c] += sizeof(U32);
+        data_ptrs[c] += comp_sizes[c];
+      }
+    }
+  }
+
+  return snapshot;
+}
+
+void
+ev_scene_freesnapshot(
+    SceneSnapshot snapshot)
+{
+  free(snapshot.data);
+}
+
+// Drops a component the object gained after the snapshot, along with the
+// per-scene state derived from it.
+void
+scenesnapshot_removecomponent(
+    GameSceneStruct *scene,
+    GameObject obj,
+    GameComponentID comp_id)
+{
+  GameECS->removeComponent(scene->ecs_world, obj, comp_id);
+  sceneobjects_removeflags(scene, obj, sceneobjects_componentflag(comp_id));
+  if(comp_id == BoundsComponentID) {
+    U32 slot;
+    if(indexmap_get(&scene->object_slots, obj, &slot) && scene->object_proxies[slot] != SCENEBVH_NULL) {
+      scenebvh_destroyproxy(&scene->bvh, scene->object_proxies[slot]);
+      scene->object_proxies[slot] = SCENEBVH_NULL;
+    }
+  }
+}
+
+// Writes one snapshot section back. Objects that still have the component
+// are overwritten in place in the ECS storage; only objects that lost it go
+// through setComponent (and a table move). Objects that gained it since are
+// stripped.
+void
+scenesnapshot_restorecomponents(
+    GameSceneStruct *scene,
+    GameComponentID comp_id,
+    size_t comp_size,
+    const GameObject *remap,
+    U32 objectCount,
+    const U8 *slots_ptr,
+    const U8 *data_ptr,
+    U32 count)
+{
+  U8 *captured = objectCount ? calloc(objectCount, 1) : NULL;
+  for(U32 i = 0; i < count; i++) {
+    U32 slot;
+    memcpy(&slot, slots_ptr + i * sizeof(U32), sizeof(U32));
+    captured[slot] = 1;
+    GameObject obj = remap[slot];
+    if(GameECS->hasComponent(scene->ecs_world, obj, comp_id)) {
+      memcpy(GameECS->getComponentMut(scene->ecs_world, obj, comp_id), data_ptr + i * comp_size, comp_size);
+      GameECS->modified(scene->ecs_world, obj, comp_id);
+    } else {
+      GameECS->setComponent(scene->ecs_world, obj, comp_id, (PTR)(data_ptr + i * comp_size));
+      sceneobjects_addflags(scene, obj, sceneobjects_componentflag(comp_id));
     }
+  }
 
-    evstring_free(component_type);
-    evstring_free(component_type_id);
-    evstring_free(component_id);
+  for(U32 i = 0; i < objectCount; i++) {
+    if(!captured[i] && GameECS->hasComponent(scene->ecs_world, remap[i], comp_id)) {
+      scenesnapshot_removecomponent(scene, remap[i], comp_id);
+    }
   }
+  free(captured);
+}
 
-  evstring_free(components_count_id);
-  evstring_free(components_id);
+// Brings the scene back to the state captured in `snapshot`. Objects created
+// since are destroyed, and objects destroyed since are recreated (under new
+// ids, with their names and paths). Script and rigidbody state is not part of
+// the snapshot. Component data is written back one object and one component
+// at a time (getComponentMut and a memcpy), not as whole columns, as the ECS
+// has no way to hand out a table column for writing.
+bool
+ev_scene_restore(
+    GameScene scene_handle,
+    SceneSnapshot snapshot)
+{
+  GameScene scene_idx = scene_handle?scene_handle:GameData.activeScene;
+  GET_SCENE_OR_RETURN(scene, scene_idx, false);
+  GameComponentID comp_ids[EV_SCENE_SNAPSHOT_COMPONENTS];
+  size_t comp_sizes[EV_SCENE_SNAPSHOT_COMPONENTS];
+  scenesnapshot_components(comp_ids, comp_sizes);
+
+  SceneSnapshotHeader header;
+  if(snapshot.data == NULL || snapshot.size < sizeof(SceneSnapshotHeader)) {
+    return false;
+  }
+  memcpy(&header, snapshot.data, sizeof(SceneSnapshotHeader));
+  if(header.magic != EV_SCENE_SNAPSHOT_MAGIC || header.version != EV_SCENE_SNAPSHOT_VERSION
+      || snapshot.size != scenesnapshot_size(&header, comp_sizes)) {
+    ev_log_error("Invalid scene snapshot");
+    return false;
+  }
 
-  EV_DEFER(
-      evstring children_count_id = evstring_newfmt("%schildren.len", prefix),
-      evstring_free(children_count_id))
-  {
-    evjson_entry *children_count_res = evjs_get(json, children_count_id);
-    if(children_count_res) {
-      int children_count = (int)children_count_res->as_num;
-      for(int i = 0; i < children_count; i++) {
-        evstring child_id = evstring_newfmt("%schildren[%d]", prefix, i);
-        ev_sceneloader_loadnode(scene, json, &child_id, obj);
-        evstring_free(child_id);
+  U32 objectCount = header.objectCount;
+  const U8 *objects_ptr = (const U8 *)snapshot.data + sizeof(SceneSnapshotHeader);
+  const U8 *parents_ptr = objects_ptr + objectCount * sizeof(GameObject);
+  const U8 *transforms_ptr = parents_ptr + objectCount * sizeof(GameObject);
+  const U8 *worldtransforms_ptr = transforms_ptr + objectCount * sizeof(TransformComponent);
+  const U8 *nameoffsets_ptr = worldtransforms_ptr + objectCount * sizeof(WorldTransformComponent);
+  const U8 *slots_ptrs[EV_SCENE_SNAPSHOT_COMPONENTS];
+  const U8 *data_ptrs[EV_SCENE_SNAPSHOT_COMPONENTS];
+  const U8 *section_ptr = nameoffsets_ptr + objectCount * sizeof(U32);
+  for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+    slots_ptrs[c] = section_ptr;
+    data_ptrs[c] = slots_ptrs[c] + header.componentCounts[c] * sizeof(U32);
+    section_ptr = data_ptrs[c] + header.componentCounts[c] * comp_sizes[c];
+  }
+  CONST_STR names = (CONST_STR)section_ptr;
+
+  // All NULL for an empty snapshot; every loop below is bounded by objectCount
+  GameObject *snapshot_objects = scenesnapshot_copyarray(objects_ptr, objectCount * sizeof(GameObject));
+  GameObject *snapshot_parents = scenesnapshot_copyarray(parents_ptr, objectCount * sizeof(GameObject));
+  TransformComponent *transforms = scenesnapshot_copyarray(transforms_ptr, objectCount * sizeof(TransformComponent));
+  WorldTransformComponent *worldtransforms = scenesnapshot_copyarray(worldtransforms_ptr, objectCount * sizeof(WorldTransformComponent));
+  U32 *name_offsets = scenesnapshot_copyarray(nameoffsets_ptr, objectCount * sizeof(U32));
+  GameObject *remap = objectCount ? malloc(objectCount * sizeof(GameObject)) : NULL;
+  // Objects whose path has to be rebuilt: recreated or moved
+  U8 *path_dirty = objectCount ? calloc(objectCount, 1) : NULL;
+
+  IndexMap snapshot_slots;
+  indexmap_init(&snapshot_slots);
+  for(U32 i = 0; i < objectCount; i++) {
+    indexmap_set(&snapshot_slots, snapshot_objects[i], i);
+  }
+
+  // Objects destroyed since the snapshot are recreated; parents are fixed up
+  // below once every object exists.
+  for(U32 i = 0; i < objectCount; i++) {
+    if(indexmap_get(&scene->object_slots, snapshot_objects[i], NULL)) {
+      remap[i] = snapshot_objects[i];
+    } else {
+      remap[i] = GameECS->createEntity(scene->ecs_world);
+      sceneobjects_register(scene, remap[i]);
+      path_dirty[i] = 1;
+    }
+
+    if(name_offsets[i] < header.nameBytes) {
+      CONST_STR name = names + name_offsets[i];
+      CONST_STR current_name = GameECS->getEntityName(scene->ecs_world, remap[i]);
+      if(current_name == NULL || strcmp(current_name, name) != 0) {
+        GameECS->setEntityName(scene->ecs_world, remap[i], name);
+        path_dirty[i] = 1;
       }
     }
   }
 
-  return obj;
-}
+  for(U32 i = 0; i < objectCount; i++) {
+    if(snapshot_parents[i] == 0) {
+      continue;
+    }
+    U32 parent_slot;
+    GameObject parent = snapshot_parents[i];
+    if(indexmap_get(&snapshot_slots, parent, &parent_slot)) {
+      parent = remap[parent_slot];
+    }
+    if(GameECS->getParent(scene->ecs_world, remap[i]) != parent) {
+      GameECS->addChildToEntity(scene->ecs_world, parent, remap[i]);
+      path_dirty[i] = 1;
+    }
+  }
 
-GameScene
-ev_scene_loadfromfile(
-    CONST_STR path)
-{
-  GameScene newscene = ev_scene_create();
-  AssetHandle scenefile_handle = Asset->load(path);
-  JSONAsset scene_jsonasset = JSONLoader->loadAsset(scenefile_handle);
-  evjson_t *scene_desc = (evjson_t*)scene_jsonasset.json_data;
+  // Objects created since the snapshot. Collected first as destroying
+  // modifies the object table.
+  IndexMap restored_objects;
+  indexmap_init(&restored_objects);
+  for(U32 i = 0; i < objectCount; i++) {
+    indexmap_set(&restored_objects, remap[i], i);
+  }
+  vec(GameObject) extra_objects = vec_init(GameObject, NULL, NULL);
+  size_t live_count = vec_len((vec_t*)&scene->objects);
+  for(size_t i = 0; i < live_count; i++) {
+    GameObject obj = scene->objects[i];
+    if(!indexmap_get(&restored_objects, obj, NULL)) {
+      vec_push((vec_t*)&extra_objects, &obj);
+    }
+  }
+  indexmap_fini(&restored_objects);
+  size_t extra_count = vec_len((vec_t*)&extra_objects);
+  for(size_t i = 0; i < extra_count; i++) {
+    // May already be gone along with a destroyed ancestor
+    if(indexmap_get(&scene->object_slots, extra_objects[i], NULL)) {
+      sceneobjects_destroyimmediate(scene_idx, extra_objects[i]);
+    }
+  }
+  vec_fini(extra_objects);
 
-  if (evjs_get(scene_desc, "pipelines")) {
-    GraphicsPipeline->readJSONList(scene_desc, "pipelines");
+  // Paths are rebuilt parent-first by the recursive refresh, so each dirty
+  // subtree is only walked once from its topmost dirty object.
+  for(U32 i = 0; i < objectCount; i++) {
+    if(!path_dirty[i]) {
+      continue;
+    }
+    U32 parent_slot;
+    if(snapshot_parents[i] != 0 && indexmap_get(&snapshot_slots, snapshot_parents[i], &parent_slot)
+        && path_dirty[parent_slot]) {
+      continue;
+    }
+    scene_walk(scene, remap[i], scenepaths_refresh);
   }
 
-  if (evjs_get(scene_desc, "materials")) {
-    Material->readJSONList(scene_desc, "materials");
+  // Every restored object has both transforms, so these are written in place
+  for(U32 i = 0; i < objectCount; i++) {
+    memcpy(GameECS->getComponentMut(scene->ecs_world, remap[i], TransformComponentID), &transforms[i], sizeof(TransformComponent));
+    memcpy(GameECS->getComponentMut(scene->ecs_world, remap[i], WorldTransformComponentID), &worldtransforms[i], sizeof(WorldTransformComponent));
+    if(GameECS->hasTag(scene->ecs_world, remap[i], DirtyTransformTagID)) {
+      GameECS->removeTag(scene->ecs_world, remap[i], DirtyTransformTagID);
+    }
+  }
+  for(U32 c = 0; c < EV_SCENE_SNAPSHOT_COMPONENTS; c++) {
+    scenesnapshot_restorecomponents(scene, comp_ids[c], comp_sizes[c],
+        remap, objectCount, slots_ptrs[c], data_ptrs[c], header.componentCounts[c]);
+  }
+  for(U32 i = 0; i < objectCount; i++) {
+    scenebounds_update(scene, remap[i]);
   }
 
-  int nodes_count = (int)evjs_get(scene_desc, "nodes.len")->as_num;
-  for(int i = 0; i < nodes_count; i++) {
-    evstring node_id = evstring_newfmt("nodes[%d]", i);
-    ev_sceneloader_loadnode(newscene, scene_desc, &node_id, 0);
-    evstring_free(node_id);
+  U32 camera_slot;
+  if(indexmap_get(&snapshot_slots, header.activeCamera, &camera_slot)) {
+    scene->activeCamera = remap[camera_slot];
+  } else {
+    scene->activeCamera = header.activeCamera;
   }
 
-  evstring activeCamera = evstring_refclone(evjs_get(scene_desc, "activeCamera")->as_str);
-  ev_scene_setactivecamera(newscene, ev_scene_getobject(newscene, activeCamera));
-  evstring_free(activeCamera);
+  indexmap_fini(&snapshot_slots);
+  free(path_dirty);
+  free(remap);
+  free(name_offsets);
+  free(worldtransforms);
+  free(transforms);
+  free(snapshot_parents);
+  free(snapshot_objects);
 
-  Asset->free(scenefile_handle);
-  return newscene;
+  return true;
 }
 
-U32
-ev_game_progress(
-    F32 deltaTime)
+// Times a restore of the scene against loading its source file again. The
+// scene ends up restored to its current state; the loaded copy is destroyed.
+SceneRestoreBenchmark
+ev_scene_benchmarkrestore(
+    GameScene scene_handle)
 {
-  U32 result = 0;
-
-  result |= PhysicsWorld->progress(GameData.scenes[GameData.activeScene].physics_world, deltaTime);
-  result |= Script->progress(deltaTime);
-  result |= GameECS->progress(GameData.scenes[GameData.activeScene].ecs_world, deltaTime);
+  GameScene scene_idx = scene_handle?scene_handle:GameData.activeScene;
+  GET_SCENE_OR_RETURN(scene, scene_idx, (SceneRestoreBenchmark){0});
+  SceneRestoreBenchmark benchmark = {
+    .objectCount = (U32)vec_len((vec_t*)&scene->objects),
+  };
+  if(scene->sourcePath == NULL) {
+    ev_log_error("Scene { %llu } wasn't loaded from a file, nothing to compare restore against", scene_idx);
+    return benchmark;
+  }
 
-  return result;
+  SceneSnapshot snapshot = ev_scene_snapshot(scene_idx);
+  F64 start = ev_game_gettimems();
+  ev_scene_restore(scene_idx, snapshot);
+  benchmark.restoreMs = (F32)(ev_game_gettimems() - start);
+  ev_scene_freesnapshot(snapshot);
+
+  // Copied, as loading can move the scene array and `scene` with it
+  evstring path = evstring_new(scene->sourcePath);
+  start = ev_game_gettimems();
+  GameScene loaded = ev_scene_loadfromfile(path);
+  benchmark.loadMs = (F32)(ev_game_gettimems() - start);
+  ev_scene_destroy(loaded);
+  evstring_free(path);
+
+  return benchmark;
 }
 
-const Matrix4x4 *
-_ev_object_getworldtransform(
-    GameScene world,
-    GameObject entt);
+#define EV_REPLICATION_PACKET_MAGIC 0x50525645 // "EVRP"
+
+// Decoding end of replication. Keeps its own history of decoded frames to
+// resolve the baselines of incoming packets.
+typedef struct {
+  SceneReplicationFrame history[EV_GAME_REPLICATION_HISTORY];
+  U32 latestFrame;
+  // Remote object -> slot in `localObjects`
+  IndexMap objectMap;
+  vec(GameObject) localObjects;
+  // Changes of the last decoded packet, applied by `Replication.apply`
+  U32 lastFrame;
+  vec(U32) changed; // Slots in the last decoded frame
+  vec(GameObject) removed;
+  // A packet is decoded into these, and only swapped with its history slot
+  // and the changes above once it has been read through without error
+  SceneReplicationFrame scratch;
+  vec(U32) scratchChanged;
+  vec(GameObject) scratchRemoved;
+  // Dequantized view of the latest frame
+  vec(Vec3) viewPositions;
+  vec(Vec4) viewRotations;
+  vec(Vec3) viewScales;
+} ReplicationDecoderData;
 
 void
-ev_gamemod_scriptapi_loader(
-    EVNS_ScriptInterface *ScriptInterface,
-    ScriptContextHandle ctx_h);
+replicationbits_write(
+    ReplicationBitWriter *writer,
+    U32 value,
+    U32 bits)
+{
+  U64 mask = (1ULL << bits) - 1;
+  writer->scratch |= ((U64)value & mask) << writer->scratchBits;
+  writer->scratchBits += bits;
+  while(writer->scratchBits >= 8) {
+    U8 byte = (U8)(writer->scratch & 0xFF);
+    vec_push((vec_t*)&writer->bytes, &byte);
+    writer->scratch >>= 8;
+    writer->scratchBits -= 8;
+  }
+}
 
 void
-transform_setdirty(
-    ECSGameWorldHandle world,
-    GameEntityID entt)
+replicationbits_flush(
+    ReplicationBitWriter *writer)
 {
-  if(GameECS->hasTag(world, entt, DirtyTransformTagID)) {
-    return;
+  if(writer->scratchBits > 0) {
+    replicationbits_write(writer, 0, 8 - writer->scratchBits);
   }
+}
 
-  GameECS->addTag(world, entt, DirtyTransformTagID);
-  GameECS->forEachChild(world, entt, transform_setdirty);
+U32
+replicationbits_read(
+    ReplicationBitReader *reader,
+    U32 bits)
+{
+  if(reader->bitPos + bits > reader->size * 8) {
+    reader->overflow = true;
+    return 0;
+  }
+  U32 value = 0;
+  U32 got = 0;
+  while(got < bits) {
+    U32 offset = (U32)(reader->bitPos & 7);
+    U32 take = 8 - offset;
+    if(take > bits - got) {
+      take = bits - got;
+    }
+    U32 byte = reader->data[reader->bitPos >> 3];
+    value |= ((byte >> offset) & ((1u << take) - 1)) << got;
+    got += take;
+    reader->bitPos += take;
+  }
+  return value;
 }
 
+// Variable width: 5 bits of width, then the value in that many bits
 void
-_ev_object_setrotation(
-    GameScene scene_handle,
-    GameObject entt,
-    Vec4 new_rot)
+replicationbits_writevarint(
+    ReplicationBitWriter *writer,
+    U32 value)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *tr = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  GameECS->setComponent(scene.ecs_world, entt, TransformComponentID, &(TransformComponent) {
-      .position = tr->position,
-      .rotation = new_rot,
-      .scale = tr->scale
-  });
-  transform_setdirty(scene.ecs_world, entt);
+  U32 width = 1;
+  while(width < 32 && (value >> width) != 0) {
+    width++;
+  }
+  replicationbits_write(writer, width - 1, 5);
+  replicationbits_write(writer, value, width);
 }
 
-GameObject
-ev_scene_getobject(
-    GameScene scene_handle,
-    CONST_STR name)
+U32
+replicationbits_readvarint(
+    ReplicationBitReader *reader)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return GameECS->getEntityFromName(scene.ecs_world, name);
+  U32 width = replicationbits_read(reader, 5) + 1;
+  return replicationbits_read(reader, width);
 }
 
-GameObject
-ev_object_getchild(
-    GameScene scene_handle,
-    GameObject parent,
-    CONST_STR name)
+// Deltas are zigzag encoded so that small ones of either sign stay narrow
+void
+replicationbits_writedelta(
+    ReplicationBitWriter *writer,
+    I32 value,
+    I32 base)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return GameECS->getChildFromName(scene.ecs_world, parent, name);
+  I32 delta = (I32)((U32)value - (U32)base);
+  replicationbits_writevarint(writer, ((U32)delta << 1) ^ (U32)(delta >> 31));
 }
 
-void
-_ev_object_setposition(
-    GameScene scene_handle,
-    GameObject entt,
-    Vec3 new_pos)
+I32
+replicationbits_readdelta(
+    ReplicationBitReader *reader,
+    I32 base)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *tr = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  GameECS->setComponent(scene.ecs_world, entt, TransformComponentID, &(TransformComponent) {
-      .position = new_pos,
-      .rotation = tr->rotation,
-      .scale = tr->scale
-  });
-  transform_setdirty(scene.ecs_world, entt);
+  U32 zigzag = replicationbits_readvarint(reader);
+  I32 delta = (I32)(zigzag >> 1) ^ -(I32)(zigzag & 1);
+  return (I32)((U32)base + (U32)delta);
 }
 
-void
-ev_object_settransform(
-    GameScene scene_handle,
-    GameObject entt,
-    Vec3 new_pos,
-    Vec4 new_rot,
-    Vec3 new_scale)
+I32
+replication_quantize(
+    F32 value)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  TransformComponent transform = {
-      .position = new_pos,
-      .rotation = new_rot,
-      .scale = new_scale
-  };
-  GameECS->setComponent(scene.ecs_world, entt, TransformComponentID, &transform);
-  WorldTransformComponent wt;
-  GameECS->setComponent(scene.ecs_world, entt, WorldTransformComponentID, &wt);
-  transform_setdirty(scene.ecs_world, entt);
-  worldtransform_update(scene_handle, entt);
+  F32 q = value * EV_GAME_REPLICATION_POSITION_SCALE;
+  // Largest floats that still fit in an I32
+  q = glm_clamp(q, -2147483520.f, 2147483520.f);
+  return (I32)lroundf(q);
 }
 
-Vec3
-_ev_object_getrotationeuler(
-    GameScene scene_handle,
-    GameObject entt)
+// Smallest three: the largest component is dropped and rebuilt from the
+// others, which then all fit in [-1/sqrt(2), 1/sqrt(2)].
+U32
+replication_packquat(
+    Vec4 rotation)
 {
-  const Matrix4x4 *rotationMatrix = _ev_object_getworldtransform(scene_handle, entt);
-  Vec3 res;
-  glm_euler_angles((vec4*)*rotationMatrix, (float*)&res);
-  return res;
+  F32 c[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+  U32 largest = 0;
+  for(U32 i = 1; i < 4; i++) {
+    if(fabsf(c[i]) > fabsf(c[largest])) {
+      largest = i;
+    }
+  }
+  // q and -q are the same rotation; the dropped component is kept positive
+  F32 sign = c[largest] < 0.f ? -1.f : 1.f;
+  U32 maxValue = (1u << EV_GAME_REPLICATION_ROTATION_BITS) - 1;
+
+  U32 packed = largest;
+  U32 shift = 2;
+  for(U32 i = 0; i < 4; i++) {
+    if(i == largest) {
+      continue;
+    }
+    F32 normalized = glm_clamp(c[i] * sign * 0.70710678f + 0.5f, 0.f, 1.f);
+    packed |= (U32)lroundf(normalized * maxValue) << shift;
+    shift += EV_GAME_REPLICATION_ROTATION_BITS;
+  }
+  return packed;
 }
 
-void
-_ev_object_setrotationeuler(
-    GameScene scene_handle,
-    GameObject entt,
-    Vec3 new_angles)
+Vec4
+replication_unpackquat(
+    U32 packed)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *tr = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
+  F32 c[4];
+  U32 largest = packed & 3;
+  U32 maxValue = (1u << EV_GAME_REPLICATION_ROTATION_BITS) - 1;
+
+  U32 shift = 2;
+  F32 sum = 0.f;
+  for(U32 i = 0; i < 4; i++) {
+    if(i == largest) {
+      continue;
+    }
+    F32 normalized = (F32)((packed >> shift) & maxValue) / maxValue;
+    c[i] = (normalized - 0.5f) * 1.41421356f;
+    sum += c[i] * c[i];
+    shift += EV_GAME_REPLICATION_ROTATION_BITS;
+  }
+  c[largest] = sqrtf(sum < 1.f ? 1.f - sum : 0.f);
 
+  Vec4 rotation = { .x = c[0], .y = c[1], .z = c[2], .w = c[3] };
+  glm_quat_normalize((float*)&rotation);
+  return rotation;
+}
 
-  Vec4 rot_quat;
-  Matrix4x4 rotationMatrix;
-  glm_euler((float*)&new_angles, rotationMatrix);
-  glm_mat4_quat(rotationMatrix, (float*)&rot_quat);
+SceneReplicationFrame *
+replication_getframe(
+    SceneReplicationFrame *history,
+    U32 frame)
+{
+  if(frame == 0) {
+    return NULL;
+  }
+  SceneReplicationFrame *slot = &history[frame % EV_GAME_REPLICATION_HISTORY];
+  return slot->frame == frame ? slot : NULL;
+}
 
-  GameECS->setComponent(scene.ecs_world, entt, TransformComponentID, &(TransformComponent) {
-      .position = tr->position,
-      .rotation = rot_quat,
-      .scale = tr->scale
-  });
+bool
+replication_sametypes(
+    const SceneReplicationFrame *a,
+    const SceneReplicationFrame *b)
+{
+  U32 count = (U32)vec_len((vec_t*)&a->componentTypes);
+  return count == vec_len((vec_t*)&b->componentTypes)
+    && !memcmp(a->componentTypes, b->componentTypes, count * sizeof(SceneReplicationComponent));
+}
 
-  transform_setdirty(scene.ecs_world, entt);
+I32
+replication_compareobjects(
+    const void *a,
+    const void *b)
+{
+  GameObject lhs = *(const GameObject *)a;
+  GameObject rhs = *(const GameObject *)b;
+  return lhs < rhs ? -1 : (lhs > rhs);
 }
 
-void
-_ev_object_setscale(
+// Selects a component to replicate alongside transforms. Takes effect from
+// the next captured frame; frames captured before can no longer be used as
+// baselines.
+bool
+ev_replication_addcomponent(
     GameScene scene_handle,
-    GameObject entt,
-    Vec3 new_scale)
+    GameComponentID comp_id,
+    U32 size)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *tr = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  GameECS->setComponent(scene.ecs_world, entt, TransformComponentID, &(TransformComponent) {
-      .position = tr->position,
-      .rotation = tr->rotation,
-      .scale = new_scale
-  });
-  transform_setdirty(scene.ecs_world, entt);
+  GET_SCENE_OR_RETURN(scene, scene_handle, false);
+  SceneReplicationData *replication = &scene->replication;
+  U32 count = (U32)vec_len((vec_t*)&replication->components);
+  for(U32 i = 0; i < count; i++) {
+    if(replication->components[i].id == comp_id) {
+      return true;
+    }
+  }
+  if(count == EV_GAME_REPLICATION_MAX_COMPONENTS || size == 0 || size > UINT16_MAX) {
+    ev_log_error("Replication: can't replicate component { %llu } of size %u", comp_id, size);
+    return false;
+  }
+  SceneReplicationComponent component = {
+    .id = comp_id,
+    .size = size,
+  };
+  vec_push((vec_t*)&replication->components, &component);
+  return true;
 }
 
-Vec4
-_ev_object_getrotation(
-    GameScene scene_handle,
-    GameObject entt)
+// Captures the scene's transforms and replicated components into a new
+// frame, and returns its number. Frames stay usable as baselines for the
+// next `EV_GAME_REPLICATION_HISTORY` captures.
+U32
+ev_replication_capture(
+    GameScene scene_handle)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *comp = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  return comp->rotation;
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  SceneReplicationData *replication = &scene->replication;
+  U32 frame_number = ++replication->frameCounter;
+  if(frame_number == 0) {
+    frame_number = ++replication->frameCounter;
+  }
+  SceneReplicationFrame *frame = &replication->history[frame_number % EV_GAME_REPLICATION_HISTORY];
+  frame->frame = frame_number;
+
+  U32 type_count = (U32)vec_len((vec_t*)&replication->components);
+  vec_setlen((vec_t*)&frame->componentTypes, type_count);
+  memcpy(frame->componentTypes, replication->components, type_count * sizeof(SceneReplicationComponent));
+  frame->componentStride = 0;
+  for(U32 t = 0; t < type_count; t++) {
+    frame->componentStride += 1 + frame->componentTypes[t].size;
+  }
+
+  U32 object_count = (U32)vec_len((vec_t*)&scene->objects);
+  vec_setlen((vec_t*)&frame->objects, object_count);
+  vec_setlen((vec_t*)&frame->transforms, object_count);
+  vec_setlen((vec_t*)&frame->components, object_count * frame->componentStride);
+  memcpy(frame->objects, scene->objects, object_count * sizeof(GameObject));
+  qsort(frame->objects, object_count, sizeof(GameObject), replication_compareobjects);
+
+  for(U32 i = 0; i < object_count; i++) {
+    GameObject obj = frame->objects[i];
+    const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, obj, TransformComponentID);
+    SceneReplicationTransform *quantized = &frame->transforms[i];
+    quantized->position[0] = replication_quantize(tr->position.x);
+    quantized->position[1] = replication_quantize(tr->position.y);
+    quantized->position[2] = replication_quantize(tr->position.z);
+    quantized->scale[0] = replication_quantize(tr->scale.x);
+    quantized->scale[1] = replication_quantize(tr->scale.y);
+    quantized->scale[2] = replication_quantize(tr->scale.z);
+    quantized->rotation = replication_packquat(tr->rotation);
+
+    U8 *block = frame->components + i * frame->componentStride;
+    memset(block, 0, frame->componentStride);
+    for(U32 t = 0; t < type_count; t++) {
+      SceneReplicationComponent type = frame->componentTypes[t];
+      if(GameECS->hasComponent(scene->ecs_world, obj, type.id)) {
+        block[0] = 1;
+        memcpy(block + 1, GameECS->getComponent(scene->ecs_world, obj, type.id), type.size);
+      }
+      block += 1 + type.size;
+    }
+  }
+
+  return frame_number;
 }
 
-CONST_STR
-ev_object_getname(
+// Encodes `frame` against `baseline`, normally the last frame the receiving
+// end acknowledged. Only objects whose quantized transform or replicated
+// components differ are written, each with a mask of what changed. Falls
+// back to the whole frame if the baseline is 0 or no longer in the history.
+ReplicationPacket
+ev_replication_encode(
     GameScene scene_handle,
-    GameObject entt)
+    U32 frame_number,
+    U32 baseline_number)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (ReplicationPacket){0});
+  SceneReplicationData *replication = &scene->replication;
+  ReplicationPacket packet = {0};
+
+  const SceneReplicationFrame *frame = replication_getframe(replication->history, frame_number);
+  if(frame == NULL) {
+    ev_log_error("Replication: frame %u is not in the history", frame_number);
+    return packet;
+  }
+  const SceneReplicationFrame *baseline = replication_getframe(replication->history, baseline_number);
+  if(baseline && (baseline_number >= frame_number || !replication_sametypes(frame, baseline))) {
+    baseline = NULL;
+  }
+
+  U32 type_count = (U32)vec_len((vec_t*)&frame->componentTypes);
+  U32 stride = frame->componentStride;
+  U32 object_count = (U32)vec_len((vec_t*)&frame->objects);
+  U32 base_count = baseline ? (U32)vec_len((vec_t*)&baseline->objects) : 0;
+
+  // Both object lists are sorted, so one merge pass finds removed, new and
+  // changed objects
+  vec_clear(replication->removed);
+  vec_clear(replication->changed);
+  vec_clear(replication->baseSlots);
+  U32 j = 0;
+  for(U32 i = 0; i < object_count; i++) {
+    GameObject obj = frame->objects[i];
+    while(j < base_count && baseline->objects[j] < obj) {
+      vec_push((vec_t*)&replication->removed, &baseline->objects[j]);
+      j++;
+    }
+    U32 base_slot = ~0u;
+    if(j < base_count && baseline->objects[j] == obj) {
+      base_slot = j++;
+      if(!memcmp(&frame->transforms[i], &baseline->transforms[base_slot], sizeof(SceneReplicationTransform))
+          && !memcmp(frame->components + i * stride, baseline->components + base_slot * stride, stride)) {
+        continue;
+      }
+    }
+    vec_push((vec_t*)&replication->changed, &i);
+    vec_push((vec_t*)&replication->baseSlots, &base_slot);
+  }
+  for(; j < base_count; j++) {
+    vec_push((vec_t*)&replication->removed, &baseline->objects[j]);
+  }
+
+  ReplicationBitWriter *writer = &replication->writer;
+  vec_clear(writer->bytes);
+  writer->scratch = 0;
+  writer->scratchBits = 0;
+
+  U32 removed_count = (U32)vec_len((vec_t*)&replication->removed);
+  U32 changed_count = (U32)vec_len((vec_t*)&replication->changed);
+
+  replicationbits_write(writer, EV_REPLICATION_PACKET_MAGIC, 32);
+  replicationbits_write(writer, frame_number, 32);
+  replicationbits_write(writer, baseline ? baseline_number : 0, 32);
+  replicationbits_write(writer, type_count, 8);
+  for(U32 t = 0; t < type_count; t++) {
+    replicationbits_write(writer, (U32)frame->componentTypes[t].id, 32);
+    replicationbits_write(writer, (U32)(frame->componentTypes[t].id >> 32), 32);
+    replicationbits_write(writer, frame->componentTypes[t].size, 16);
+  }
+  replicationbits_writevarint(writer, removed_count);
+  replicationbits_writevarint(writer, changed_count);
+
+  // Object ids are sent as 64-bit gaps from the previous one
+  GameObject previous = 0;
+  for(U32 r = 0; r < removed_count; r++) {
+    U64 gap = replication->removed[r] - previous;
+    replicationbits_writevarint(writer, (U32)gap);
+    replicationbits_writevarint(writer, (U32)(gap >> 32));
+    previous = replication->removed[r];
+  }
+
+  // New objects are encoded against an all-zero state
+  static const SceneReplicationTransform ZeroTransform = {0};
+  previous = 0;
+  for(U32 c = 0; c < changed_count; c++) {
+    U32 slot = replication->changed[c];
+    U32 base_slot = replication->baseSlots[c];
+    GameObject obj = frame->objects[slot];
+    const SceneReplicationTransform *cur = &frame->transforms[slot];
+    const SceneReplicationTransform *base = base_slot != ~0u ? &baseline->transforms[base_slot] : &ZeroTransform;
+    const U8 *cur_block = frame->components + slot * stride;
+    const U8 *base_block = base_slot != ~0u ? baseline->components + base_slot * stride : NULL;
+
+    U64 gap = obj - previous;
+    replicationbits_writevarint(writer, (U32)gap);
+    replicationbits_writevarint(writer, (U32)(gap >> 32));
+    previous = obj;
+
+    bool position_changed = memcmp(cur->position, base->position, sizeof(cur->position)) != 0;
+    bool rotation_changed = cur->rotation != base->rotation;
+    bool scale_changed = memcmp(cur->scale, base->scale, sizeof(cur->scale)) != 0;
+    replicationbits_write(writer, position_changed, 1);
+    replicationbits_write(writer, rotation_changed, 1);
+    replicationbits_write(writer, scale_changed, 1);
+
+    if(position_changed) {
+      for(U32 a = 0; a < 3; a++) {
+        replicationbits_writedelta(writer, cur->position[a], base->position[a]);
+      }
+    }
+    if(rotation_changed) {
+      replicationbits_write(writer, cur->rotation, 2 + 3 * EV_GAME_REPLICATION_ROTATION_BITS);
+    }
+    if(scale_changed) {
+      for(U32 a = 0; a < 3; a++) {
+        replicationbits_writedelta(writer, cur->scale[a], base->scale[a]);
+      }
+    }
+
+    U32 offset = 0;
+    for(U32 t = 0; t < type_count; t++) {
+      U32 size = frame->componentTypes[t].size;
+      bool present = cur_block[offset] != 0;
+      bool changed = base_block ? memcmp(cur_block + offset, base_block + offset, 1 + size) != 0 : present;
+      replicationbits_write(writer, changed, 1);
+      if(changed) {
+        replicationbits_write(writer, present, 1);
+        if(present) {
+          for(U32 b = 0; b < size; b++) {
+            replicationbits_write(writer, cur_block[offset + 1 + b], 8);
+          }
+        }
+      }
+      offset += 1 + size;
+    }
+  }
+  replicationbits_flush(writer);
+
+  packet.frame = frame_number;
+  packet.baseline = baseline ? baseline_number : 0;
+  packet.size = vec_len((vec_t*)&writer->bytes);
+  packet.data = malloc(packet.size);
+  memcpy(packet.data, writer->bytes, packet.size);
+  return packet;
+}
+
+void
+ev_replication_freepacket(
+    ReplicationPacket packet)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return GameECS->getEntityName(scene.ecs_world,entt);
+  free(packet.data);
 }
 
-Vec3
-_ev_object_getposition(
-    GameScene scene_handle,
-    GameObject entt)
+ReplicationDecoder
+ev_replication_createdecoder()
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *comp = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  return comp->position;
+  ReplicationDecoderData *decoder = malloc(sizeof(ReplicationDecoderData));
+  for(U32 i = 0; i < EV_GAME_REPLICATION_HISTORY; i++) {
+    scenereplicationframe_init(&decoder->history[i]);
+  }
+  decoder->latestFrame = 0;
+  indexmap_init(&decoder->objectMap);
+  decoder->localObjects = vec_init(GameObject, NULL, NULL);
+  decoder->lastFrame = 0;
+  decoder->changed = vec_init(U32, NULL, NULL);
+  decoder->removed = vec_init(GameObject, NULL, NULL);
+  scenereplicationframe_init(&decoder->scratch);
+  decoder->scratchChanged = vec_init(U32, NULL, NULL);
+  decoder->scratchRemoved = vec_init(GameObject, NULL, NULL);
+  decoder->viewPositions = vec_init(Vec3, NULL, NULL);
+  decoder->viewRotations = vec_init(Vec4, NULL, NULL);
+  decoder->viewScales = vec_init(Vec3, NULL, NULL);
+  return decoder;
 }
 
-Vec3
-_ev_object_getscale(
-    GameScene scene_handle,
-    GameObject entt)
+void
+ev_replication_destroydecoder(
+    ReplicationDecoder decoder_handle)
+{
+  ReplicationDecoderData *decoder = decoder_handle;
+  for(U32 i = 0; i < EV_GAME_REPLICATION_HISTORY; i++) {
+    scenereplicationframe_fini(&decoder->history[i]);
+  }
+  indexmap_fini(&decoder->objectMap);
+  vec_fini(decoder->localObjects);
+  vec_fini(decoder->changed);
+  vec_fini(decoder->removed);
+  scenereplicationframe_fini(&decoder->scratch);
+  vec_fini(decoder->scratchChanged);
+  vec_fini(decoder->scratchRemoved);
+  vec_fini(decoder->viewPositions);
+  vec_fini(decoder->viewRotations);
+  vec_fini(decoder->viewScales);
+  free(decoder);
+}
+
+// Appends an object to a frame being decoded, starting from the baseline
+// slot's state (or the all-zero state if `base_slot` is ~0u)
+U32
+replication_appendobject(
+    SceneReplicationFrame *frame,
+    const SceneReplicationFrame *baseline,
+    U32 base_slot,
+    GameObject obj)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  const TransformComponent *comp = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  return comp->scale;
+  SceneReplicationTransform transform = base_slot != ~0u ? baseline->transforms[base_slot] : (SceneReplicationTransform){0};
+  U32 slot = (U32)vec_push((vec_t*)&frame->objects, &obj);
+  vec_push((vec_t*)&frame->transforms, &transform);
+  vec_setlen((vec_t*)&frame->components, (slot + 1) * frame->componentStride);
+  U8 *block = frame->components + slot * frame->componentStride;
+  if(base_slot != ~0u) {
+    memcpy(block, baseline->components + base_slot * frame->componentStride, frame->componentStride);
+  } else {
+    memset(block, 0, frame->componentStride);
+  }
+  return slot;
 }
 
-void
-worldtransform_update(
-    GameScene scene_handle,
-    GameObject entt)
+// Rebuilds the encoded frame from its baseline, which has to be one of the
+// decoder's previous frames. Fails on malformed packets, on packets whose
+// baseline was never received or has already been dropped, and on frames no
+// newer than the latest decoded one (late or duplicated packets). A failed
+// decode leaves the decoder as it was.
+bool
+ev_replication_decode(
+    ReplicationDecoder decoder_handle,
+    ReplicationPacket packet)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  if(!GameECS->hasTag(scene.ecs_world, entt, DirtyTransformTagID)) {
-    return;
+  ReplicationDecoderData *decoder = decoder_handle;
+  ReplicationBitReader reader = {
+    .data = packet.data,
+    .size = packet.size,
+  };
+
+  if(packet.data == NULL || replicationbits_read(&reader, 32) != EV_REPLICATION_PACKET_MAGIC) {
+    ev_log_error("Replication: invalid packet");
+    return false;
+  }
+  U32 frame_number = replicationbits_read(&reader, 32);
+  U32 baseline_number = replicationbits_read(&reader, 32);
+  if(frame_number == 0 || (baseline_number != 0 && (baseline_number >= frame_number
+          || frame_number - baseline_number >= EV_GAME_REPLICATION_HISTORY))) {
+    ev_log_error("Replication: invalid packet");
+    return false;
+  }
+  if(frame_number <= decoder->latestFrame) {
+    ev_log_warn("Replication: frame %u arrived after frame %u", frame_number, decoder->latestFrame);
+    return false;
+  }
+  const SceneReplicationFrame *baseline = NULL;
+  if(baseline_number != 0) {
+    baseline = replication_getframe(decoder->history, baseline_number);
+    if(baseline == NULL) {
+      ev_log_warn("Replication: baseline %u of frame %u is not available", baseline_number, frame_number);
+      return false;
+    }
   }
 
-  WorldTransformComponent worldTransform = {0};
+  SceneReplicationFrame *frame = &decoder->scratch;
+  frame->frame = 0;
+  vec_clear(frame->objects);
+  vec_clear(frame->transforms);
+  vec_clear(frame->components);
 
-  GameObject parent = GameECS->getParent(scene.ecs_world, entt);
-  if(parent != 0) {
-    const Matrix4x4 *parent_worldtransform = _ev_object_getworldtransform(scene_handle, parent);
-    glm_mat4_dup((vec4*)*parent_worldtransform, worldTransform);
-  } else {
-    glm_mat4_identity(worldTransform);
+  U32 type_count = replicationbits_read(&reader, 8);
+  if(type_count > EV_GAME_REPLICATION_MAX_COMPONENTS) {
+    ev_log_error("Replication: invalid packet");
+    return false;
+  }
+  vec_setlen((vec_t*)&frame->componentTypes, type_count);
+  frame->componentStride = 0;
+  for(U32 t = 0; t < type_count; t++) {
+    U64 id_low = replicationbits_read(&reader, 32);
+    U64 id_high = replicationbits_read(&reader, 32);
+    frame->componentTypes[t].id = id_low | (id_high << 32);
+    frame->componentTypes[t].size = replicationbits_read(&reader, 16);
+    frame->componentStride += 1 + frame->componentTypes[t].size;
+  }
+  if(baseline && !replication_sametypes(frame, baseline)) {
+    ev_log_error("Replication: frame %u doesn't match its baseline", frame_number);
+    return false;
+  }
+
+  U32 removed_count = replicationbits_readvarint(&reader);
+  U32 changed_count = replicationbits_readvarint(&reader);
+  if(reader.overflow || (U64)removed_count + changed_count > packet.size * 8) {
+    ev_log_error("Replication: invalid packet");
+    return false;
+  }
+
+  vec_clear(decoder->scratchRemoved);
+  GameObject previous = 0;
+  for(U32 r = 0; r < removed_count && !reader.overflow; r++) {
+    U64 gap_low = replicationbits_readvarint(&reader);
+    U64 gap_high = replicationbits_readvarint(&reader);
+    previous += gap_low | (gap_high << 32);
+    vec_push((vec_t*)&decoder->scratchRemoved, &previous);
   }
 
-  TransformComponent *transform = GameECS->getComponent(scene.ecs_world, entt, TransformComponentID);
-  glm_translate(worldTransform, (float*)&transform->position);
-  glm_quat_rotate(worldTransform, (float*)&transform->rotation, worldTransform);
-  glm_scale(worldTransform, (float*)&transform->scale);
+  // Merges the baseline, minus the removed objects, with the changed ones
+  vec_clear(decoder->scratchChanged);
+  U32 base_count = baseline ? (U32)vec_len((vec_t*)&baseline->objects) : 0;
+  U32 j = 0;
+  U32 removed_idx = 0;
+  previous = 0;
+  for(U32 c = 0; c < changed_count && !reader.overflow; c++) {
+    U64 gap_low = replicationbits_readvarint(&reader);
+    U64 gap_high = replicationbits_readvarint(&reader);
+    GameObject obj = previous + (gap_low | (gap_high << 32));
+    if(c > 0 && obj <= previous) {
+      reader.overflow = true;
+      break;
+    }
+    previous = obj;
+
+    while(j < base_count && baseline->objects[j] < obj) {
+      while(removed_idx < removed_count && decoder->scratchRemoved[removed_idx] < baseline->objects[j]) {
+        removed_idx++;
+      }
+      if(removed_idx == removed_count || decoder->scratchRemoved[removed_idx] != baseline->objects[j]) {
+        replication_appendobject(frame, baseline, j, baseline->objects[j]);
+      }
+      j++;
+    }
+    U32 base_slot = ~0u;
+    if(j < base_count && baseline->objects[j] == obj) {
+      base_slot = j++;
+    }
+    U32 slot = replication_appendobject(frame, baseline, base_slot, obj);
+    vec_push((vec_t*)&decoder->scratchChanged, &slot);
+
+    SceneReplicationTransform *tr = &frame->transforms[slot];
+    bool position_changed = replicationbits_read(&reader, 1);
+    bool rotation_changed = replicationbits_read(&reader, 1);
+    bool scale_changed = replicationbits_read(&reader, 1);
+    if(position_changed) {
+      for(U32 a = 0; a < 3; a++) {
+        tr->position[a] = replicationbits_readdelta(&reader, tr->position[a]);
+      }
+    }
+    if(rotation_changed) {
+      tr->rotation = replicationbits_read(&reader, 2 + 3 * EV_GAME_REPLICATION_ROTATION_BITS);
+    }
+    if(scale_changed) {
+      for(U32 a = 0; a < 3; a++) {
+        tr->scale[a] = replicationbits_readdelta(&reader, tr->scale[a]);
+      }
+    }
+
+    U8 *block = frame->components + slot * frame->componentStride;
+    for(U32 t = 0; t < type_count; t++) {
+      U32 size = frame->componentTypes[t].size;
+      if(replicationbits_read(&reader, 1)) {
+        block[0] = (U8)replicationbits_read(&reader, 1);
+        for(U32 b = 0; b < size && block[0]; b++) {
+          block[1 + b] = (U8)replicationbits_read(&reader, 8);
+        }
+      }
+      block += 1 + size;
+    }
+  }
+  for(; j < base_count; j++) {
+    while(removed_idx < removed_count && decoder->scratchRemoved[removed_idx] < baseline->objects[j]) {
+      removed_idx++;
+    }
+    if(removed_idx == removed_count || decoder->scratchRemoved[removed_idx] != baseline->objects[j]) {
+      replication_appendobject(frame, baseline, j, baseline->objects[j]);
+    }
+  }
 
-  GameECS->setComponent(scene.ecs_world, entt, WorldTransformComponentID, &worldTransform);
+  if(reader.overflow) {
+    ev_log_error("Replication: truncated packet for frame %u", frame_number);
+    return false;
+  }
 
-  GameECS->removeTag(scene.ecs_world, entt, DirtyTransformTagID);
+  // Commit: the scratch frame takes the history slot, whose vecs become the
+  // next scratch
+  frame->frame = frame_number;
+  SceneReplicationFrame *slot = &decoder->history[frame_number % EV_GAME_REPLICATION_HISTORY];
+  SceneReplicationFrame previous_frame = *slot;
+  *slot = *frame;
+  *frame = previous_frame;
+  vec(U32) previous_changed = decoder->changed;
+  decoder->changed = decoder->scratchChanged;
+  decoder->scratchChanged = previous_changed;
+  vec(GameObject) previous_removed = decoder->removed;
+  decoder->removed = decoder->scratchRemoved;
+  decoder->scratchRemoved = previous_removed;
+  decoder->lastFrame = frame_number;
+  decoder->latestFrame = frame_number;
+  return true;
 }
 
-const Matrix4x4 *
-_ev_object_getworldtransform(
-    GameScene scene_handle,
-    GameObject entt)
+// The frame to acknowledge to the encoding end as the next baseline
+U32
+ev_replication_getlatestframe(
+    ReplicationDecoder decoder_handle)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  worldtransform_update(scene_handle, entt);
-  return GameECS->getComponent(scene.ecs_world, entt, WorldTransformComponentID);
+  return ((ReplicationDecoderData *)decoder_handle)->latestFrame;
 }
 
-ECSGameWorldHandle
-ev_scene_getecsworld(
-    GameScene scene_handle)
+ReplicationView
+ev_replication_getview(
+    ReplicationDecoder decoder_handle)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return scene.ecs_world;
+  ReplicationDecoderData *decoder = decoder_handle;
+  ReplicationView view = {0};
+  const SceneReplicationFrame *frame = replication_getframe(decoder->history, decoder->latestFrame);
+  if(frame == NULL) {
+    return view;
+  }
+
+  U32 count = (U32)vec_len((vec_t*)&frame->objects);
+  vec_setlen((vec_t*)&decoder->viewPositions, count);
+  vec_setlen((vec_t*)&decoder->viewRotations, count);
+  vec_setlen((vec_t*)&decoder->viewScales, count);
+  for(U32 i = 0; i < count; i++) {
+    const SceneReplicationTransform *tr = &frame->transforms[i];
+    decoder->viewPositions[i] = Vec3new(
+        tr->position[0] / EV_GAME_REPLICATION_POSITION_SCALE,
+        tr->position[1] / EV_GAME_REPLICATION_POSITION_SCALE,
+        tr->position[2] / EV_GAME_REPLICATION_POSITION_SCALE);
+    decoder->viewRotations[i] = replication_unpackquat(tr->rotation);
+    decoder->viewScales[i] = Vec3new(
+        tr->scale[0] / EV_GAME_REPLICATION_POSITION_SCALE,
+        tr->scale[1] / EV_GAME_REPLICATION_POSITION_SCALE,
+        tr->scale[2] / EV_GAME_REPLICATION_POSITION_SCALE);
+  }
+
+  view.frame = frame->frame;
+  view.count = count;
+  view.objects = frame->objects;
+  view.positions = decoder->viewPositions;
+  view.rotations = decoder->viewRotations;
+  view.scales = decoder->viewScales;
+  return view;
 }
 
-PhysicsWorldHandle
-ev_scene_getphysicsworld(
-    GameScene scene_handle)
+PTR
+replication_framecomponent(
+    const SceneReplicationFrame *frame,
+    U32 slot,
+    GameComponentID comp_id)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return scene.physics_world;
+  U8 *block = frame->components + slot * frame->componentStride;
+  U32 type_count = (U32)vec_len((vec_t*)&frame->componentTypes);
+  for(U32 t = 0; t < type_count; t++) {
+    if(frame->componentTypes[t].id == comp_id) {
+      return block[0] ? block + 1 : NULL;
+    }
+    block += 1 + frame->componentTypes[t].size;
+  }
+  return NULL;
 }
 
-ScriptContextHandle
-ev_scene_getscriptcontext(
-    GameScene scene_handle)
+// Replicated component of `obj` in the latest frame, or NULL if it doesn't
+// have one
+PTR
+ev_replication_getcomponent(
+    ReplicationDecoder decoder_handle,
+    GameObject obj,
+    GameComponentID comp_id)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return scene.script_context;
+  ReplicationDecoderData *decoder = decoder_handle;
+  const SceneReplicationFrame *frame = replication_getframe(decoder->history, decoder->latestFrame);
+  if(frame == NULL) {
+    return NULL;
+  }
+  GameObject *found = bsearch(&obj, frame->objects, vec_len((vec_t*)&frame->objects), sizeof(GameObject), replication_compareobjects);
+  if(found == NULL) {
+    return NULL;
+  }
+  return replication_framecomponent(frame, (U32)(found - frame->objects), comp_id);
 }
 
+// Pairs an object of the encoding end with the one standing for it in the
+// scene that decoded changes are applied to
 void
-_ev_camera_sethfov(
-  GameScene scene_handle,
-  GameObject camera,
-  U32 hfov)
+ev_replication_mapobject(
+    ReplicationDecoder decoder_handle,
+    GameObject remote,
+    GameObject local)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  CameraComponent *comp = GameECS->getComponentMut(scene.ecs_world, camera, CameraComponentID);
-  if(comp->hfov != hfov) {
-    comp->hfov = hfov;
-    GameECS->modified(scene.ecs_world, camera, CameraComponentID);
+  ReplicationDecoderData *decoder = decoder_handle;
+  U32 slot;
+  if(indexmap_get(&decoder->objectMap, remote, &slot)) {
+    decoder->localObjects[slot] = local;
+  } else {
+    slot = (U32)vec_push((vec_t*)&decoder->localObjects, &local);
+    indexmap_set(&decoder->objectMap, remote, slot);
   }
 }
 
-void
-_ev_camera_setvfov(
-  GameScene scene_handle,
-  GameObject camera,
-  U32 vfov)
+// Applies the changes of the last decoded packet to the mapped objects of
+// `scene_handle`. Replicated components the encoding end no longer has are
+// removed, and mapped objects removed on the encoding end are destroyed.
+// Returns the number of objects touched.
+U32
+ev_replication_apply(
+    ReplicationDecoder decoder_handle,
+    GameScene scene_handle)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  CameraComponent *comp = GameECS->getComponentMut(scene.ecs_world, camera, CameraComponentID);
-  if(comp->vfov != vfov) {
-    comp->vfov = vfov;
-    GameECS->modified(scene.ecs_world, camera, CameraComponentID);
+  GET_SCENE_OR_RETURN(scene, scene_handle, 0);
+  ReplicationDecoderData *decoder = decoder_handle;
+  const SceneReplicationFrame *frame = replication_getframe(decoder->history, decoder->lastFrame);
+  if(frame == NULL) {
+    return 0;
+  }
+  U32 applied = 0;
+
+  U32 changed_count = (U32)vec_len((vec_t*)&decoder->changed);
+  U32 type_count = (U32)vec_len((vec_t*)&frame->componentTypes);
+  for(U32 c = 0; c < changed_count; c++) {
+    U32 slot = decoder->changed[c];
+    U32 local_slot;
+    if(!indexmap_get(&decoder->objectMap, frame->objects[slot], &local_slot)) {
+      continue;
+    }
+    GameObject local = decoder->localObjects[local_slot];
+    const SceneReplicationTransform *tr = &frame->transforms[slot];
+    ev_object_settransform(scene_handle, local,
+        Vec3new(
+          tr->position[0] / EV_GAME_REPLICATION_POSITION_SCALE,
+          tr->position[1] / EV_GAME_REPLICATION_POSITION_SCALE,
+          tr->position[2] / EV_GAME_REPLICATION_POSITION_SCALE),
+        replication_unpackquat(tr->rotation),
+        Vec3new(
+          tr->scale[0] / EV_GAME_REPLICATION_POSITION_SCALE,
+          tr->scale[1] / EV_GAME_REPLICATION_POSITION_SCALE,
+          tr->scale[2] / EV_GAME_REPLICATION_POSITION_SCALE));
+    for(U32 t = 0; t < type_count; t++) {
+      GameComponentID comp_id = frame->componentTypes[t].id;
+      PTR data = replication_framecomponent(frame, slot, comp_id);
+      if(data) {
+        ev_object_setcomponent(scene_handle, local, comp_id, data);
+      } else if(GameECS->hasComponent(scene->ecs_world, local, comp_id)) {
+        scenesnapshot_removecomponent(scene, local, comp_id);
+      }
+    }
+    applied++;
   }
+
+  U32 removed_count = (U32)vec_len((vec_t*)&decoder->removed);
+  for(U32 r = 0; r < removed_count; r++) {
+    U32 local_slot;
+    if(!indexmap_get(&decoder->objectMap, decoder->removed[r], &local_slot)) {
+      continue;
+    }
+    ev_scene_destroyobject(scene_handle, decoder->localObjects[local_slot]);
+    indexmap_remove(&decoder->objectMap, decoder->removed[r]);
+    applied++;
+  }
+  // Applying twice would destroy the same objects twice
+  vec_clear(decoder->changed);
+  vec_clear(decoder->removed);
+
+  return applied;
 }
 
-void
-_ev_camera_setaspectratio(
-  GameScene scene_handle,
-  GameObject camera,
-  F32 aspectRatio)
+bool
+replication_sameframe(
+    const SceneReplicationFrame *a,
+    const SceneReplicationFrame *b)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  CameraComponent *comp = GameECS->getComponentMut(scene.ecs_world, camera, CameraComponentID);
-  if(comp->aspectRatio != aspectRatio) {
-    comp->aspectRatio = aspectRatio;
-    GameECS->modified(scene.ecs_world, camera, CameraComponentID);
+  if(a == NULL || b == NULL || !replication_sametypes(a, b) || a->componentStride != b->componentStride) {
+    return false;
   }
+  U32 count = (U32)vec_len((vec_t*)&a->objects);
+  return count == vec_len((vec_t*)&b->objects)
+    && !memcmp(a->objects, b->objects, count * sizeof(GameObject))
+    && !memcmp(a->transforms, b->transforms, count * sizeof(SceneReplicationTransform))
+    && !memcmp(a->components, b->components, (size_t)count * a->componentStride);
 }
 
-void
-_ev_camera_setnearplane(
-  GameScene scene_handle,
-  GameObject camera,
-  F32 nearPlane)
+// Runs `frameCount` frames of synthetic motion on a scene of its own with
+// `objectCount` objects: each frame, half of the objects move and one in
+// eight turns. Every frame is captured, encoded against the previous one,
+// decoded and checked against the capture. The scene and decoder are
+// destroyed before returning, so no live scene is touched.
+ReplicationBenchmark
+ev_replication_benchmark(
+    U32 objectCount,
+    U32 frameCount)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  CameraComponent *comp = GameECS->getComponentMut(scene.ecs_world, camera, CameraComponentID);
-  if(comp->nearPlane != nearPlane) {
-    comp->nearPlane = nearPlane;
-    GameECS->modified(scene.ecs_world, camera, CameraComponentID);
+  ReplicationBenchmark benchmark = {0};
+  GameScene scene_handle = ev_scene_create();
+  GET_SCENE_OR_RETURN(scene, scene_handle, benchmark);
+  ev_scene_createobjects(scene_handle, 0, objectCount, NULL);
+  ReplicationDecoder decoder_handle = ev_replication_createdecoder();
+  ReplicationDecoderData *decoder = decoder_handle;
+  SceneReplicationData *replication = &scene->replication;
+
+  U32 baseline = 0;
+  for(U32 f = 1; f <= frameCount; f++) {
+    for(U32 i = 0; i < objectCount; i++) {
+      if((i + f) % 2) {
+        continue;
+      }
+      F32 t = (F32)f * 0.05f + (F32)i;
+      F32 angle = (i % 8 == 0) ? t : 0.f;
+      ev_object_settransform(scene_handle, scene->objects[i],
+          Vec3new(cosf(t) * 10.f, (F32)(i % 16), sinf(t) * 10.f),
+          (Vec4){ .x = 0.f, .y = sinf(angle * 0.5f), .z = 0.f, .w = cosf(angle * 0.5f) },
+          Vec3new(1.f, 1.f, 1.f));
+    }
+    U32 frame_number = ev_replication_capture(scene_handle);
+
+    F64 start = ev_game_gettimems();
+    ReplicationPacket packet = ev_replication_encode(scene_handle, frame_number, baseline);
+    F64 encoded = ev_game_gettimems();
+    bool decoded = ev_replication_decode(decoder_handle, packet);
+    F64 end = ev_game_gettimems();
+    benchmark.encodeMs += (F32)(encoded - start);
+    benchmark.decodeMs += (F32)(end - encoded);
+    benchmark.deltaBytes += packet.size;
+    ev_replication_freepacket(packet);
+
+    const SceneReplicationFrame *captured = replication_getframe(replication->history, frame_number);
+    const SceneReplicationFrame *received = decoded ? replication_getframe(decoder->history, frame_number) : NULL;
+    if(!replication_sameframe(captured, received)) {
+      ev_log_error("Replication: frame %u didn't decode back to its capture", frame_number);
+      benchmark.mismatches++;
+    }
+    benchmark.frames++;
+    baseline = frame_number;
+  }
+
+  if(baseline != 0) {
+    ReplicationPacket full = ev_replication_encode(scene_handle, baseline, 0);
+    benchmark.fullBytes = full.size;
+    ev_replication_freepacket(full);
   }
+
+  ev_replication_destroydecoder(decoder_handle);
+  ev_scene_destroy(scene_handle);
+  return benchmark;
 }
 
+// Hands render objects to the renderer, or holds on to them until the end of
+// the frame if the scene batches its draws.
 void
-_ev_camera_setfarplane(
-  GameScene scene_handle,
-  GameObject camera,
-  F32 farPlane)
+renderbatch_push(
+    GameSceneStruct *scene,
+    RenderComponent *renderComponents,
+    WorldTransformComponent *worldTransforms,
+    U32 count)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  CameraComponent *comp = GameECS->getComponentMut(scene.ecs_world, camera, CameraComponentID);
-  if(comp->farPlane != farPlane) {
-    comp->farPlane = farPlane;
-    GameECS->modified(scene.ecs_world, camera, CameraComponentID);
+  if(!scene->batching.enabled) {
+    Renderer->addFrameObjectData(renderComponents, worldTransforms, count);
+    return;
   }
+
+  size_t len = vec_len((vec_t*)&RenderingData.frameRenderComponents);
+  vec_setlen((vec_t*)&RenderingData.frameRenderComponents, len + count);
+  vec_setlen((vec_t*)&RenderingData.frameWorldTransforms, len + count);
+  memcpy(RenderingData.frameRenderComponents + len, renderComponents, count * sizeof(RenderComponent));
+  memcpy(RenderingData.frameWorldTransforms + len, worldTransforms, count * sizeof(WorldTransformComponent));
 }
 
-void
-_ev_camera_getviewmat(
-  GameScene scene_handle,
-  GameObject camera,
-  Matrix4x4 outViewMat)
+// Objects can be drawn as instances of one batch when they share their mesh
+// and material (which selects the pipeline). Only the handles are looked at:
+// the component's raw bytes include padding, which isn't guaranteed to match.
+U64
+renderbatch_key(
+    const RenderComponent *comp)
 {
-  camera = camera?camera:GameData.scenes[scene_handle?scene_handle:GameData.activeScene].activeCamera;
-  const Matrix4x4 *transform = _ev_object_getworldtransform(scene_handle, camera);
-  glm_mat4_inv((vec4*)*transform, outViewMat);
+  U64 handles[2] = { (U64)comp->mesh, (U64)comp->material };
+  U64 key = 14695981039346656037ULL;
+  for(U32 h = 0; h < 2; h++) {
+    for(U32 b = 0; b < 64; b += 8) {
+      key ^= (handles[h] >> b) & 0xFF;
+      key *= 1099511628211ULL;
+    }
+  }
+  return key;
 }
 
-void
-_ev_camera_getprojectionmat(
-  GameScene scene_handle,
-  GameObject camera,
-  Matrix4x4 outProjMat)
+bool
+renderbatch_samekey(
+    const RenderComponent *a,
+    const RenderComponent *b)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  camera = camera?camera:scene.activeCamera;
-  const CameraComponent *comp = GameECS->getComponent(scene.ecs_world, camera, CameraComponentID);
-  glm_mat4_dup((vec4*)comp->projectionMatrix, outProjMat);
+  return a->mesh == b->mesh && a->material == b->material;
 }
 
+// Groups the frame's render objects by mesh and material with a counting
+// sort and pushes each group as one contiguous instance batch.
 void
-_ev_object_setworldtransform(
-    GameScene scene_handle,
-    GameObject entt,
-    Matrix4x4 new_transform)
+renderbatch_flush(
+    GameSceneStruct *scene)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  WorldTransformComponent *world_transform = GameECS->getComponentMut(scene.ecs_world, entt, WorldTransformComponentID);
-  glm_mat4_copy(new_transform, *world_transform);
-  GameECS->modified(scene.ecs_world, entt, WorldTransformComponentID);
+  U32 count = (U32)vec_len((vec_t*)&RenderingData.frameRenderComponents);
+  RenderComponent *renderComponents = RenderingData.frameRenderComponents;
+  WorldTransformComponent *worldTransforms = RenderingData.frameWorldTransforms;
+  scene->batching.frame.objectCount = count;
+
+  // Bucket ids, keyed by a hash of the component's handles. Collisions are
+  // told apart with a compare and moved to the next key.
+  indexmap_clear(&RenderingData.bucketSlots);
+  vec_clear(RenderingData.bucketKeys);
+  vec_clear(RenderingData.bucketOffsets);
+  vec_setlen((vec_t*)&RenderingData.objectBuckets, count);
+  for(U32 i = 0; i < count; i++) {
+    U64 key = renderbatch_key(&renderComponents[i]);
+
+    U32 bucket;
+    for(;; key++) {
+      key = key ? key : 1;
+      if(!indexmap_get(&RenderingData.bucketSlots, key, &bucket)) {
+        bucket = (U32)vec_push((vec_t*)&RenderingData.bucketKeys, &renderComponents[i]);
+        U32 zero = 0;
+        vec_push((vec_t*)&RenderingData.bucketOffsets, &zero);
+        indexmap_set(&RenderingData.bucketSlots, key, bucket);
+        break;
+      }
+      if(renderbatch_samekey(&RenderingData.bucketKeys[bucket], &renderComponents[i])) {
+        break;
+      }
+    }
+    RenderingData.objectBuckets[i] = bucket;
+    RenderingData.bucketOffsets[bucket]++;
+  }
 
-  GameECS->forEachChild(scene.ecs_world, entt, transform_setdirty);
-}
+  U32 bucketCount = (U32)vec_len((vec_t*)&RenderingData.bucketKeys);
+  U32 offset = 0;
+  for(U32 b = 0; b < bucketCount; b++) {
+    U32 bucketSize = RenderingData.bucketOffsets[b];
+    if(bucketSize > scene->batching.frame.largestBatch) {
+      scene->batching.frame.largestBatch = bucketSize;
+    }
+    RenderingData.bucketOffsets[b] = offset;
+    offset += bucketSize;
+  }
 
-const PTR
-ev_object_getcomponent(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id)
-{
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  return GameECS->getComponent(ecs_world, entt, comp_id);
-}
+  // Scatter; bucket offsets end up at the end of each bucket
+  vec_setlen((vec_t*)&RenderingData.sortedRenderComponents, count);
+  vec_setlen((vec_t*)&RenderingData.sortedWorldTransforms, count);
+  for(U32 i = 0; i < count; i++) {
+    U32 dst = RenderingData.bucketOffsets[RenderingData.objectBuckets[i]]++;
+    RenderingData.sortedRenderComponents[dst] = renderComponents[i];
+    memcpy(RenderingData.sortedWorldTransforms[dst], worldTransforms[i], sizeof(WorldTransformComponent));
+  }
 
-PTR
-ev_object_getcomponentmut(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id)
-{
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  return GameECS->getComponentMut(ecs_world, entt, comp_id);
-}
+  U32 first = 0;
+  for(U32 b = 0; b < bucketCount; b++) {
+    U32 end = RenderingData.bucketOffsets[b];
+    Renderer->addFrameObjectData(RenderingData.sortedRenderComponents + first, RenderingData.sortedWorldTransforms + first, end - first);
+    first = end;
+  }
+  scene->batching.frame.batchCount = bucketCount;
 
-bool
-ev_object_hascomponent(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id)
-{
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  return GameECS->hasComponent(ecs_world, entt, comp_id);
+  vec_clear(RenderingData.frameRenderComponents);
+  vec_clear(RenderingData.frameWorldTransforms);
 }
 
+// Objects without bounds can't be culled and are always pushed
 void
-ev_object_addcomponent(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id)
+RendererPushObjectFrameData(
+    ECSQuery query)
 {
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  GameECS->addComponent(ecs_world, entt, comp_id);
+  WorldTransformComponent *worldTransforms = ECS->getQueryColumn(query, sizeof(WorldTransformComponent), 1);
+  RenderComponent *renderComponents = ECS->getQueryColumn(query, sizeof(RenderComponent), 2);
+  U32 count = ECS->getQueryMatchCount(query);
+
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  renderbatch_push(scene, renderComponents, worldTransforms, count);
+  scene->culling.frame.unboundedObjects += count;
 }
 
-void
-ev_object_addtag(
-    GameScene scene_handle,
-    GameObject entt,
-    GameTagID tag_id)
+// Returns the active camera's frustum planes for this frame, or NULL if
+// there is nothing to cull against.
+const vec4 *
+sceneculling_getfrustum(
+    GameSceneStruct *scene)
 {
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  GameECS->addTag(ecs_world, entt, tag_id);
+  SceneCullingData *culling = &scene->culling;
+  if(culling->frustumChecked) {
+    return culling->frustumValid ? (const vec4 *)culling->planes : NULL;
+  }
+  culling->frustumChecked = true;
+  culling->frustumValid = false;
+
+  GameObject camera = scene->activeCamera;
+  if(!culling->enabled || camera == 0 || !GameECS->hasComponent(scene->ecs_world, camera, CameraComponentID)) {
+    return NULL;
+  }
+
+  const CameraComponent *cameraComp = GameECS->getComponent(scene->ecs_world, camera, CameraComponentID);
+  // The camera's world transform is only brought up to date on demand
+  const Matrix4x4 *cameraTransform = _ev_object_getworldtransform(scene_gethandle(scene), camera);
+  Matrix4x4 view, viewProjection;
+  glm_mat4_inv((vec4*)*cameraTransform, view);
+  glm_mat4_mul((vec4*)cameraComp->projectionMatrix, view, viewProjection);
+  glm_frustum_planes(viewProjection, culling->planes);
+
+  culling->frustumValid = true;
+  return (const vec4 *)culling->planes;
 }
 
+// Pushes the baked render objects, culled against the frustum when they
+// have bounds.
 void
-ev_object_setcomponent(
-    GameScene scene_handle,
-    GameObject entt,
-    GameComponentID comp_id,
-    PTR data)
+scenestatic_push(
+    GameSceneStruct *scene)
 {
-  ECSGameWorldHandle ecs_world = ev_scene_getecsworld(scene_handle);
-  GameECS->setComponent(ecs_world, entt, comp_id, data);
+  SceneStaticData *statics = &scene->statics;
+  U32 count = (U32)vec_len((vec_t*)&statics->objects);
+  if(count == 0) {
+    return;
+  }
+
+  const vec4 *planes = sceneculling_getfrustum(scene);
+  if(planes == NULL) {
+    renderbatch_push(scene, statics->renderComponents, statics->worldTransforms, count);
+    scene->culling.frame.visibleObjects += count;
+    return;
+  }
+
+  vec_setlen((vec_t*)&RenderingData.cullVisible, count);
+  U8 *visible = RenderingData.cullVisible;
+  memset(visible, 1, count);
+  for(U32 p = 0; p < 6; p++) {
+    for(U32 i = 0; i < count; i++) {
+      Vec4 sphere = statics->spheres[i];
+      visible[i] &= sphere.w < 0.f
+        || (planes[p][0] * sphere.x + planes[p][1] * sphere.y + planes[p][2] * sphere.z + planes[p][3]) >= -sphere.w;
+    }
+  }
+
+  vec_setlen((vec_t*)&RenderingData.visibleRenderComponents, count);
+  vec_setlen((vec_t*)&RenderingData.visibleWorldTransforms, count);
+  U32 visibleCount = 0;
+  for(U32 i = 0; i < count; i++) {
+    if(visible[i]) {
+      RenderingData.visibleRenderComponents[visibleCount] = statics->renderComponents[i];
+      memcpy(RenderingData.visibleWorldTransforms[visibleCount], statics->worldTransforms[i], sizeof(WorldTransformComponent));
+      visibleCount++;
+    }
+  }
+  scene->culling.frame.visibleObjects += visibleCount;
+  scene->culling.frame.culledObjects += count - visibleCount;
+  if(visibleCount > 0) {
+    renderbatch_push(scene, RenderingData.visibleRenderComponents, RenderingData.visibleWorldTransforms, visibleCount);
+  }
 }
 
-void
-CameraComponentOnAddTrigger(ECSQuery query)
+F32
+animation_ease(
+    AnimationEasing easing,
+    F32 u)
 {
-  CameraComponent *cameraComp = ECS->getQueryColumn(query, sizeof(CameraComponent), 1);
-  glm_mat4_identity(cameraComp->projectionMatrix);
+  switch(easing) {
+    case EV_ANIMATION_EASING_EASEIN:
+      return u * u;
+    case EV_ANIMATION_EASING_EASEOUT:
+      return u * (2.f - u);
+    case EV_ANIMATION_EASING_EASEINOUT:
+      return u * u * (3.f - 2.f * u);
+    case EV_ANIMATION_EASING_STEP:
+      return 0.f;
+    default:
+      return u;
+  }
 }
 
+// Advances every playing track and writes the sampled pose straight into its
+// TransformComponent. Playheads and segments are resolved for the whole batch
+// first so that the blending loop runs without branching on the wrap mode.
 void
-CameraComponentOnSetTrigger(ECSQuery query)
+AnimationEvaluate(
+    ECSQuery query)
 {
-  CameraComponent *cameraComp = ECS->getQueryColumn(query, sizeof(CameraComponent), 1);
+  TransformComponent *transforms = ECS->getQueryColumn(query, sizeof(TransformComponent), 1);
+  AnimationComponent *animations = ECS->getQueryColumn(query, sizeof(AnimationComponent), 2);
+  ECSEntityID *entities = ECS->getQueryEntities(query);
   U32 count = ECS->getQueryMatchCount(query);
 
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  F32 deltaTime = GameData.deltaTime;
+
+  vec_setlen((vec_t*)&AnimationData.segments, count);
+  vec_setlen((vec_t*)&AnimationData.weights, count);
+  vec_setlen((vec_t*)&AnimationData.evaluated, count);
+  U32 *segments = AnimationData.segments;
+  F32 *weights = AnimationData.weights;
+  U8 *evaluated = AnimationData.evaluated;
+
   for(U32 i = 0; i < count; i++) {
-    if(cameraComp[i].viewType == EV_CAMERA_VIEWTYPE_PERSPECTIVE) {
-      glm_perspective(glm_rad(cameraComp[i].hfov), cameraComp[i].aspectRatio, cameraComp[i].nearPlane, cameraComp[i].farPlane, cameraComp[i].projectionMatrix);
+    AnimationComponent *anim = &animations[i];
+    // A track that just ran out still writes its last pose
+    evaluated[i] = anim->playing;
+    segments[i] = 0;
+    weights[i] = 0.f;
+    if(!anim->playing) {
+      continue;
+    }
 
-      //Complience with vulkan coordinate system
-      cameraComp[i].projectionMatrix[1][1] *= -1;
-      
-    } else if (cameraComp[i].viewType == EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC){
-      assert(!"Unimplemented: Orthographic Camera");
+    F32 start = anim->keys[0].time;
+    F32 end = anim->keys[anim->keyCount - 1].time;
+    F32 length = end - start;
+    F32 t = anim->time + deltaTime * anim->speed;
+
+    if(length <= 0.f) {
+      t = start;
+    } else if(anim->wrap == EV_ANIMATION_WRAP_LOOP) {
+      t = fmodf(t - start, length);
+      t = start + (t < 0.f ? t + length : t);
+    } else if(anim->wrap == EV_ANIMATION_WRAP_PINGPONG) {
+      // The playhead runs over twice the length and is mirrored on the way back
+      F32 p = fmodf(t - start, 2.f * length);
+      p = p < 0.f ? p + 2.f * length : p;
+      anim->time = start + p;
+      t = start + (p > length ? 2.f * length - p : p);
     } else {
-      ev_log_error("Invalid camera view type. Choose one from: (EV_CAMERA_VIEWTYPE_PERSPECTIVE, EV_CAMERA_VIEWTYPE_ORTHOGRAPHIC)");
-      assert(false);
+      if((anim->speed >= 0.f && t >= end) || (anim->speed < 0.f && t <= start)) {
+        anim->playing = false;
+      }
+      t = glm_clamp(t, start, end);
+    }
+    if(anim->wrap != EV_ANIMATION_WRAP_PINGPONG || length <= 0.f) {
+      anim->time = t;
+    }
+
+    U32 k = 0;
+    while(k + 2 < anim->keyCount && t >= anim->keys[k + 1].time) {
+      k++;
+    }
+    segments[i] = k;
+    if(k + 1 < anim->keyCount) {
+      F32 span = anim->keys[k + 1].time - anim->keys[k].time;
+      F32 u = glm_clamp((t - anim->keys[k].time) / span, 0.f, 1.f);
+      weights[i] = animation_ease(anim->easing, u);
     }
   }
-}
-
-GameObject
-ev_scene_createobject(
-    GameScene scene_handle)
-{
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  GameObject object = GameECS->createEntity(scene.ecs_world);
 
-  ev_object_settransform(scene_handle, object,
-    Vec3new(0, 0, 0),     // Position
-    Vec4new(0, 0, 0, 1),  // Rotation
-    Vec3new(1, 1, 1)      // Scale
-  );
+  for(U32 i = 0; i < count; i++) {
+    if(!evaluated[i]) {
+      continue;
+    }
+    const AnimationComponent *anim = &animations[i];
+    U32 k = segments[i];
+    const AnimationKey *a = &anim->keys[k];
+    const AnimationKey *b = &anim->keys[k + 1 < anim->keyCount ? k + 1 : k];
+    F32 w = weights[i];
+    TransformComponent *tr = &transforms[i];
+
+    if(anim->channels & EV_ANIMATION_CHANNEL_POSITION) {
+      tr->position.x = a->position.x + (b->position.x - a->position.x) * w;
+      tr->position.y = a->position.y + (b->position.y - a->position.y) * w;
+      tr->position.z = a->position.z + (b->position.z - a->position.z) * w;
+    }
+    if(anim->channels & EV_ANIMATION_CHANNEL_ROTATION) {
+      // Normalized lerp along the shorter arc. Keys are close enough together
+      // for it to be indistinguishable from a slerp.
+      F32 d = a->rotation.x * b->rotation.x + a->rotation.y * b->rotation.y + a->rotation.z * b->rotation.z + a->rotation.w * b->rotation.w;
+      F32 wb = d < 0.f ? -w : w;
+      F32 wa = 1.f - w;
+      Vec4 q = {
+        .x = a->rotation.x * wa + b->rotation.x * wb,
+        .y = a->rotation.y * wa + b->rotation.y * wb,
+        .z = a->rotation.z * wa + b->rotation.z * wb,
+        .w = a->rotation.w * wa + b->rotation.w * wb,
+      };
+      glm_quat_normalize((float*)&q);
+      tr->rotation = q;
+    }
+    if(anim->channels & EV_ANIMATION_CHANNEL_SCALE) {
+      tr->scale.x = a->scale.x + (b->scale.x - a->scale.x) * w;
+      tr->scale.y = a->scale.y + (b->scale.y - a->scale.y) * w;
+      tr->scale.z = a->scale.z + (b->scale.z - a->scale.z) * w;
+    }
 
-  return object;
+    transform_setdirty(scene->ecs_world, entities[i]);
+    sceneobjects_syncrigidbody(GameData.activeScene, entities[i], tr,
+        anim->channels & EV_ANIMATION_CHANNEL_POSITION,
+        anim->channels & EV_ANIMATION_CHANNEL_ROTATION);
+  }
 }
 
-GameObject
-ev_scene_createchildobject(
-    GameScene scene_handle,
-    GameObject parent)
+// Picks the detail level of every LOD object by its distance to the active
+// camera and swaps the matching variant into its RenderComponent, ahead of
+// the push systems.
+void
+RendererSelectLOD(
+    ECSQuery query)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  GameObject object = GameECS->createChildEntity(scene.ecs_world, parent);
+  WorldTransformComponent *worldTransforms = ECS->getQueryColumn(query, sizeof(WorldTransformComponent), 1);
+  RenderComponent *renderComponents = ECS->getQueryColumn(query, sizeof(RenderComponent), 2);
+  LODComponent *lods = ECS->getQueryColumn(query, sizeof(LODComponent), 3);
+  U32 count = ECS->getQueryMatchCount(query);
 
-  ev_object_settransform(scene_handle, object,
-    Vec3new(0, 0, 0),     // Position
-    Vec4new(0, 0, 0, 1),  // Rotation
-    Vec3new(1, 1, 1)      // Scale
-  );
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  GameObject camera = scene->activeCamera;
+  if(camera == 0) {
+    return;
+  }
+  const Matrix4x4 *cameraTransform = _ev_object_getworldtransform(scene_gethandle(scene), camera);
+  if(cameraTransform == NULL) {
+    return;
+  }
+  F32 cx = (*cameraTransform)[3][0];
+  F32 cy = (*cameraTransform)[3][1];
+  F32 cz = (*cameraTransform)[3][2];
 
-  return object;
-}
+  // Squared distances first, in a loop of its own so that it vectorizes
+  vec_setlen((vec_t*)&RenderingData.lodDistances, count);
+  F32 *dist2 = RenderingData.lodDistances;
+  for(U32 i = 0; i < count; i++) {
+    F32 dx = worldTransforms[i][3][0] - cx;
+    F32 dy = worldTransforms[i][3][1] - cy;
+    F32 dz = worldTransforms[i][3][2] - cz;
+    dist2[i] = dx * dx + dy * dy + dz * dz;
+  }
 
-void
-ev_scene_addchildtoobject(
-    GameScene scene_handle,
-    GameObject parent,
-    GameObject child)
-{
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  GameECS->addChildToEntity(scene.ecs_world, parent, child);
+  for(U32 i = 0; i < count; i++) {
+    LODComponent *lod = &lods[i];
+    U32 level = lod->currentLevel < lod->levelCount ? lod->currentLevel : 0;
+    F32 out_scale = (1.f + lod->hysteresis) * (1.f + lod->hysteresis);
+    F32 in_scale = (1.f - lod->hysteresis) * (1.f - lod->hysteresis);
+
+    // Coarser only once past the switch distance by the hysteresis margin,
+    // finer only once back inside it by the same margin
+    while(level + 1 < lod->levelCount && dist2[i] > lod->switchDistances[level] * lod->switchDistances[level] * out_scale) {
+      level++;
+    }
+    while(level > 0 && dist2[i] < lod->switchDistances[level - 1] * lod->switchDistances[level - 1] * in_scale) {
+      level--;
+    }
+
+    if(level != lod->currentLevel) {
+      lod->currentLevel = level;
+      renderComponents[i] = lod->levels[level];
+    }
+  }
 }
 
 void
-ev_scene_destroyobject(
-    GameScene scene_handle,
-    GameObject object)
+RendererPushCulledObjectFrameData(
+    ECSQuery query)
 {
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  GameECS->destroyEntity(scene.ecs_world, object);
-}
+  WorldTransformComponent *worldTransforms = ECS->getQueryColumn(query, sizeof(WorldTransformComponent), 1);
+  RenderComponent *renderComponents = ECS->getQueryColumn(query, sizeof(RenderComponent), 2);
+  BoundsComponent *bounds = ECS->getQueryColumn(query, sizeof(BoundsComponent), 3);
+  U32 count = ECS->getQueryMatchCount(query);
 
-GameObject
-ev_scene_getactivecamera(
-    GameScene scene_handle)
-{
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  return scene.activeCamera;
-}
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  const vec4 *planes = sceneculling_getfrustum(scene);
+  if(planes == NULL) {
+    renderbatch_push(scene, renderComponents, worldTransforms, count);
+    scene->culling.frame.visibleObjects += count;
+    return;
+  }
 
-void
-ev_scene_setactivecamera(
-    GameScene scene_handle,
-    GameObject camera)
-{
-  GameData.scenes[scene_handle?scene_handle:GameData.activeScene].activeCamera = camera;
-}
+  // World-space bounding spheres, as separate arrays so that the plane tests
+  // below vectorize.
+  vec_setlen((vec_t*)&RenderingData.cullSpheres, count * 4);
+  F32 *xs = RenderingData.cullSpheres;
+  F32 *ys = xs + count;
+  F32 *zs = ys + count;
+  F32 *rs = zs + count;
+  for(U32 i = 0; i < count; i++) {
+    vec4 *m = (vec4 *)worldTransforms[i];
+    Vec3 c = bounds[i].center;
+    Vec3 e = bounds[i].extents;
+    xs[i] = m[0][0] * c.x + m[1][0] * c.y + m[2][0] * c.z + m[3][0];
+    ys[i] = m[0][1] * c.x + m[1][1] * c.y + m[2][1] * c.z + m[3][1];
+    zs[i] = m[0][2] * c.x + m[1][2] * c.y + m[2][2] * c.z + m[3][2];
+
+    // Scaled by the largest axis scale so the sphere still encloses the box
+    F32 sx = m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2];
+    F32 sy = m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2];
+    F32 sz = m[2][0] * m[2][0] + m[2][1] * m[2][1] + m[2][2] * m[2][2];
+    F32 s = sx > sy ? (sx > sz ? sx : sz) : (sy > sz ? sy : sz);
+    rs[i] = sqrtf(s * (e.x * e.x + e.y * e.y + e.z * e.z));
+  }
 
-GameObject
-ev_scene_createcamera(
-    GameScene scene_handle,
-    CameraViewType type)
-{
-  GameSceneStruct scene = GameData.scenes[scene_handle?scene_handle:GameData.activeScene];
-  GameObject camera = ev_scene_createobject(scene_handle);
-  GameECS->setComponent(scene.ecs_world, camera, CameraComponentID, &(CameraComponent) {
-      .viewType = type,
-  });
+  vec_setlen((vec_t*)&RenderingData.cullVisible, count);
+  U8 *visible = RenderingData.cullVisible;
+  memset(visible, 1, count);
+  for(U32 p = 0; p < 6; p++) {
+    F32 nx = planes[p][0];
+    F32 ny = planes[p][1];
+    F32 nz = planes[p][2];
+    F32 d = planes[p][3];
+    for(U32 i = 0; i < count; i++) {
+      visible[i] &= (nx * xs[i] + ny * ys[i] + nz * zs[i] + d) >= -rs[i];
+    }
+  }
 
-  if(scene.activeCamera == 0) {
-    GameData.scenes[scene_handle?scene_handle:GameData.activeScene].activeCamera = camera;
+  U32 visibleCount = 0;
+  for(U32 i = 0; i < count; i++) {
+    visibleCount += visible[i];
   }
+  scene->culling.frame.visibleObjects += visibleCount;
+  scene->culling.frame.culledObjects += count - visibleCount;
 
-  return camera;
+  if(visibleCount == count) {
+    renderbatch_push(scene, renderComponents, worldTransforms, count);
+    return;
+  }
+  if(visibleCount == 0) {
+    return;
+  }
+
+  vec_setlen((vec_t*)&RenderingData.visibleRenderComponents, visibleCount);
+  vec_setlen((vec_t*)&RenderingData.visibleWorldTransforms, visibleCount);
+  U32 out = 0;
+  for(U32 i = 0; i < count; i++) {
+    if(visible[i]) {
+      RenderingData.visibleRenderComponents[out] = renderComponents[i];
+      memcpy(RenderingData.visibleWorldTransforms[out], worldTransforms[i], sizeof(WorldTransformComponent));
+      out++;
+    }
+  }
+  renderbatch_push(scene, RenderingData.visibleRenderComponents, RenderingData.visibleWorldTransforms, visibleCount);
 }
 
+// Lights without a range can't be culled and are always pushed
 void
-RendererPushObjectFrameData(
+RendererPushLightFrameData(
     ECSQuery query)
 {
   WorldTransformComponent *worldTransforms = ECS->getQueryColumn(query, sizeof(WorldTransformComponent), 1);
-  RenderComponent *renderComponents = ECS->getQueryColumn(query, sizeof(RenderComponent), 2);
+  LightComponent *lightComponents = ECS->getQueryColumn(query, sizeof(LightComponent), 2);
   U32 count = ECS->getQueryMatchCount(query);
 
-  Renderer->addFrameObjectData(renderComponents, worldTransforms, count);
+  Light->addFrameLightData(lightComponents, worldTransforms, count);
+
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneLightData *lights = &scene->lights;
+  lights->pushedLights += count;
+  lights->frame.unboundedLights += count;
 }
 
 void
-RendererPushLightFrameData(
+RendererPushCulledLightFrameData(
     ECSQuery query)
 {
   WorldTransformComponent *worldTransforms = ECS->getQueryColumn(query, sizeof(WorldTransformComponent), 1);
   LightComponent *lightComponents = ECS->getQueryColumn(query, sizeof(LightComponent), 2);
+  LightRangeComponent *ranges = ECS->getQueryColumn(query, sizeof(LightRangeComponent), 3);
   U32 count = ECS->getQueryMatchCount(query);
 
-  Light->addFrameLightData(lightComponents, worldTransforms, count);
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneLightData *lights = &scene->lights;
+  const vec4 *planes = sceneculling_getfrustum(scene);
+
+  vec_setlen((vec_t*)&RenderingData.cullVisible, count);
+  U8 *visible = RenderingData.cullVisible;
+  memset(visible, 1, count);
+  if(planes) {
+    // Same plane test as render objects, with the light's influence sphere
+    vec_setlen((vec_t*)&RenderingData.cullSpheres, count * 4);
+    F32 *xs = RenderingData.cullSpheres;
+    F32 *ys = xs + count;
+    F32 *zs = ys + count;
+    F32 *rs = zs + count;
+    for(U32 i = 0; i < count; i++) {
+      xs[i] = worldTransforms[i][3][0];
+      ys[i] = worldTransforms[i][3][1];
+      zs[i] = worldTransforms[i][3][2];
+      rs[i] = ranges[i].radius;
+    }
+    for(U32 p = 0; p < 6; p++) {
+      F32 nx = planes[p][0];
+      F32 ny = planes[p][1];
+      F32 nz = planes[p][2];
+      F32 d = planes[p][3];
+      for(U32 i = 0; i < count; i++) {
+        visible[i] &= (nx * xs[i] + ny * ys[i] + nz * zs[i] + d) >= -rs[i];
+      }
+    }
+  }
+
+  vec_setlen((vec_t*)&RenderingData.visibleLightComponents, count);
+  vec_setlen((vec_t*)&RenderingData.visibleWorldTransforms, count);
+  U32 visibleCount = 0;
+  for(U32 i = 0; i < count; i++) {
+    if(!visible[i]) {
+      continue;
+    }
+    RenderingData.visibleLightComponents[visibleCount] = lightComponents[i];
+    memcpy(RenderingData.visibleWorldTransforms[visibleCount], worldTransforms[i], sizeof(WorldTransformComponent));
+
+    U32 lightIndex = lights->pushedLights + visibleCount;
+    Vec4 sphere = { worldTransforms[i][3][0], worldTransforms[i][3][1], worldTransforms[i][3][2], ranges[i].radius };
+    vec_push((vec_t*)&lights->frameIndices, &lightIndex);
+    vec_push((vec_t*)&lights->frameSpheres, &sphere);
+    visibleCount++;
+  }
+
+  if(visibleCount > 0) {
+    Light->addFrameLightData(RenderingData.visibleLightComponents, RenderingData.visibleWorldTransforms, visibleCount);
+  }
+  lights->pushedLights += visibleCount;
+  lights->frame.visibleLights += visibleCount;
+  lights->frame.culledLights += count - visibleCount;
 }
 
 void
@@ -1143,20 +8101,31 @@ EV_CONSTRUCTOR
       TransformComponentID = GameECS->registerComponent(TransformComponentName, sizeof(TransformComponent), EV_ALIGNOF(TransformComponent));
       WorldTransformComponentID = GameECS->registerComponent(WorldTransformComponentName, sizeof(WorldTransformComponent), EV_ALIGNOF(WorldTransformComponent));
       DirtyTransformTagID = GameECS->registerTag(DirtyTransformTagName);
+      StaticTransformTagID = GameECS->registerTag(StaticTransformTagName);
+      InactiveTagID = GameECS->registerTag(InactiveTagName);
+      InactiveSelfTagID = GameECS->registerTag(InactiveSelfTagName);
 
       CameraComponentID = GameECS->registerComponent(CameraComponentName, sizeof(CameraComponent), EV_ALIGNOF(CameraComponent));
+      BoundsComponentID = GameECS->registerComponent(BoundsComponentName, sizeof(BoundsComponent), EV_ALIGNOF(BoundsComponent));
+      AnimationComponentID = GameECS->registerComponent(AnimationComponentName, sizeof(AnimationComponent), EV_ALIGNOF(AnimationComponent));
+      GameECS->registerSystem("[out]TransformComponent,AnimationComponent,!StaticTransform,!Inactive", EV_ECS_PIPELINE_STAGE_UPDATE, AnimationEvaluate, "AnimationEvaluate");
 
       GameECS->setOnAddTrigger("CameraComponentOnAddTrigger", CameraComponentName, CameraComponentOnAddTrigger);
       GameECS->setOnSetTrigger("CameraComponentOnSetTrigger", CameraComponentName, CameraComponentOnSetTrigger);
 
       // Rendering ECS
       RenderingData.RenderingComponentID = GameECS->registerComponent("RenderComponent", sizeof(RenderComponent), EV_ALIGNOF(RenderComponent));
-      GameECS->registerSystem("[out]WorldTransformComponent,RenderComponent || LightComponent", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererObjectUpdateTransforms, "RendererObjectUpdateTransforms");
-      GameECS->registerSystem("[in]WorldTransformComponent,RenderComponent", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushObjectFrameData, "RendererPushObjectFrameData");
+      LODComponentID = GameECS->registerComponent(LODComponentName, sizeof(LODComponent), EV_ALIGNOF(LODComponent));
+      LightRangeComponentID = GameECS->registerComponent(LightRangeComponentName, sizeof(LightRangeComponent), EV_ALIGNOF(LightRangeComponent));
+      GameECS->registerSystem("[out]WorldTransformComponent,RenderComponent || LightComponent || BoundsComponent,!StaticTransform,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererObjectUpdateTransforms, "RendererObjectUpdateTransforms");
+      GameECS->registerSystem("[in]WorldTransformComponent,[out]RenderComponent,LODComponent,!StaticTransform,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererSelectLOD, "RendererSelectLOD");
+      GameECS->registerSystem("[in]WorldTransformComponent,RenderComponent,!BoundsComponent,!StaticTransform,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushObjectFrameData, "RendererPushObjectFrameData");
+      GameECS->registerSystem("[in]WorldTransformComponent,RenderComponent,[in]BoundsComponent,!StaticTransform,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushCulledObjectFrameData, "RendererPushCulledObjectFrameData");
 
       // Light ECS
       RenderingData.LightComponentID = GameECS->registerComponent("LightComponent", sizeof(LightComponent), EV_ALIGNOF(LightComponent));
-      GameECS->registerSystem("[in]WorldTransformComponent,LightComponent", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushLightFrameData, "RendererPushLightFrameData");
+      GameECS->registerSystem("[in]WorldTransformComponent,LightComponent,!LightRangeComponent,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushLightFrameData, "RendererPushLightFrameData");
+      GameECS->registerSystem("[in]WorldTransformComponent,LightComponent,[in]LightRangeComponent,!Inactive", EV_ECS_PIPELINE_STAGE_POSTUPDATE, RendererPushCulledLightFrameData, "RendererPushCulledLightFrameData");
     }
   }
 
@@ -1181,10 +8150,44 @@ EV_CONSTRUCTOR
     imports(GameData.renderer_module, (Renderer, Material, GraphicsPipeline, Light));
   }
 
+  for(U32 i = 0; i < EV_GAME_QUERY_WORKERS + 1; i++) {
+    QueryWorkers.stacks[i] = vec_init(U32, NULL, NULL);
+  }
+
+  CommandsData.buffers = vec_init(GameCommandBuffer *, NULL, NULL);
+  pthread_key_create(&CommandsData.threadKey, commands_threadexit);
+  CommandsData.mainThread = pthread_self();
+  CommandsData.sortedBuffers = vec_init(GameCommandBufferKey, NULL, NULL);
+  CommandsData.applyCommands = vec_init(GameCommand, NULL, NULL);
+  CommandsData.applyData = vec_init(U8, NULL, NULL);
+  CommandsData.createdObjects = vec_init(GameObject, NULL, NULL);
+  indexmap_init(&CommandsData.placeholders);
+
+  AnimationData.segments = vec_init(U32, NULL, NULL);
+  AnimationData.weights = vec_init(F32, NULL, NULL);
+  AnimationData.evaluated = vec_init(U8, NULL, NULL);
+
+  RenderingData.cullSpheres = vec_init(F32, NULL, NULL);
+  RenderingData.cullVisible = vec_init(U8, NULL, NULL);
+  RenderingData.lodDistances = vec_init(F32, NULL, NULL);
+  RenderingData.visibleRenderComponents = vec_init(RenderComponent, NULL, NULL);
+  RenderingData.visibleLightComponents = vec_init(LightComponent, NULL, NULL);
+  RenderingData.frameRenderComponents = vec_init(RenderComponent, NULL, NULL);
+  RenderingData.frameWorldTransforms = vec_init(WorldTransformComponent, NULL, NULL);
+  RenderingData.objectBuckets = vec_init(U32, NULL, NULL);
+  RenderingData.bucketKeys = vec_init(RenderComponent, NULL, NULL);
+  RenderingData.bucketOffsets = vec_init(U32, NULL, NULL);
+  indexmap_init(&RenderingData.bucketSlots);
+  RenderingData.sortedRenderComponents = vec_init(RenderComponent, NULL, NULL);
+  RenderingData.sortedWorldTransforms = vec_init(WorldTransformComponent, NULL, NULL);
+  RenderingData.visibleWorldTransforms = vec_init(WorldTransformComponent, NULL, NULL);
+
   GameData.scenes = vec_init(GameSceneStruct, NULL, gamescenestruct_destr);
+  GameData.free_scene_slots = vec_init(U32, NULL, NULL);
   GameData.scene_map = Hashmap(evstring, GameScene).new();
   vec_setlen((vec_t*)&GameData.scenes, 1);
   GameData.scenes[0] = (GameSceneStruct){
+    .alive = false,
     .physics_world = PhysicsWorld->invalidHandle(),
     .script_context = ScriptContext->invalidHandle()
   };
@@ -1196,8 +8199,51 @@ EV_CONSTRUCTOR
 EV_DESTRUCTOR
 {
   vec_fini(GameData.scenes);
+  vec_fini(GameData.free_scene_slots);
   Hashmap(evstring,GameScene).free(GameData.scene_map);
 
+  vec_fini(AnimationData.segments);
+  vec_fini(AnimationData.weights);
+  vec_fini(AnimationData.evaluated);
+
+  vec_fini(RenderingData.cullSpheres);
+  vec_fini(RenderingData.cullVisible);
+  vec_fini(RenderingData.lodDistances);
+  vec_fini(RenderingData.visibleRenderComponents);
+  vec_fini(RenderingData.visibleLightComponents);
+  vec_fini(RenderingData.frameRenderComponents);
+  vec_fini(RenderingData.frameWorldTransforms);
+  vec_fini(RenderingData.objectBuckets);
+  vec_fini(RenderingData.bucketKeys);
+  vec_fini(RenderingData.bucketOffsets);
+  indexmap_fini(&RenderingData.bucketSlots);
+  vec_fini(RenderingData.sortedRenderComponents);
+  vec_fini(RenderingData.sortedWorldTransforms);
+  vec_fini(RenderingData.visibleWorldTransforms);
+
+  queryworkers_stop();
+  for(U32 i = 0; i < EV_GAME_QUERY_WORKERS + 1; i++) {
+    vec_fini(QueryWorkers.stacks[i]);
+  }
+
+  // Exiting threads mustn't flag buffers that are about to be freed
+  pthread_key_delete(CommandsData.threadKey);
+  for(size_t i = 0; i < vec_len((vec_t*)&CommandsData.buffers); i++) {
+    GameCommandBuffer *buffer = CommandsData.buffers[i];
+    for(U32 p = 0; p < 2; p++) {
+      vec_fini(buffer->pages[p].commands);
+      vec_fini(buffer->pages[p].data);
+    }
+    free(buffer);
+  }
+  ThreadCommandBuffer = NULL;
+  vec_fini(CommandsData.buffers);
+  vec_fini(CommandsData.sortedBuffers);
+  vec_fini(CommandsData.applyCommands);
+  vec_fini(CommandsData.applyData);
+  vec_fini(CommandsData.createdObjects);
+  indexmap_fini(&CommandsData.placeholders);
+
   if(GameData.physics_module) {
     evol_unloadmodule(GameData.physics_module);
   }
@@ -1226,8 +8272,11 @@ ev_object_getworldposition(
     GameScene scene_handle,
     GameObject obj)
 {
-  Vec3 res;
+  Vec3 res = {0};
   const Matrix4x4 *worldTransform = _ev_object_getworldtransform(scene_handle, obj);
+  if(worldTransform == NULL) {
+    return res;
+  }
   res = *(Vec3*)((*worldTransform)[3]);
   return res;
 }
@@ -1237,8 +8286,11 @@ ev_object_getforwardvec(
     GameScene scene_handle,
     GameObject obj)
 {
-  Vec3 res;
+  Vec3 res = {0};
   const Matrix4x4 *worldTransform = _ev_object_getworldtransform(scene_handle, obj);
+  if(worldTransform == NULL) {
+    return res;
+  }
   float *backward = (float*)(*worldTransform)[2];
   glm_vec3_scale(backward, -1, (float*)&res);
   return res;
@@ -1249,8 +8301,11 @@ ev_object_getrightvec(
     GameScene scene_handle,
     GameObject obj)
 {
-  Vec3 res;
+  Vec3 res = {0};
   const Matrix4x4 *worldTransform = _ev_object_getworldtransform(scene_handle, obj);
+  if(worldTransform == NULL) {
+    return res;
+  }
   res = *(Vec3*)((*worldTransform)[0]);
   return res;
 }
@@ -1260,12 +8315,140 @@ ev_object_getupvec(
     GameScene scene_handle,
     GameObject obj)
 {
-  Vec3 res;
+  Vec3 res = {0};
   const Matrix4x4 *worldTransform = _ev_object_getworldtransform(scene_handle, obj);
+  if(worldTransform == NULL) {
+    return res;
+  }
   res = *(Vec3*)((*worldTransform)[1]);
   return res;
 }
 
+SceneTransformView
+scenetransformview_get(
+    SceneTransformViewData *view)
+{
+  return (SceneTransformView) {
+    .count = (U32)vec_len((vec_t*)&view->objects),
+    .objects = view->objects,
+    .valid = view->valid,
+    .positions = view->positions,
+    .eulerAngles = view->eulerAngles,
+    .forwards = view->forwards,
+    .worldPositions = view->worldPositions,
+  };
+}
+
+// Sizes the view for `count` objects. The caller fills `objects` and then
+// calls ev_scene_readtransformview. Pointers from an earlier view of the same
+// scene are invalidated.
+SceneTransformView
+ev_scene_begintransformview(
+    GameScene scene_handle,
+    U32 count)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneTransformView){0});
+  SceneTransformViewData *view = &scene->transform_view;
+  vec_setlen((vec_t*)&view->objects, count);
+  vec_setlen((vec_t*)&view->valid, count);
+  vec_setlen((vec_t*)&view->positions, count);
+  vec_setlen((vec_t*)&view->eulerAngles, count);
+  vec_setlen((vec_t*)&view->forwards, count);
+  vec_setlen((vec_t*)&view->worldPositions, count);
+  vec_setlen((vec_t*)&view->readPositions, count);
+  vec_setlen((vec_t*)&view->readEulerAngles, count);
+  return scenetransformview_get(view);
+}
+
+void
+ev_scene_readtransformview(
+    GameScene scene_handle);
+
+// Views the objects found by the last queryBox/querySphere, already read
+SceneTransformView
+ev_scene_querytransformview(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN(scene, scene_handle, (SceneTransformView){0});
+  U32 count = (U32)vec_len((vec_t*)&scene->bvh.results);
+  SceneTransformView res = ev_scene_begintransformview(scene_handle, count);
+  memcpy(res.objects, scene->bvh.results, count * sizeof(GameObject));
+  ev_scene_readtransformview(scene_handle);
+  return res;
+}
+
+void
+ev_scene_readtransformview(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneTransformViewData *view = &scene->transform_view;
+  U32 count = (U32)vec_len((vec_t*)&view->objects);
+  for(U32 i = 0; i < count; i++) {
+    GameObject obj = view->objects[i];
+    // Objects that don't exist (anymore) read as zero and are flagged
+    view->valid[i] = indexmap_get(&scene->object_slots, obj, NULL);
+    if(!view->valid[i]) {
+      view->positions[i] = (Vec3){0};
+      view->eulerAngles[i] = (Vec3){0};
+      view->forwards[i] = (Vec3){0};
+      view->worldPositions[i] = (Vec3){0};
+      continue;
+    }
+    const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, obj, TransformComponentID);
+    const Matrix4x4 *worldTransform = _ev_object_getworldtransform(scene_handle, obj);
+    vec4 *m = (vec4 *)*worldTransform;
+
+    view->positions[i] = tr->position;
+    glm_euler_angles(m, (float*)&view->eulerAngles[i]);
+    glm_vec3_scale(m[2], -1, (float*)&view->forwards[i]);
+    view->worldPositions[i] = *(Vec3*)m[3];
+  }
+  memcpy(view->readPositions, view->positions, count * sizeof(Vec3));
+  memcpy(view->readEulerAngles, view->eulerAngles, count * sizeof(Vec3));
+}
+
+// Applies the positions and euler angles that differ from what was last read.
+// forwards and worldPositions are read-only. Entries of objects that no longer
+// exist are skipped.
+void
+ev_scene_writetransformview(
+    GameScene scene_handle)
+{
+  GET_SCENE_OR_RETURN_VOID(scene, scene_handle);
+  SceneTransformViewData *view = &scene->transform_view;
+  U32 count = (U32)vec_len((vec_t*)&view->objects);
+  for(U32 i = 0; i < count; i++) {
+    bool moved = memcmp(&view->positions[i], &view->readPositions[i], sizeof(Vec3)) != 0;
+    bool rotated = memcmp(&view->eulerAngles[i], &view->readEulerAngles[i], sizeof(Vec3)) != 0;
+    if(!moved && !rotated) {
+      continue;
+    }
+
+    GameObject obj = view->objects[i];
+    // Also covers objects destroyed between the read and the write
+    if(!indexmap_get(&scene->object_slots, obj, NULL)) {
+      view->valid[i] = false;
+      continue;
+    }
+    const TransformComponent *tr = GameECS->getComponent(scene->ecs_world, obj, TransformComponentID);
+    TransformComponent newTransform = *tr;
+    if(moved) {
+      newTransform.position = view->positions[i];
+    }
+    if(rotated) {
+      Matrix4x4 rotationMatrix;
+      glm_euler((float*)&view->eulerAngles[i], rotationMatrix);
+      glm_mat4_quat(rotationMatrix, (float*)&newTransform.rotation);
+    }
+    GameECS->setComponent(scene->ecs_world, obj, TransformComponentID, &newTransform);
+    transform_setdirty(scene->ecs_world, obj);
+    sceneobjects_syncrigidbody(scene_handle, obj, &newTransform, moved, rotated);
+  }
+  memcpy(view->readPositions, view->positions, count * sizeof(Vec3));
+  memcpy(view->readEulerAngles, view->eulerAngles, count * sizeof(Vec3));
+}
+
 void
 ev_scene_setname(
     GameScene scene_handle,
@@ -1278,24 +8461,65 @@ GameScene
 ev_scene_getfromname(
     CONST_STR name)
 {
-  return *(GameScene*)Hashmap(evstring, GameScene).get(GameData.scene_map, name);
+  GameScene *scene_handle = Hashmap(evstring, GameScene).get(GameData.scene_map, name);
+  if(scene_handle == NULL || !ev_scene_isvalid(*scene_handle)) {
+    return 0;
+  }
+  return *scene_handle;
 }
 
 EV_BINDINGS
 {
+  EV_NS_BIND_FN(Commands, setThreadOrder, ev_commands_setthreadorder);
+  EV_NS_BIND_FN(Commands, createObject, ev_commands_createobject);
+  EV_NS_BIND_FN(Commands, destroyObject, ev_commands_destroyobject);
+  EV_NS_BIND_FN(Commands, setTransform, ev_commands_settransform);
+  EV_NS_BIND_FN(Commands, setComponent, ev_commands_setcomponent);
+  EV_NS_BIND_FN(Commands, setParent, ev_commands_setparent);
+  EV_NS_BIND_FN(Commands, resolve, ev_commands_resolve);
+  EV_NS_BIND_FN(Commands, apply, ev_commands_apply);
+
+  EV_NS_BIND_FN(Replication, addComponent, ev_replication_addcomponent);
+  EV_NS_BIND_FN(Replication, capture, ev_replication_capture);
+  EV_NS_BIND_FN(Replication, encode, ev_replication_encode);
+  EV_NS_BIND_FN(Replication, freePacket, ev_replication_freepacket);
+  EV_NS_BIND_FN(Replication, createDecoder, ev_replication_createdecoder);
+  EV_NS_BIND_FN(Replication, destroyDecoder, ev_replication_destroydecoder);
+  EV_NS_BIND_FN(Replication, decode, ev_replication_decode);
+  EV_NS_BIND_FN(Replication, getLatestFrame, ev_replication_getlatestframe);
+  EV_NS_BIND_FN(Replication, getView, ev_replication_getview);
+  EV_NS_BIND_FN(Replication, getComponent, ev_replication_getcomponent);
+  EV_NS_BIND_FN(Replication, mapObject, ev_replication_mapobject);
+  EV_NS_BIND_FN(Replication, apply, ev_replication_apply);
+  EV_NS_BIND_FN(Replication, benchmark, ev_replication_benchmark);
+
   EV_NS_BIND_FN(Game, clearScenes, ev_game_clearscenes);
   EV_NS_BIND_FN(Game, reload, ev_game_reload);
   EV_NS_BIND_FN(Game, setActiveScene, ev_game_setactivescene);
   EV_NS_BIND_FN(Game, progress, ev_game_progress);
 
   EV_NS_BIND_FN(Scene, create, ev_scene_create);
+  EV_NS_BIND_FN(Scene, destroy, ev_scene_destroy);
+  EV_NS_BIND_FN(Scene, isValid, ev_scene_isvalid);
   EV_NS_BIND_FN(Scene, loadFromFile, ev_scene_loadfromfile);
+  EV_NS_BIND_FN(Scene, loadFromFileStreamed, ev_scene_loadfromfilestreamed);
+  EV_NS_BIND_FN(Scene, setStreamingRadius, ev_scene_setstreamingradius);
+  EV_NS_BIND_FN(Scene, setStreamingBudget, ev_scene_setstreamingbudget);
+  EV_NS_BIND_FN(Scene, getStreamingStats, ev_scene_getstreamingstats);
+  EV_NS_BIND_FN(Scene, enableHotReload, ev_scene_enablehotreload);
+  EV_NS_BIND_FN(Scene, hotReload, ev_scene_hotreload);
+  EV_NS_BIND_FN(Scene, snapshot, ev_scene_snapshot);
+  EV_NS_BIND_FN(Scene, restore, ev_scene_restore);
+  EV_NS_BIND_FN(Scene, freeSnapshot, ev_scene_freesnapshot);
+  EV_NS_BIND_FN(Scene, benchmarkRestore, ev_scene_benchmarkrestore);
   EV_NS_BIND_FN(Scene, setName, ev_scene_setname);
   EV_NS_BIND_FN(Scene, getFromName, ev_scene_getfromname);
   EV_NS_BIND_FN(Scene, createObject, ev_scene_createobject);
   EV_NS_BIND_FN(Scene, createChildObject, ev_scene_createchildobject);
+  EV_NS_BIND_FN(Scene, createObjects, ev_scene_createobjects);
   EV_NS_BIND_FN(Scene, addChildToObject, ev_scene_addchildtoobject);
   EV_NS_BIND_FN(Scene, destroyObject, ev_scene_destroyobject);
+  EV_NS_BIND_FN(Scene, flushDestroyed, ev_scene_flushdestroyed);
   EV_NS_BIND_FN(Scene, createCamera, ev_scene_createcamera);
   EV_NS_BIND_FN(Scene, getECSWorld, ev_scene_getecsworld);
   EV_NS_BIND_FN(Scene, getPhysicsWorld, ev_scene_getphysicsworld);
@@ -1303,6 +8527,30 @@ EV_BINDINGS
   EV_NS_BIND_FN(Scene, getActiveCamera, ev_scene_getactivecamera);
   EV_NS_BIND_FN(Scene, setActiveCamera, ev_scene_setactivecamera);
   EV_NS_BIND_FN(Scene, getObject, ev_scene_getobject);
+  EV_NS_BIND_FN(Scene, getObjectByPath, ev_scene_getobjectbypath);
+  EV_NS_BIND_FN(Scene, getPathIndexStats, ev_scene_getpathindexstats);
+  EV_NS_BIND_FN(Scene, getArenaStats, ev_scene_getarenastats);
+  EV_NS_BIND_FN(Scene, getStats, ev_scene_getstats);
+  EV_NS_BIND_FN(Scene, getCullingStats, ev_scene_getcullingstats);
+  EV_NS_BIND_FN(Scene, setFrustumCulling, ev_scene_setfrustumculling);
+  EV_NS_BIND_FN(Scene, setRenderBatching, ev_scene_setrenderbatching);
+  EV_NS_BIND_FN(Scene, getRenderBatchStats, ev_scene_getrenderbatchstats);
+  EV_NS_BIND_FN(Scene, getLightStats, ev_scene_getlightstats);
+  EV_NS_BIND_FN(Scene, setLightClustering, ev_scene_setlightclustering);
+  EV_NS_BIND_FN(Scene, getLightClusters, ev_scene_getlightclusters);
+  EV_NS_BIND_FN(Scene, queryBox, ev_scene_querybox);
+  EV_NS_BIND_FN(Scene, querySphere, ev_scene_querysphere);
+  EV_NS_BIND_FN(Scene, raycastBounds, ev_scene_raycastbounds);
+  EV_NS_BIND_FN(Scene, raycastBatch, ev_scene_raycastbatch);
+  EV_NS_BIND_FN(Scene, overlapBatch, ev_scene_overlapbatch);
+  EV_NS_BIND_FN(Scene, warmPool, ev_scene_warmpool);
+  EV_NS_BIND_FN(Scene, acquire, ev_scene_acquire);
+  EV_NS_BIND_FN(Scene, release, ev_scene_release);
+  EV_NS_BIND_FN(Scene, getPoolStats, ev_scene_getpoolstats);
+  EV_NS_BIND_FN(Scene, beginTransformView, ev_scene_begintransformview);
+  EV_NS_BIND_FN(Scene, queryTransformView, ev_scene_querytransformview);
+  EV_NS_BIND_FN(Scene, readTransformView, ev_scene_readtransformview);
+  EV_NS_BIND_FN(Scene, writeTransformView, ev_scene_writetransformview);
 
   EV_NS_BIND_FN(Object, getWorldTransform, _ev_object_getworldtransform);
   EV_NS_BIND_FN(Object, setWorldTransform, _ev_object_setworldtransform);
@@ -1313,6 +8561,15 @@ EV_BINDINGS
   EV_NS_BIND_FN(Object, getRotation, _ev_object_getrotation);
   EV_NS_BIND_FN(Object, getScale,    _ev_object_getscale);
   EV_NS_BIND_FN(Object, getChild,     ev_object_getchild);
+  EV_NS_BIND_FN(Object, setName,      ev_object_setname);
+  EV_NS_BIND_FN(Object, setBounds,    ev_object_setbounds);
+  EV_NS_BIND_FN(Object, setStatic,    ev_object_setstatic);
+  EV_NS_BIND_FN(Object, isStatic,     ev_object_isstatic);
+  EV_NS_BIND_FN(Object, setActive,    ev_object_setactive);
+  EV_NS_BIND_FN(Object, isActive,     ev_object_isactive);
+  EV_NS_BIND_FN(Object, setAnimationPlaying, ev_object_setanimationplaying);
+  EV_NS_BIND_FN(Object, isAnimationPlaying,  ev_object_isanimationplaying);
+  EV_NS_BIND_FN(Object, setAnimationTime,    ev_object_setanimationtime);
 
   // ECS shortcuts
   EV_NS_BIND_FN(Object, getComponent, ev_object_getcomponent);
@@ -1398,6 +8655,204 @@ ev_scene_getobject_wrapper(
   *out = ev_scene_getobject(0, *path);
 }
 
+void
+ev_scene_getobjectbypath_wrapper(
+    GameObject *out,
+    CONST_STR *path)
+{
+  *out = ev_scene_getobjectbypath(0, *path);
+}
+
+void
+ev_scene_querybox_wrapper(
+    U32 *out,
+    EV_UNALIGNED Vec3 *min,
+    EV_UNALIGNED Vec3 *max)
+{
+  *out = ev_scene_querybox(0, Vec3new(min->x, min->y, min->z), Vec3new(max->x, max->y, max->z), NULL, 0);
+}
+
+void
+ev_scene_querysphere_wrapper(
+    U32 *out,
+    EV_UNALIGNED Vec3 *center,
+    F32 *radius)
+{
+  *out = ev_scene_querysphere(0, Vec3new(center->x, center->y, center->z), *radius, NULL, 0);
+}
+
+// Results of the last box/sphere query, read one at a time by scripts
+void
+ev_scene_getqueryresult_wrapper(
+    GameObject *out,
+    U32 *idx)
+{
+  *out = 0;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  *out = *idx < vec_len((vec_t*)&scene->bvh.results) ? scene->bvh.results[*idx] : 0;
+}
+
+void
+ev_scene_raycastbounds_wrapper(
+    SceneBoundsHit *out,
+    EV_UNALIGNED Vec3 *origin,
+    EV_UNALIGNED Vec3 *direction,
+    F32 *maxDistance)
+{
+  *out = (SceneBoundsHit){0};
+  ev_scene_raycastbounds(0,
+      Vec3new(origin->x, origin->y, origin->z),
+      Vec3new(direction->x, direction->y, direction->z),
+      *maxDistance, out);
+}
+
+void
+ev_scene_begintransformview_wrapper(
+    SceneTransformView *out,
+    U32 *count)
+{
+  *out = ev_scene_begintransformview(0, *count);
+}
+
+void
+ev_scene_querytransformview_wrapper(
+    SceneTransformView *out)
+{
+  *out = ev_scene_querytransformview(0);
+}
+
+void
+ev_scene_readtransformview_wrapper()
+{
+  ev_scene_readtransformview(0);
+}
+
+void
+ev_scene_writetransformview_wrapper()
+{
+  ev_scene_writetransformview(0);
+}
+
+// Batched queries from scripts go through per-scene arrays: the script fills
+// the returned query array, then runs the batch and reads the results array.
+void
+ev_scene_raycastbatch_begin_wrapper(
+    SceneRaycastQuery **out,
+    U32 *count)
+{
+  *out = NULL;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneQueryBatchData *batch = &scene->query_batch;
+  vec_setlen((vec_t*)&batch->rays, *count);
+  vec_setlen((vec_t*)&batch->rayHits, *count);
+  *out = batch->rays;
+}
+
+void
+ev_scene_raycastbatch_run_wrapper(
+    SceneBoundsHit **out)
+{
+  *out = NULL;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneQueryBatchData *batch = &scene->query_batch;
+  ev_scene_raycastbatch(0, batch->rays, (U32)vec_len((vec_t*)&batch->rays), batch->rayHits);
+  *out = batch->rayHits;
+}
+
+void
+ev_scene_overlapbatch_begin_wrapper(
+    SceneOverlapQuery **out,
+    U32 *count)
+{
+  *out = NULL;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneQueryBatchData *batch = &scene->query_batch;
+  vec_setlen((vec_t*)&batch->overlaps, *count);
+  vec_setlen((vec_t*)&batch->overlapCounts, *count);
+  *out = batch->overlaps;
+}
+
+// Returns the per-query counts; objects are read with
+// ev_scene_overlapbatch_results
+void
+ev_scene_overlapbatch_run_wrapper(
+    U32 **out,
+    U32 *maxResults)
+{
+  *out = NULL;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  SceneQueryBatchData *batch = &scene->query_batch;
+  U32 count = (U32)vec_len((vec_t*)&batch->overlaps);
+  vec_setlen((vec_t*)&batch->overlapResults, (size_t)count * *maxResults);
+  ev_scene_overlapbatch(0, batch->overlaps, count, batch->overlapCounts, batch->overlapResults, *maxResults);
+  *out = batch->overlapCounts;
+}
+
+void
+ev_scene_overlapbatch_results_wrapper(
+    GameObject **out)
+{
+  *out = NULL;
+  GET_SCENE_OR_RETURN_VOID(scene, 0);
+  *out = scene->query_batch.overlapResults;
+}
+
+void
+ev_object_setactive_wrapper(
+    EV_UNALIGNED ECSEntityID *entt,
+    bool *active)
+{
+  ev_object_setactive(0, *entt, *active);
+}
+
+void
+ev_object_isactive_wrapper(
+    bool *out,
+    EV_UNALIGNED ECSEntityID *entt)
+{
+  *out = ev_object_isactive(0, *entt);
+}
+
+void
+ev_object_setanimationplaying_wrapper(
+    EV_UNALIGNED ECSEntityID *entt,
+    bool *playing)
+{
+  ev_object_setanimationplaying(0, *entt, *playing);
+}
+
+void
+ev_object_isanimationplaying_wrapper(
+    bool *out,
+    EV_UNALIGNED ECSEntityID *entt)
+{
+  *out = ev_object_isanimationplaying(0, *entt);
+}
+
+void
+ev_object_setanimationtime_wrapper(
+    EV_UNALIGNED ECSEntityID *entt,
+    F32 *time)
+{
+  ev_object_setanimationtime(0, *entt, *time);
+}
+
+void
+ev_scene_acquire_wrapper(
+    GameObject *out,
+    CONST_STR *prefabPath)
+{
+  *out = ev_scene_acquire(0, *prefabPath);
+}
+
+void
+ev_scene_release_wrapper(
+    bool *out,
+    EV_UNALIGNED ECSEntityID *entt)
+{
+  *out = ev_scene_release(0, *entt);
+}
+
 void
 ev_sceneloader_loadprefab_wrapper(
     GameObject *out,
@@ -1475,6 +8930,8 @@ ev_gamemod_scriptapi_loader(
   ScriptType floatSType = ScriptInterface->getType(ctx_h, "float");
   ScriptType ullSType = ScriptInterface->getType(ctx_h, "unsigned long long");
   ScriptType constCharType = ScriptInterface->getType(ctx_h, "const char*");
+  ScriptType uintSType = ScriptInterface->getType(ctx_h, "unsigned int");
+  ScriptType boolSType = ScriptInterface->getType(ctx_h, "bool");
 
   ScriptType vec3SType = ScriptInterface->addStruct(ctx_h, "Vec3", sizeof(Vec3), 3, (ScriptStructMember[]) {
       {"x", floatSType, offsetof(Vec3, x)},
@@ -1482,13 +8939,53 @@ ev_gamemod_scriptapi_loader(
       {"z", floatSType, offsetof(Vec3, z)}
   });
 
+  ScriptType boundsHitSType = ScriptInterface->addStruct(ctx_h, "SceneBoundsHit", sizeof(SceneBoundsHit), 2, (ScriptStructMember[]) {
+      {"object", ullSType, offsetof(SceneBoundsHit, object)},
+      {"distance", floatSType, offsetof(SceneBoundsHit, distance)}
+  });
+
+  ScriptType ullPtrSType = ScriptInterface->getType(ctx_h, "unsigned long long*");
+  ScriptType uintPtrSType = ScriptInterface->getType(ctx_h, "unsigned int*");
+  ScriptType vec3PtrSType = ScriptInterface->getType(ctx_h, "Vec3*");
+  ScriptType boolPtrSType = ScriptInterface->getType(ctx_h, "bool*");
+  ScriptType transformViewSType = ScriptInterface->addStruct(ctx_h, "SceneTransformView", sizeof(SceneTransformView), 7, (ScriptStructMember[]) {
+      {"count", uintSType, offsetof(SceneTransformView, count)},
+      {"objects", ullPtrSType, offsetof(SceneTransformView, objects)},
+      {"valid", boolPtrSType, offsetof(SceneTransformView, valid)},
+      {"positions", vec3PtrSType, offsetof(SceneTransformView, positions)},
+      {"eulerAngles", vec3PtrSType, offsetof(SceneTransformView, eulerAngles)},
+      {"forwards", vec3PtrSType, offsetof(SceneTransformView, forwards)},
+      {"worldPositions", vec3PtrSType, offsetof(SceneTransformView, worldPositions)}
+  });
+
+  ScriptInterface->addStruct(ctx_h, "SceneRaycastQuery", sizeof(SceneRaycastQuery), 3, (ScriptStructMember[]) {
+      {"origin", vec3SType, offsetof(SceneRaycastQuery, origin)},
+      {"direction", vec3SType, offsetof(SceneRaycastQuery, direction)},
+      {"maxDistance", floatSType, offsetof(SceneRaycastQuery, maxDistance)}
+  });
+  ScriptInterface->addStruct(ctx_h, "SceneOverlapQuery", sizeof(SceneOverlapQuery), 2, (ScriptStructMember[]) {
+      {"center", vec3SType, offsetof(SceneOverlapQuery, center)},
+      {"radius", floatSType, offsetof(SceneOverlapQuery, radius)}
+  });
+  ScriptType rayQueryPtrSType = ScriptInterface->getType(ctx_h, "SceneRaycastQuery*");
+  ScriptType overlapQueryPtrSType = ScriptInterface->getType(ctx_h, "SceneOverlapQuery*");
+  ScriptType boundsHitPtrSType = ScriptInterface->getType(ctx_h, "SceneBoundsHit*");
+
   ScriptInterface->addFunction(ctx_h, ev_sceneloader_loadprefab_wrapper, "ev_sceneloader_loadprefab", ullSType, 1, (ScriptType[]){constCharType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_acquire_wrapper, "ev_scene_acquire", ullSType, 1, (ScriptType[]){constCharType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_release_wrapper, "ev_scene_release", boolSType, 1, (ScriptType[]){ullSType});
 
   ScriptInterface->addFunction(ctx_h, _ev_object_getname_wrapper, "ev_object_getname", constCharType, 1, (ScriptType[]){ullSType});
   ScriptInterface->addFunction(ctx_h, ev_object_getchild_wrapper, "ev_object_getchild", ullSType, 2, (ScriptType[]){ullSType, constCharType});
 
   ScriptInterface->addFunction(ctx_h, ev_scene_destroyobject_wrapper, "ev_scene_destroyobject", voidSType, 1, (ScriptType[]){ullSType});
 
+  ScriptInterface->addFunction(ctx_h, ev_object_setactive_wrapper, "ev_object_setactive", voidSType, 2, (ScriptType[]){ullSType, boolSType});
+  ScriptInterface->addFunction(ctx_h, ev_object_isactive_wrapper, "ev_object_isactive", boolSType, 1, (ScriptType[]){ullSType});
+  ScriptInterface->addFunction(ctx_h, ev_object_setanimationplaying_wrapper, "ev_object_setanimationplaying", voidSType, 2, (ScriptType[]){ullSType, boolSType});
+  ScriptInterface->addFunction(ctx_h, ev_object_isanimationplaying_wrapper, "ev_object_isanimationplaying", boolSType, 1, (ScriptType[]){ullSType});
+  ScriptInterface->addFunction(ctx_h, ev_object_setanimationtime_wrapper, "ev_object_setanimationtime", voidSType, 2, (ScriptType[]){ullSType, floatSType});
+
   ScriptInterface->addFunction(ctx_h, _ev_object_getposition_wrapper, "ev_object_getposition", vec3SType, 1, (ScriptType[]){ullSType});
   ScriptInterface->addFunction(ctx_h, _ev_object_setposition_wrapper, "ev_object_setposition", voidSType, 2, (ScriptType[]){ullSType, vec3SType});
 
@@ -1506,6 +9003,23 @@ ev_gamemod_scriptapi_loader(
   ScriptInterface->addFunction(ctx_h, ev_game_setactivescenename_wrapper, "ev_game_setactivescenename", voidSType, 1, (ScriptType[]){constCharType});
 
   ScriptInterface->addFunction(ctx_h, ev_scene_getobject_wrapper, "ev_scene_getobject", ullSType, 1, (ScriptType[]){constCharType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_getobjectbypath_wrapper, "ev_scene_getobjectbypath", ullSType, 1, (ScriptType[]){constCharType});
+
+  ScriptInterface->addFunction(ctx_h, ev_scene_querybox_wrapper, "ev_scene_querybox", uintSType, 2, (ScriptType[]){vec3SType, vec3SType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_querysphere_wrapper, "ev_scene_querysphere", uintSType, 2, (ScriptType[]){vec3SType, floatSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_getqueryresult_wrapper, "ev_scene_getqueryresult", ullSType, 1, (ScriptType[]){uintSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_raycastbounds_wrapper, "ev_scene_raycastbounds", boundsHitSType, 3, (ScriptType[]){vec3SType, vec3SType, floatSType});
+
+  ScriptInterface->addFunction(ctx_h, ev_scene_raycastbatch_begin_wrapper, "ev_scene_raycastbatch_begin", rayQueryPtrSType, 1, (ScriptType[]){uintSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_raycastbatch_run_wrapper, "ev_scene_raycastbatch_run", boundsHitPtrSType, 0, NULL);
+  ScriptInterface->addFunction(ctx_h, ev_scene_overlapbatch_begin_wrapper, "ev_scene_overlapbatch_begin", overlapQueryPtrSType, 1, (ScriptType[]){uintSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_overlapbatch_run_wrapper, "ev_scene_overlapbatch_run", uintPtrSType, 1, (ScriptType[]){uintSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_overlapbatch_results_wrapper, "ev_scene_overlapbatch_results", ullPtrSType, 0, NULL);
+
+  ScriptInterface->addFunction(ctx_h, ev_scene_begintransformview_wrapper, "ev_scene_begintransformview", transformViewSType, 1, (ScriptType[]){uintSType});
+  ScriptInterface->addFunction(ctx_h, ev_scene_querytransformview_wrapper, "ev_scene_querytransformview", transformViewSType, 0, NULL);
+  ScriptInterface->addFunction(ctx_h, ev_scene_readtransformview_wrapper, "ev_scene_readtransformview", voidSType, 0, NULL);
+  ScriptInterface->addFunction(ctx_h, ev_scene_writetransformview_wrapper, "ev_scene_writetransformview", voidSType, 0, NULL);
 
   ScriptInterface->loadAPI(ctx_h, "subprojects/evmod_game/script_api.lua");
 }